@@ -0,0 +1,169 @@
+/*
+ * Benchmark runner for VRAM System
+ * A small Google Benchmark-style harness: benchmarks loop on
+ * state.keepRunning() and the runner scales the iteration count until a
+ * run is long enough to time
+ */
+
+#ifndef BENCH_H
+#define BENCH_H
+
+#include <chrono>
+#include <cstdio>
+#include <cstring>
+#include <string>
+#include <vector>
+#include <utility>
+
+// Runner configuration
+#define BENCH_MIN_TIME_MS      200       // A run shorter than this is repeated with more iterations
+#define BENCH_MAX_ITERATIONS   100000000
+#define BENCH_COUNTER_LIMIT    6         // Extra columns per result
+
+class BenchState {
+private:
+  typedef std::chrono::steady_clock Clock;
+  
+  uint64_t iterations;
+  uint64_t remaining;
+  bool started;
+  bool paused;
+  Clock::time_point resumedAt;
+  Clock::duration elapsed;
+  uint64_t items;
+  std::vector<std::pair<std::string, double>> counters;
+  
+  friend class BenchRunner;
+  
+public:
+  explicit BenchState(uint64_t runIterations)
+    : iterations(runIterations), remaining(runIterations), started(false), paused(false),
+      elapsed(Clock::duration::zero()), items(0) {}
+  
+  // for (...; state.keepRunning(); ) — the timer runs from the first call to the last
+  bool keepRunning() {
+    if (!started) {
+      started = true;
+      resumedAt = Clock::now();
+    }
+    if (remaining > 0) {
+      remaining--;
+      return true;
+    }
+    if (!paused) {
+      elapsed += Clock::now() - resumedAt;
+    }
+    return false;
+  }
+  
+  // Leave setup work, such as refilling a cache, out of the timing
+  void pauseTiming() {
+    if (!paused) {
+      elapsed += Clock::now() - resumedAt;
+      paused = true;
+    }
+  }
+  void resumeTiming() {
+    if (paused) {
+      resumedAt = Clock::now();
+      paused = false;
+    }
+  }
+  
+  uint64_t getIterations() const { return iterations; }
+  
+  // Operations per iteration when one iteration does several (default 1)
+  void setItemsProcessed(uint64_t count) { items = count; }
+  
+  // Extra result columns, reported from the last run only
+  void setCounter(const char* name, double value) {
+    for (auto& counter : counters) {
+      if (counter.first == name) {
+        counter.second = value;
+        return;
+      }
+    }
+    if (counters.size() < BENCH_COUNTER_LIMIT) {
+      counters.push_back(std::make_pair(std::string(name), value));
+    }
+  }
+};
+
+typedef void (*BenchFunction)(BenchState& state);
+
+class BenchRunner {
+private:
+  struct Bench {
+    const char* name;
+    BenchFunction function;
+    uint64_t fixedIterations;   // 0 to scale until BENCH_MIN_TIME_MS
+  };
+  
+  static std::vector<Bench>& registry() {
+    static std::vector<Bench> benches;
+    return benches;
+  }
+  
+public:
+  static int add(const char* name, BenchFunction function, uint64_t fixedIterations = 0) {
+    registry().push_back({ name, function, fixedIterations });
+    return 0;
+  }
+  
+  // Runs every benchmark whose name contains filter (all if nullptr)
+  static int runAll(const char* filter) {
+    printf("%-36s %12s %12s %14s  %s\n", "Benchmark", "Iterations", "ns/op", "ops/s", "Counters");
+    int run = 0;
+    for (const Bench& bench : registry()) {
+      if (filter != nullptr && strstr(bench.name, filter) == nullptr) {
+        continue;
+      }
+      runOne(bench);
+      run++;
+    }
+    return run;
+  }
+  
+private:
+  static void runOne(const Bench& bench) {
+    uint64_t iterations = bench.fixedIterations > 0 ? bench.fixedIterations : 1;
+    while (true) {
+      BenchState state(iterations);
+      bench.function(state);
+      
+      double ms = std::chrono::duration<double, std::milli>(state.elapsed).count();
+      bool done = bench.fixedIterations > 0 || ms >= BENCH_MIN_TIME_MS ||
+                  iterations >= BENCH_MAX_ITERATIONS;
+      if (done) {
+        report(bench, state, ms);
+        return;
+      }
+      
+      // Aim a little past the minimum so the next run is usually the last
+      double scale = ms > 0 ? BENCH_MIN_TIME_MS * 1.4 / ms : 10;
+      scale = scale < 2 ? 2 : (scale > 10 ? 10 : scale);
+      iterations = (uint64_t)(iterations * scale);
+    }
+  }
+  
+  static void report(const Bench& bench, const BenchState& state, double ms) {
+    uint64_t operations = state.iterations * (state.items > 0 ? state.items : 1);
+    double nsPerOp = operations > 0 ? ms * 1e6 / operations : 0;
+    double opsPerSec = ms > 0 ? operations * 1000.0 / ms : 0;
+    
+    printf("%-36s %12llu %12.1f %14.0f ", bench.name, (unsigned long long)state.iterations, nsPerOp, opsPerSec);
+    for (const auto& counter : state.counters) {
+      printf(" %s=%.4g", counter.first.c_str(), counter.second);
+    }
+    printf("\n");
+    fflush(stdout);
+  }
+};
+
+// Registers a benchmark; BENCHMARK_FIXED runs exactly n iterations, once
+#define BENCHMARK(function) \
+  static int function##_registered = BenchRunner::add(#function, function)
+#define BENCHMARK_FIXED(function, n) \
+  static int function##_registered = BenchRunner::add(#function, function, n)
+
+#endif // BENCH_H
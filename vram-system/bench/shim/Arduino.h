@@ -0,0 +1,144 @@
+/*
+ * Host shim for the VRAM System benchmarks
+ * Just enough of Arduino, ESP and FreeRTOS for memory_manager.h,
+ * resource_cache.h and eviction_policy.h to build and run on a PC
+ */
+
+#ifndef BENCH_ARDUINO_H
+#define BENCH_ARDUINO_H
+
+#include <cstdint>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <cstdarg>
+#include <cctype>
+#include <string>
+#include <chrono>
+#include <thread>
+#include <mutex>
+#include <algorithm>
+#include <atomic>
+
+using std::min;
+using std::max;
+
+#define constrain(amt, low, high) ((amt) < (low) ? (low) : ((amt) > (high) ? (high) : (amt)))
+
+// Device heap the managers believe they run in; fixed, as at boot
+#define SHIM_HEAP_SIZE       (320 * 1024)
+#define SHIM_FREE_HEAP       (200 * 1024)
+#define SHIM_MAX_ALLOC_HEAP  (110 * 1024)
+
+// Arduino String over std::string, with the members the headers use
+class String {
+private:
+  std::string text;
+  
+public:
+  String() {}
+  String(const char* value) : text(value ? value : "") {}
+  String(const std::string& value) : text(value) {}
+  String(char value) : text(1, value) {}
+  String(int value) : text(std::to_string(value)) {}
+  String(unsigned int value) : text(std::to_string(value)) {}
+  String(long value) : text(std::to_string(value)) {}
+  String(unsigned long value) : text(std::to_string(value)) {}
+  
+  const char* c_str() const { return text.c_str(); }
+  unsigned int length() const { return text.size(); }
+  bool isEmpty() const { return text.empty(); }
+  bool reserve(unsigned int size) { text.reserve(size); return true; }
+  bool concat(const char* data, unsigned int length) { text.append(data, length); return true; }
+  bool concat(const String& other) { text += other.text; return true; }
+  long toInt() const { return atol(text.c_str()); }
+  int indexOf(char c, unsigned int from = 0) const {
+    size_t position = text.find(c, from);
+    return position == std::string::npos ? -1 : (int)position;
+  }
+  String substring(unsigned int from) const { return from < text.size() ? String(text.substr(from)) : String(); }
+  String substring(unsigned int from, unsigned int to) const {
+    return from < text.size() ? String(text.substr(from, to - from)) : String();
+  }
+  bool startsWith(const String& prefix) const { return text.compare(0, prefix.text.size(), prefix.text) == 0; }
+  
+  String& operator+=(const String& other) { text += other.text; return *this; }
+  String& operator+=(const char* other) { text += other; return *this; }
+  friend String operator+(const String& a, const String& b) { return String(a.text + b.text); }
+  bool operator==(const String& other) const { return text == other.text; }
+  bool operator==(const char* other) const { return text == other; }
+  bool operator!=(const String& other) const { return text != other.text; }
+  bool operator<(const String& other) const { return text < other.text; }
+};
+
+// Serial goes to stderr, so benchmark results on stdout stay clean
+class HardwareSerial {
+public:
+  void begin(unsigned long) {}
+  int printf(const char* format, ...) __attribute__((format(printf, 2, 3))) {
+    va_list args;
+    va_start(args, format);
+    int written = vfprintf(stderr, format, args);
+    va_end(args);
+    return written;
+  }
+  void print(const char* text) { fputs(text, stderr); }
+  void print(const String& text) { fputs(text.c_str(), stderr); }
+  void println(const char* text = "") { fprintf(stderr, "%s\n", text); }
+  void println(const String& text) { fprintf(stderr, "%s\n", text.c_str()); }
+  operator bool() { return true; }
+};
+inline HardwareSerial Serial;
+
+inline unsigned long micros() {
+  static const auto start = std::chrono::steady_clock::now();
+  return std::chrono::duration_cast<std::chrono::microseconds>(std::chrono::steady_clock::now() - start).count();
+}
+inline unsigned long millis() { return micros() / 1000; }
+inline void delay(unsigned long ms) { std::this_thread::sleep_for(std::chrono::milliseconds(ms)); }
+inline void yield() {}
+inline long random(long low, long high) { return low + rand() % (high - low); }
+inline long random(long high) { return rand() % high; }
+
+class EspClass {
+public:
+  uint32_t getHeapSize() { return SHIM_HEAP_SIZE; }
+  uint32_t getFreeHeap() { return SHIM_FREE_HEAP; }
+  uint32_t getMaxAllocHeap() { return SHIM_MAX_ALLOC_HEAP; }
+  uint32_t getPsramSize() { return 0; }
+  uint32_t getFreePsram() { return 0; }
+};
+inline EspClass ESP;
+
+// FreeRTOS: recursive mutexes and spinlocks, the only primitives these headers use
+typedef int BaseType_t;
+typedef uint32_t TickType_t;
+#define pdTRUE   1
+#define pdFALSE  0
+#define portMAX_DELAY 0xFFFFFFFFu
+#define pdMS_TO_TICKS(ms) ((TickType_t)(ms))
+
+typedef std::recursive_timed_mutex* SemaphoreHandle_t;
+inline SemaphoreHandle_t xSemaphoreCreateRecursiveMutex() { return new std::recursive_timed_mutex(); }
+inline void vSemaphoreDelete(SemaphoreHandle_t handle) { delete handle; }
+inline BaseType_t xSemaphoreTakeRecursive(SemaphoreHandle_t handle, TickType_t ticks) {
+  if (ticks == portMAX_DELAY) {
+    handle->lock();
+    return pdTRUE;
+  }
+  return handle->try_lock_for(std::chrono::milliseconds(ticks)) ? pdTRUE : pdFALSE;
+}
+inline BaseType_t xSemaphoreGiveRecursive(SemaphoreHandle_t handle) {
+  handle->unlock();
+  return pdTRUE;
+}
+
+// Constant-initialised like the ESP32 spinlock, so static tables can use it early
+struct portMUX_TYPE {
+  std::atomic_flag flag;
+};
+#define portMUX_INITIALIZER_UNLOCKED { ATOMIC_FLAG_INIT }
+#define portENTER_CRITICAL(mux) while ((mux)->flag.test_and_set(std::memory_order_acquire)) {}
+#define portEXIT_CRITICAL(mux) (mux)->flag.clear(std::memory_order_release)
+
+#endif // BENCH_ARDUINO_H
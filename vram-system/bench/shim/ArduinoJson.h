@@ -0,0 +1,29 @@
+/*
+ * Host shim for the VRAM System benchmarks
+ * telemetry.h names the ArduinoJson types in Telemetry::serialize(); the
+ * benchmarks never serialize, so these only have to compile
+ */
+
+#ifndef BENCH_ARDUINO_JSON_H
+#define BENCH_ARDUINO_JSON_H
+
+#include "Arduino.h"
+
+class JsonArray {
+public:
+  template <class T> bool add(const T&) { return true; }
+};
+
+class JsonVariant {
+public:
+  template <class T> JsonVariant& operator=(const T&) { return *this; }
+};
+
+class JsonObject {
+public:
+  JsonVariant operator[](const char*) { return JsonVariant(); }
+  JsonObject createNestedObject(const char*) { return JsonObject(); }
+  JsonArray createNestedArray(const char*) { return JsonArray(); }
+};
+
+#endif // BENCH_ARDUINO_JSON_H
@@ -0,0 +1,72 @@
+#!/usr/bin/env python3
+"""
+VRAM System - Benchmark Trace Converter
+Turns the server's access.log into a trace for vram_bench --trace
+"""
+
+import argparse
+import json
+import os
+import sys
+
+DEFAULT_PRIORITY = 3  # As the server reports resources without one
+
+def load_resources(metadata_file: str) -> dict:
+    """Size and priority per resource id, from the server's metadata.json"""
+    with open(metadata_file, 'r') as f:
+        metadata = json.load(f)
+    return metadata.get('resources', {})
+
+def convert(log_file, resources: dict, client: str, output) -> int:
+    """
+    Write one "<id> <size> <priority>" line per access to a known resource.
+    Deleted resources are skipped, since their size is gone with them.
+    Returns the number of lines written.
+    """
+    written = 0
+    skipped = 0
+    for line in log_file:
+        try:
+            entry = json.loads(line)
+            resource_id = entry['resource_id']
+        except (ValueError, KeyError):
+            continue
+        if client and entry.get('client_ip') != client:
+            continue
+        
+        resource = resources.get(resource_id)
+        if resource is None:
+            skipped += 1
+            continue
+        
+        output.write(f"{resource_id} {resource.get('size', 0)} {resource.get('priority', DEFAULT_PRIORITY)}\n")
+        written += 1
+    
+    if skipped:
+        print(f"Skipped {skipped} accesses to resources no longer in metadata", file=sys.stderr)
+    return written
+
+def main():
+    parser = argparse.ArgumentParser(description='Convert access.log into a vram_bench trace')
+    parser.add_argument('--resources', default=os.path.join(os.path.dirname(__file__), '..', 'server', 'resources'),
+                        help='Server resource directory holding access.log and metadata.json')
+    parser.add_argument('--client', help='Only accesses from this client IP, as one device would see them')
+    parser.add_argument('--output', help='Trace file to write (default stdout)')
+    args = parser.parse_args()
+    
+    log_path = os.path.join(args.resources, 'access.log')
+    resources = load_resources(os.path.join(args.resources, 'metadata.json'))
+    
+    output = open(args.output, 'w') if args.output else sys.stdout
+    try:
+        output.write(f"# Trace of {log_path}" + (f" for {args.client}" if args.client else "") + "\n")
+        with open(log_path, 'r') as log_file:
+            written = convert(log_file, resources, args.client, output)
+    finally:
+        if args.output:
+            output.close()
+    
+    print(f"Wrote {written} requests", file=sys.stderr)
+
+if __name__ == '__main__':
+    main()
@@ -0,0 +1,401 @@
+/*
+ * VRAM System - Host Benchmarks
+ * Microbenchmarks of MemoryManager and ResourceCache, and replay of an
+ * access trace through each eviction policy, built against the client
+ * headers with the shim in bench/shim
+ *
+ * Usage: vram_bench [--filter name] [--trace file] [--budget KB]
+ */
+
+// Keep refused stores and evictions off the terminal; errors still show.
+// `make check` builds it at DEBUG to type-check every log format.
+#ifndef VRAM_LOG_LEVEL
+#define VRAM_LOG_LEVEL VRAM_LOG_LEVEL_ERROR
+#endif
+
+#include <Arduino.h>
+#include <vector>
+#include <memory>
+#include <random>
+#include <cmath>
+#include "memory_manager.h"
+#include "resource_cache.h"
+#include "eviction_policy.h"
+#include "bench.h"
+
+// Benchmark configuration
+#define BENCH_ID_POOL          240       // Ids interned up front; the table holds RESOURCE_ID_MAX_NAMES
+#define BENCH_TRACKING_SLOTS   8192      // MemoryManager tracking table, above any benchmark's live blocks
+#define BENCH_ENTRY_SIZE       2048      // Payload of the cache microbenchmarks
+#define BENCH_CACHED_ENTRIES   128       // Entries held by the get benchmarks
+#define BENCH_EVICT_BUDGET     (64 * 1024)
+#define BENCH_CRITICAL_ENTRIES 160       // Entries ahead of the victims in the critical benchmarks
+#define BENCH_CRITICAL_SIZE    256
+#define BENCH_SYNTHETIC_LENGTH 50000     // Requests in the built-in trace
+#define BENCH_SYNTHETIC_HOT    150       // Zipf-distributed ids; the rest are scanned in bursts
+#define BENCH_SCAN_INTERVAL    2000      // Requests between scans
+#define BENCH_SEED             42
+
+ResourceIdTable resourceIds;
+MemoryManager memoryManager;
+
+struct TraceRequest {
+  uint16_t slot;      // Index into idPool
+  uint32_t size;
+  uint8_t priority;
+};
+
+static std::vector<ResourceId> idPool;
+static std::vector<TraceRequest> trace;
+static const char* traceName = "synthetic";
+static size_t traceSkipped = 0;           // Requests for ids past BENCH_ID_POOL, or oversized
+static size_t replayBudget = MAX_CACHE_SIZE;
+static uint8_t payload[MAX_RESOURCE_SIZE];
+
+// A cache with its own policy, freed together
+template <class Policy>
+struct BenchCache {
+  Policy policy;
+  ResourceCache cache;
+  
+  explicit BenchCache(size_t budget) {
+    cache.setEvictionPolicy(&policy);
+    cache.setMaxCacheSize(budget);
+  }
+};
+
+// PriorityPolicy is the cache's built-in default; this keeps the templates uniform
+struct DefaultPolicy : public PriorityPolicy {};
+
+static void fillCache(ResourceCache& cache, int count, size_t size) {
+  for (int i = 0; i < count; i++) {
+    cache.store(idPool[i], payload, size, PRIORITY_NORMAL);
+  }
+}
+
+// MemoryManager
+
+static unsigned long slabFallbacks() {
+  unsigned long total = 0;
+  for (int i = 0; i < SLAB_CLASS_COUNT; i++) {
+    total += memoryManager.getSlabClass(i).fallbacks;
+  }
+  return total;
+}
+
+static void benchAllocate(BenchState& state, size_t size) {
+  while (state.keepRunning()) {
+    void* block = memoryManager.allocate(size, idPool[0]);
+    memoryManager.deallocate(block);
+  }
+}
+
+static void BM_Allocate_64(BenchState& state) { benchAllocate(state, 48); }
+static void BM_Allocate_1K(BenchState& state) { benchAllocate(state, 1000); }
+static void BM_Allocate_16K(BenchState& state) { benchAllocate(state, 16000); }
+static void BM_Allocate_Heap(BenchState& state) { benchAllocate(state, 80000); }  // Above the largest slab
+BENCHMARK(BM_Allocate_64);
+BENCHMARK(BM_Allocate_1K);
+BENCHMARK(BM_Allocate_16K);
+BENCHMARK(BM_Allocate_Heap);
+
+// Sixteen live blocks of one class, more than it has slots, so some fall back to the heap
+static void BM_AllocateBurst_1K(BenchState& state) {
+  void* blocks[16];
+  unsigned long fallbacksBefore = slabFallbacks();
+  while (state.keepRunning()) {
+    for (int i = 0; i < 16; i++) {
+      blocks[i] = memoryManager.allocate(1000, idPool[i]);
+    }
+    for (int i = 15; i >= 0; i--) {
+      memoryManager.deallocate(blocks[i]);
+    }
+  }
+  state.setItemsProcessed(16);
+  state.setCounter("fallbacks_per_op", (double)(slabFallbacks() - fallbacksBefore) / state.getIterations());
+}
+BENCHMARK(BM_AllocateBurst_1K);
+
+// ResourceCache
+
+static void BM_CacheStoreNew(BenchState& state) {
+  std::unique_ptr<BenchCache<DefaultPolicy>> bench(new BenchCache<DefaultPolicy>(MAX_CACHE_SIZE));
+  int next = 0;
+  while (state.keepRunning()) {
+    if (next == BENCH_CACHED_ENTRIES / 2) {
+      state.pauseTiming();
+      bench->cache.clear();
+      next = 0;
+      state.resumeTiming();
+    }
+    bench->cache.store(idPool[next++], payload, BENCH_ENTRY_SIZE, PRIORITY_NORMAL);
+  }
+}
+BENCHMARK(BM_CacheStoreNew);
+
+static void BM_CacheStoreUpdate(BenchState& state) {
+  std::unique_ptr<BenchCache<DefaultPolicy>> bench(new BenchCache<DefaultPolicy>(MAX_CACHE_SIZE));
+  fillCache(bench->cache, BENCH_CACHED_ENTRIES / 2, BENCH_ENTRY_SIZE);
+  int next = 0;
+  while (state.keepRunning()) {
+    bench->cache.store(idPool[next], payload, BENCH_ENTRY_SIZE, PRIORITY_NORMAL);
+    next = (next + 1) % (BENCH_CACHED_ENTRIES / 2);
+  }
+}
+BENCHMARK(BM_CacheStoreUpdate);
+
+static void BM_CacheGetHit(BenchState& state) {
+  std::unique_ptr<BenchCache<DefaultPolicy>> bench(new BenchCache<DefaultPolicy>(MAX_CACHE_SIZE));
+  fillCache(bench->cache, BENCH_CACHED_ENTRIES / 2, BENCH_ENTRY_SIZE);
+  uint8_t buffer[BENCH_ENTRY_SIZE];
+  size_t length;
+  int next = 0;
+  while (state.keepRunning()) {
+    bench->cache.getInto(idPool[next], buffer, sizeof(buffer), length);
+    next = (next + 7) % (BENCH_CACHED_ENTRIES / 2);
+  }
+  state.setCounter("hit_rate", bench->cache.getHitRate());
+}
+BENCHMARK(BM_CacheGetHit);
+
+static void BM_CacheViewHit(BenchState& state) {
+  std::unique_ptr<BenchCache<DefaultPolicy>> bench(new BenchCache<DefaultPolicy>(MAX_CACHE_SIZE));
+  fillCache(bench->cache, BENCH_CACHED_ENTRIES / 2, BENCH_ENTRY_SIZE);
+  int next = 0;
+  while (state.keepRunning()) {
+    ResourceView view = bench->cache.view(idPool[next]);
+    next = (next + 7) % (BENCH_CACHED_ENTRIES / 2);
+  }
+}
+BENCHMARK(BM_CacheViewHit);
+
+static void BM_CacheGetMiss(BenchState& state) {
+  std::unique_ptr<BenchCache<DefaultPolicy>> bench(new BenchCache<DefaultPolicy>(MAX_CACHE_SIZE));
+  fillCache(bench->cache, BENCH_CACHED_ENTRIES / 2, BENCH_ENTRY_SIZE);
+  uint8_t buffer[BENCH_ENTRY_SIZE];
+  size_t length;
+  int next = BENCH_CACHED_ENTRIES;
+  while (state.keepRunning()) {
+    bench->cache.getInto(idPool[next], buffer, sizeof(buffer), length);
+    next = next + 1 < BENCH_ID_POOL ? next + 1 : BENCH_CACHED_ENTRIES;
+  }
+}
+BENCHMARK(BM_CacheGetMiss);
+
+// Every store lands in a full cache and evicts about one entry
+template <class Policy>
+static void benchStoreEvict(BenchState& state) {
+  std::unique_ptr<BenchCache<Policy>> bench(new BenchCache<Policy>(BENCH_EVICT_BUDGET));
+  fillCache(bench->cache, BENCH_EVICT_BUDGET / BENCH_ENTRY_SIZE, BENCH_ENTRY_SIZE);
+  int next = 0;
+  int evictionsBefore = bench->cache.getEvictions();
+  uint64_t refused = 0;
+  while (state.keepRunning()) {
+    if (!bench->cache.store(idPool[next], payload, BENCH_ENTRY_SIZE, PRIORITY_NORMAL)) {
+      refused++;
+    }
+    next = (next + 1) % BENCH_ID_POOL;
+  }
+  state.setCounter("evictions_per_op", (double)(bench->cache.getEvictions() - evictionsBefore) / state.getIterations());
+  state.setCounter("refused", (double)refused / state.getIterations());
+}
+
+static void BM_CacheStoreEvict_Priority(BenchState& state) { benchStoreEvict<DefaultPolicy>(state); }
+static void BM_CacheStoreEvict_LRU(BenchState& state) { benchStoreEvict<LruPolicy>(state); }
+static void BM_CacheStoreEvict_LFU(BenchState& state) { benchStoreEvict<LfuPolicy>(state); }
+static void BM_CacheStoreEvict_TinyLFU(BenchState& state) { benchStoreEvict<TinyLfuPolicy>(state); }
+BENCHMARK(BM_CacheStoreEvict_Priority);
+BENCHMARK(BM_CacheStoreEvict_LRU);
+BENCHMARK(BM_CacheStoreEvict_LFU);
+BENCHMARK(BM_CacheStoreEvict_TinyLFU);
+
+// Low priority stores evicting each other while critical entries, older
+// and never eligible, make up most of the cache
+template <class Policy>
+static void benchStoreEvictCritical(BenchState& state) {
+  size_t budget = (BENCH_CRITICAL_ENTRIES + 16) * (BENCH_CRITICAL_SIZE + CACHE_ENTRY_OVERHEAD);
+  std::unique_ptr<BenchCache<Policy>> bench(new BenchCache<Policy>(budget));
+  for (int i = 0; i < BENCH_CRITICAL_ENTRIES; i++) {
+    bench->cache.store(idPool[i], payload, BENCH_CRITICAL_SIZE, PRIORITY_CRITICAL);
+  }
+  int next = BENCH_CRITICAL_ENTRIES;
+  uint64_t refused = 0;
+  while (state.keepRunning()) {
+    if (!bench->cache.store(idPool[next], payload, BENCH_CRITICAL_SIZE, PRIORITY_LOW)) {
+      refused++;
+    }
+    next = next + 1 < BENCH_ID_POOL ? next + 1 : BENCH_CRITICAL_ENTRIES;
+  }
+  state.setCounter("refused", (double)refused / state.getIterations());
+}
+
+static void BM_CacheStoreEvictCritical_LRU(BenchState& state) { benchStoreEvictCritical<LruPolicy>(state); }
+static void BM_CacheStoreEvictCritical_LFU(BenchState& state) { benchStoreEvictCritical<LfuPolicy>(state); }
+static void BM_CacheStoreEvictCritical_TinyLFU(BenchState& state) { benchStoreEvictCritical<TinyLfuPolicy>(state); }
+BENCHMARK(BM_CacheStoreEvictCritical_LRU);
+BENCHMARK(BM_CacheStoreEvictCritical_LFU);
+BENCHMARK(BM_CacheStoreEvictCritical_TinyLFU);
+
+// freeMemory() of one BUDGET_STEP, refilling when the cache runs low
+static void BM_CacheFreeMemory(BenchState& state) {
+  std::unique_ptr<BenchCache<DefaultPolicy>> bench(new BenchCache<DefaultPolicy>(MAX_CACHE_SIZE));
+  fillCache(bench->cache, BENCH_CACHED_ENTRIES, BENCH_ENTRY_SIZE);
+  uint64_t freed = 0;
+  while (state.keepRunning()) {
+    if (bench->cache.getResourceCount() < BENCH_CACHED_ENTRIES / 4) {
+      state.pauseTiming();
+      fillCache(bench->cache, BENCH_CACHED_ENTRIES, BENCH_ENTRY_SIZE);
+      state.resumeTiming();
+    }
+    freed += bench->cache.freeMemory(BUDGET_STEP);
+  }
+  state.setCounter("entries_per_op", (double)freed / state.getIterations());
+}
+BENCHMARK(BM_CacheFreeMemory);
+
+// Trace replay: a miss fetches the resource, as the client would
+
+template <class Policy>
+static void replayTrace(BenchState& state) {
+  std::unique_ptr<BenchCache<Policy>> bench(new BenchCache<Policy>(replayBudget));
+  ResourceCache& cache = bench->cache;
+  size_t peakBytes = 0;
+  size_t refused = 0;
+  memoryManager.resetStatistics();
+  size_t heapBefore = memoryManager.getTotalAllocated();
+  
+  while (state.keepRunning()) {
+    for (const TraceRequest& request : trace) {
+      ResourceView view = cache.view(idPool[request.slot]);
+      if (view.isValid()) {
+        continue;
+      }
+      if (!cache.store(idPool[request.slot], payload, request.size, request.priority)) {
+        refused++;
+      }
+      peakBytes = max(peakBytes, cache.getCacheSize());
+    }
+  }
+  
+  state.setItemsProcessed(trace.size());
+  state.setCounter("hit_rate", cache.getHitRate());
+  state.setCounter("peak_kb", peakBytes / 1024.0);
+  state.setCounter("heap_peak_kb", (memoryManager.getPeakUsage() - heapBefore) / 1024.0);
+  state.setCounter("evictions", cache.getEvictions());
+  state.setCounter("refused", refused);
+}
+
+static void BM_Replay_Priority(BenchState& state) { replayTrace<DefaultPolicy>(state); }
+static void BM_Replay_LRU(BenchState& state) { replayTrace<LruPolicy>(state); }
+static void BM_Replay_LFU(BenchState& state) { replayTrace<LfuPolicy>(state); }
+static void BM_Replay_TinyLFU(BenchState& state) { replayTrace<TinyLfuPolicy>(state); }
+BENCHMARK_FIXED(BM_Replay_Priority, 1);
+BENCHMARK_FIXED(BM_Replay_LRU, 1);
+BENCHMARK_FIXED(BM_Replay_LFU, 1);
+BENCHMARK_FIXED(BM_Replay_TinyLFU, 1);
+
+// Traces
+
+// Zipf-popular hot set with periodic scans over the rest, like data_* sweeps
+static void buildSyntheticTrace() {
+  std::mt19937 generator(BENCH_SEED);
+  std::vector<double> weights;
+  for (int i = 0; i < BENCH_SYNTHETIC_HOT; i++) {
+    weights.push_back(1.0 / (i + 1));
+  }
+  std::discrete_distribution<int> popularity(weights.begin(), weights.end());
+  std::uniform_int_distribution<int> sizes(512, 8192);
+  
+  std::vector<uint32_t> sizeOf(BENCH_ID_POOL);
+  for (int i = 0; i < BENCH_ID_POOL; i++) {
+    sizeOf[i] = sizes(generator);
+  }
+  
+  for (int i = 0; i < BENCH_SYNTHETIC_LENGTH; i++) {
+    if (i % BENCH_SCAN_INTERVAL == BENCH_SCAN_INTERVAL - 1) {
+      for (int slot = BENCH_SYNTHETIC_HOT; slot < BENCH_ID_POOL; slot++) {
+        trace.push_back({ (uint16_t)slot, sizeOf[slot], PRIORITY_LOW });
+      }
+      continue;
+    }
+    int slot = popularity(generator);
+    uint8_t priority = slot < 5 ? PRIORITY_CRITICAL : (slot < 20 ? PRIORITY_IMPORTANT : PRIORITY_NORMAL);
+    trace.push_back({ (uint16_t)slot, sizeOf[slot], priority });
+  }
+}
+
+// Lines of "<id> <size> <priority>", as written by trace_from_log.py
+static bool loadTrace(const char* path) {
+  FILE* file = fopen(path, "r");
+  if (file == nullptr) {
+    fprintf(stderr, "Cannot open trace %s\n", path);
+    return false;
+  }
+  
+  std::vector<std::string> names;
+  char line[160];
+  while (fgets(line, sizeof(line), file) != nullptr) {
+    char name[RESOURCE_ID_MAX_LENGTH + 1];
+    unsigned long size;
+    int priority;
+    if (line[0] == '#' || sscanf(line, "%63s %lu %d", name, &size, &priority) != 3) {
+      continue;
+    }
+    
+    // Names are mapped onto the interned pool in order of first use
+    size_t slot = std::find(names.begin(), names.end(), name) - names.begin();
+    if (slot == names.size()) {
+      if (names.size() >= BENCH_ID_POOL) {
+        traceSkipped++;
+        continue;
+      }
+      names.push_back(name);
+    }
+    if (size > MAX_RESOURCE_SIZE) {
+      traceSkipped++;
+      continue;
+    }
+    trace.push_back({ (uint16_t)slot, (uint32_t)size, (uint8_t)constrain(priority, PRIORITY_CRITICAL, PRIORITY_LOW) });
+  }
+  
+  fclose(file);
+  traceName = path;
+  return !trace.empty();
+}
+
+int main(int argc, char** argv) {
+  const char* filter = nullptr;
+  const char* tracePath = nullptr;
+  for (int i = 1; i < argc; i++) {
+    if (strcmp(argv[i], "--filter") == 0 && i + 1 < argc) {
+      filter = argv[++i];
+    } else if (strcmp(argv[i], "--trace") == 0 && i + 1 < argc) {
+      tracePath = argv[++i];
+    } else if (strcmp(argv[i], "--budget") == 0 && i + 1 < argc) {
+      replayBudget = (size_t)atol(argv[++i]) * 1024;
+    } else {
+      fprintf(stderr, "Usage: %s [--filter name] [--trace file] [--budget KB]\n", argv[0]);
+      return 2;
+    }
+  }
+  
+  memoryManager.begin(BENCH_TRACKING_SLOTS);
+  for (int i = 0; i < BENCH_ID_POOL; i++) {
+    char name[16];
+    snprintf(name, sizeof(name), "bench_%d", i);
+    idPool.push_back(ResourceId(name));
+  }
+  memset(payload, 'v', sizeof(payload));
+  
+  if (tracePath != nullptr) {
+    if (!loadTrace(tracePath)) {
+      return 1;
+    }
+  } else {
+    buildSyntheticTrace();
+  }
+  
+  printf("Trace: %s, %zu requests (%zu skipped), replay budget %zu KB\n",
+         traceName, trace.size(), traceSkipped, replayBudget / 1024);
+  return BenchRunner::runAll(filter) > 0 ? 0 : 1;
+}
@@ -26,6 +26,7 @@ const char* WIFI_PASSWORD = "your_wifi_password";
 const char* SERVER_URL = "http://192.168.1.100:5000";  // Change to your server IP
 
 // Global objects
+ResourceIdTable resourceIds;
 MemoryManager memoryManager;
 ResourceCache resourceCache;
 WiFiManager wifiManager;
@@ -147,7 +148,8 @@ void connectToWiFi() {
   Serial.println("Connecting to WiFi...");
   showStatus("Connecting WiFi...");
   
-  if (wifiManager.connect()) {
+  wifiManager.connect();
+  if (wifiManager.waitForConnection()) {
     Serial.println("✓ WiFi connected successfully");
     showStatus("WiFi Connected!");
     
@@ -204,17 +206,20 @@ void loadDemoResources() {
 bool loadResource(const String& resourceId, int priority) {
   Serial.printf("Loading resource: %s (priority: %d)\n", resourceId.c_str(), priority);
   
-  HTTPClient http;
-  String url = wifiManager.getServerURL() + "/api/resources/" + resourceId;
-  
-  http.begin(url);
-  http.setTimeout(10000);
+  // Requests share the manager's keep-alive connection
+  if (!wifiManager.beginRequest("/api/resources/" + resourceId, 10000)) {
+    Serial.println("✗ WiFi not connected");
+    return false;
+  }
   
-  int httpCode = http.GET();
+  HTTPClient& http = wifiManager.getHTTPClient();
+  int httpCode = wifiManager.sendRequest("GET");
   bool success = false;
   
+  // Read the body even on errors so the socket can be reused
+  String payload = httpCode > 0 ? http.getString() : String();
+  
   if (httpCode == HTTP_CODE_OK) {
-    String payload = http.getString();
     
     // Parse JSON response
     DynamicJsonDocument doc(4096);
@@ -225,7 +230,7 @@ bool loadResource(const String& resourceId, int priority) {
       int size = doc["size"] | data.length();
       
       // Store in cache
-      success = resourceCache.store(resourceId, data, priority, size);
+      success = resourceCache.store(resourceId, data, priority);
       
       if (success) {
         Serial.printf("✓ Resource %s cached (%d bytes)\n", resourceId.c_str(), size);
@@ -239,7 +244,7 @@ bool loadResource(const String& resourceId, int priority) {
     Serial.printf("✗ HTTP error for %s: %d\n", resourceId.c_str(), httpCode);
   }
   
-  http.end();
+  wifiManager.endRequest();
   return success;
 }
 
@@ -284,7 +289,7 @@ void handleButtonB() {
   
   // Free memory
   M5.Display.setTextColor(GREEN);
-  sprintf(buffer, "Free: %d KB", memInfo.freeHeap / 1024);
+  sprintf(buffer, "Free: %u KB", (unsigned)(memInfo.freeHeap / 1024));
   M5.Display.drawString(buffer, M5.Display.width() / 2, 50);
   
   // Cache info
@@ -369,32 +374,33 @@ void runAutomatedDemo() {
 }
 
 void demonstrateResourceRetrieval() {
-  // Try to get a cached resource
-  String data = resourceCache.get("config_main");
-  if (!data.isEmpty()) {
-    Serial.printf("✓ Retrieved cached resource: %s\n", data.substring(0, 50).c_str());
+  // Read a cached resource in place; the view pins it until it goes out of scope
+  ResourceView data = resourceCache.view(ResourceId::find("config_main"));
+  if (data.isValid()) {
+    Serial.printf("✓ Retrieved cached resource: %.50s\n", data.c_str());
   } else {
     Serial.println("✗ Resource not in cache, would need to fetch from server");
   }
 }
 
 void demonstrateCacheHitMiss() {
-  // Access existing resource (cache hit)
-  String hit = resourceCache.get("ui_strings");
+  // Access existing resource (cache hit); find() looks a name up without
+  // adding it to the id table
+  ResourceView hit = resourceCache.view(ResourceId::find("ui_strings"));
   
   // Access non-existing resource (cache miss)
-  String miss = resourceCache.get("nonexistent_resource");
+  ResourceView miss = resourceCache.view(ResourceId::find("nonexistent_resource"));
   
   Serial.printf("Cache hit: %s, Cache miss: %s\n", 
-                hit.isEmpty() ? "false" : "true",
-                miss.isEmpty() ? "true" : "false");
+                hit.isValid() ? "true" : "false",
+                miss.isValid() ? "false" : "true");
 }
 
 void demonstrateMemoryMonitoring() {
   MemoryInfo memInfo = memoryManager.getMemoryInfo();
   
-  Serial.printf("Memory usage: %d%% (%d/%d bytes)\n", 
-                memInfo.usagePercent, memInfo.usedHeap, memInfo.totalHeap);
+  Serial.printf("Memory usage: %d%% (%u/%u bytes)\n", 
+                memInfo.usagePercent, (unsigned)memInfo.usedHeap, (unsigned)memInfo.totalHeap);
   Serial.printf("Cache utilization: %.1f%% (%d items)\n", 
                 resourceCache.getCacheUtilization() * 100, 
                 resourceCache.getResourceCount());
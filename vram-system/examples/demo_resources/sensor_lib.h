@@ -1,6 +1,7 @@
 /*
  * Sensor Library for M5StickC Plus2
- * Provides functions for reading various sensors
+ * Provides functions for reading various sensors, and a ring buffer of
+ * timestamped samples packed for bulk upload
  */
 
 #ifndef SENSOR_LIB_H
@@ -8,12 +9,137 @@
 
 #include <Arduino.h>
 
+// Sample buffer configuration
+#define SENSOR_RING_CAPACITY     256      // Samples held between uploads; the oldest is overwritten when full
+#define SENSOR_UPLOAD_WATERMARK  192      // Upload once this many are waiting
+#define SENSOR_PIGGYBACK_MIN     16       // Upload this many early if the radio is awake anyway
+#define SENSOR_UPLOAD_MAX_AGE    600000   // Never hold a sample longer than this (ms)
+#define SENSOR_PACK_VERSION      1
+#define SENSOR_SAMPLE_MAX_BYTES  14       // Worst case packed sample: 5 + 3 + 3 + 3 varint bytes
+#define SENSOR_PACK_HEADER_MAX   14       // Version, count, sequence and age
+#define SENSOR_CONTENT_TYPE      "application/x-vram-samples"
+
+// Fixed point, so samples delta-encode into a byte or two
+struct SensorSample {
+  uint32_t timestamp;    // millis()
+  int16_t temperature;   // 0.1 degC
+  uint16_t humidity;     // 0.1 %
+  uint8_t battery;       // %
+};
+
+/*
+ * Fixed-capacity buffer of samples, allocation-free. pack() writes the
+ * oldest samples into a caller's buffer without removing them; consume()
+ * drops them once the server has acknowledged the upload, so a failed
+ * upload loses nothing.
+ *
+ * Packed format, all integers LEB128 varints:
+ *   version (byte), count, sequence of the first sample,
+ *   age of the first sample in ms at packing time,
+ *   then per sample: ms since the previous sample (0 for the first),
+ *   and the zigzag deltas of temperature, humidity and battery from the
+ *   previous sample (from zero for the first).
+ * Sequence numbers let the server drop samples a retried upload repeats.
+ */
+class SensorRing {
+private:
+  SensorSample samples[SENSOR_RING_CAPACITY];
+  uint16_t head;           // Oldest sample
+  uint16_t count;
+  uint32_t headSequence;   // Sequence number of samples[head]
+  uint32_t dropped;        // Overwritten before they were uploaded
+  
+  static size_t putVarint(uint8_t* out, uint32_t value) {
+    size_t length = 0;
+    while (value >= 0x80) {
+      out[length++] = (uint8_t)(value | 0x80);
+      value >>= 7;
+    }
+    out[length++] = (uint8_t)value;
+    return length;
+  }
+  
+  static uint32_t zigzag(int32_t value) {
+    return ((uint32_t)value << 1) ^ (uint32_t)(value >> 31);
+  }
+  
+public:
+  SensorRing() : head(0), count(0), headSequence(0), dropped(0) {}
+  
+  void push(const SensorSample& sample) {
+    if (count == SENSOR_RING_CAPACITY) {
+      head = (head + 1) % SENSOR_RING_CAPACITY;
+      headSequence++;
+      count--;
+      dropped++;
+    }
+    samples[(head + count) % SENSOR_RING_CAPACITY] = sample;
+    count++;
+  }
+  
+  // Pack as many of the oldest samples as fit; returns the bytes written
+  // and sets packed to the number of samples they hold
+  size_t pack(uint8_t* buffer, size_t size, unsigned long now, uint16_t& packed) const {
+    packed = 0;
+    if (count == 0 || size < SENSOR_PACK_HEADER_MAX + SENSOR_SAMPLE_MAX_BYTES) {
+      return 0;
+    }
+    
+    // Samples go after room for the largest header, which moves up once
+    // the count is known
+    const SensorSample& first = samples[head];
+    SensorSample previous = { first.timestamp, 0, 0, 0 };
+    size_t body = SENSOR_PACK_HEADER_MAX;
+    uint16_t fit = 0;
+    while (fit < count && body + SENSOR_SAMPLE_MAX_BYTES <= size) {
+      const SensorSample& sample = samples[(head + fit) % SENSOR_RING_CAPACITY];
+      body += putVarint(buffer + body, sample.timestamp - previous.timestamp);
+      body += putVarint(buffer + body, zigzag(sample.temperature - previous.temperature));
+      body += putVarint(buffer + body, zigzag((int32_t)sample.humidity - previous.humidity));
+      body += putVarint(buffer + body, zigzag((int32_t)sample.battery - previous.battery));
+      previous = sample;
+      fit++;
+    }
+    
+    uint8_t header[SENSOR_PACK_HEADER_MAX];
+    size_t length = 0;
+    header[length++] = SENSOR_PACK_VERSION;
+    length += putVarint(header + length, fit);
+    length += putVarint(header + length, headSequence);
+    length += putVarint(header + length, now - first.timestamp);
+    
+    memmove(buffer + length, buffer + SENSOR_PACK_HEADER_MAX, body - SENSOR_PACK_HEADER_MAX);
+    memcpy(buffer, header, length);
+    
+    packed = fit;
+    return length + body - SENSOR_PACK_HEADER_MAX;
+  }
+  
+  // Drop the oldest samples after the server accepted them
+  void consume(uint16_t samplesUploaded) {
+    samplesUploaded = min(samplesUploaded, count);
+    head = (head + samplesUploaded) % SENSOR_RING_CAPACITY;
+    headSequence += samplesUploaded;
+    count -= samplesUploaded;
+  }
+  
+  uint16_t size() const { return count; }
+  bool isEmpty() const { return count == 0; }
+  uint32_t getDropped() const { return dropped; }
+  
+  // Age of the oldest waiting sample, 0 when empty
+  unsigned long oldestAge(unsigned long now) const {
+    return count > 0 ? now - samples[head].timestamp : 0;
+  }
+};
+
 class SensorManager {
 private:
   bool initialized;
   float lastTemperature;
   float lastHumidity;
   int lastBatteryLevel;
+  SensorRing ring;
   
 public:
   SensorManager() : initialized(false), lastTemperature(0), lastHumidity(0), lastBatteryLevel(0) {}
@@ -45,6 +171,29 @@ public:
     return lastBatteryLevel;
   }
   
+  // Read every sensor into one buffered sample
+  bool sample(unsigned long now) {
+    if (!initialized) return false;
+    
+    SensorSample reading;
+    reading.timestamp = now;
+    reading.temperature = (int16_t)lroundf(readTemperature() * 10);
+    reading.humidity = (uint16_t)constrain(lroundf(readHumidity() * 10), 0, 1000);
+    reading.battery = (uint8_t)constrain(readBatteryLevel(), 0, 100);
+    ring.push(reading);
+    return true;
+  }
+  
+  // Upload when the buffer reaches its watermark, when the oldest sample
+  // has waited long enough, or early if the radio is already awake
+  bool isUploadDue(unsigned long now, bool radioActive) {
+    if (ring.size() >= SENSOR_UPLOAD_WATERMARK) return true;
+    if (ring.oldestAge(now) >= SENSOR_UPLOAD_MAX_AGE) return true;
+    return radioActive && ring.size() >= SENSOR_PIGGYBACK_MIN;
+  }
+  
+  SensorRing& getBuffer() { return ring; }
+  
   void printSensorData() {
     Serial.printf("Temperature: %.1f°C, Humidity: %.1f%%, Battery: %d%%\n",
                   lastTemperature, lastHumidity, lastBatteryLevel);
@@ -0,0 +1,148 @@
+/*
+ * VRAM System - Sensor Node Example
+ * Buffers sensor samples and uploads them in bulk
+ *
+ * This example shows how to:
+ * - Sample sensors into an allocation-free ring buffer
+ * - Pack samples with delta/varint encoding
+ * - Upload a batch over the shared keep-alive connection when the buffer
+ *   reaches its watermark, or early when the radio is awake anyway
+ * - Let the WiFi modem sleep between uploads
+ */
+
+#include <M5StickCPlus2.h>
+#include <WiFi.h>
+#include <HTTPClient.h>
+
+#include "../m5client/memory_manager.h"
+#include "../m5client/wifi_manager.h"
+#include "demo_resources/sensor_lib.h"
+
+// Configuration - CHANGE THESE FOR YOUR SETUP
+const char* WIFI_SSID = "your_wifi_ssid";
+const char* WIFI_PASSWORD = "your_wifi_password";
+const char* SERVER_URL = "http://192.168.1.100:5000";  // Change to your server IP
+
+#define SENSOR_SAMPLE_INTERVAL 10000   // One sample of every sensor per 10 seconds
+#define SENSOR_UPLOAD_PATH     "/api/sensors"
+#define SENSOR_UPLOAD_TIMEOUT  5000
+#define SENSOR_PACK_SIZE       2048    // A full watermark of samples at 5-8 bytes each
+#define SENSOR_RETRY_INTERVAL  30000   // After a failed upload; retrying every loop would keep the radio up
+
+// Global objects
+ResourceIdTable resourceIds;
+MemoryManager memoryManager;
+WiFiManager wifiManager;
+SensorManager sensors;
+
+// Upload state
+uint8_t packBuffer[SENSOR_PACK_SIZE];  // Static, so an upload never allocates
+char bootId[9];  // Random per boot; tells the server sequence numbers restarted
+unsigned long lastSample = 0;
+unsigned long lastFailure = 0;
+unsigned long uploads = 0;
+unsigned long uploadFailures = 0;
+unsigned long samplesUploaded = 0;
+
+void setup() {
+  auto cfg = M5.config();
+  M5.begin(cfg);
+  M5.Display.setRotation(1);
+  M5.Display.setTextColor(GREEN);
+  M5.Display.setTextDatum(middle_center);
+  M5.Display.setFont(&fonts::Orbitron_Light_24);
+  M5.Display.setTextSize(1);
+  
+  Serial.begin(115200);
+  delay(1000);
+  
+  Serial.println("=== VRAM Sensor Node ===");
+  M5.Display.clear();
+  M5.Display.drawString("Sensor Node", M5.Display.width() / 2, M5.Display.height() / 2);
+  
+  memoryManager.begin();
+  sensors.begin();
+  snprintf(bootId, sizeof(bootId), "%08lx", (unsigned long)esp_random());
+  
+  // Between uploads nothing is sent, so the modem can sleep through beacons
+  wifiManager.setCredentials(WIFI_SSID, WIFI_PASSWORD);
+  wifiManager.setServerURL(SERVER_URL);
+  wifiManager.setPowerSave(true);
+  wifiManager.connect();
+}
+
+void loop() {
+  M5.update();
+  wifiManager.update();
+  
+  unsigned long now = millis();
+  if (now - lastSample >= SENSOR_SAMPLE_INTERVAL) {
+    sensors.sample(now);
+    lastSample = now;
+  }
+  
+  // Piggyback on traffic that already woke the radio, else wait for the watermark
+  bool retryWait = lastFailure != 0 && now - lastFailure < SENSOR_RETRY_INTERVAL;
+  if (wifiManager.isConnected() && !retryWait && sensors.isUploadDue(now, wifiManager.isRadioActive())) {
+    uploadSamples();
+  }
+  
+  // Button A: upload now and show the counters
+  if (M5.BtnA.wasPressed()) {
+    uploadSamples();
+    printUploadStats();
+  }
+  
+  delay(100);
+}
+
+// POST the oldest buffered samples; they leave the buffer only once the
+// server has accepted them, so a failed upload is retried with the next
+bool uploadSamples() {
+  SensorRing& buffer = sensors.getBuffer();
+  uint16_t packed = 0;
+  size_t length = buffer.pack(packBuffer, sizeof(packBuffer), millis(), packed);
+  if (packed == 0) {
+    return false;
+  }
+  
+  if (!wifiManager.beginRequest(SENSOR_UPLOAD_PATH, SENSOR_UPLOAD_TIMEOUT)) {
+    lastFailure = millis();
+    return false;
+  }
+  wifiManager.addHeader("Content-Type", SENSOR_CONTENT_TYPE);
+  wifiManager.addHeader("X-Device-Id", wifiManager.getMACAddress());
+  wifiManager.addHeader("X-Boot-Id", bootId);
+  
+  int httpCode = wifiManager.sendRequest("POST", packBuffer, length);
+  if (httpCode > 0) {
+    wifiManager.getHTTPClient().getString();  // Drain the body so the socket stays usable
+  }
+  wifiManager.endRequest();
+  
+  if (httpCode != HTTP_CODE_OK) {
+    uploadFailures++;
+    lastFailure = millis();
+    Serial.printf("Sensor upload failed: %d, %d samples kept\n", httpCode, buffer.size());
+    return false;
+  }
+  
+  buffer.consume(packed);
+  lastFailure = 0;
+  uploads++;
+  samplesUploaded += packed;
+  Serial.printf("Uploaded %d samples in %u bytes\n", packed, (unsigned)length);
+  return true;
+}
+
+void printUploadStats() {
+  SensorRing& buffer = sensors.getBuffer();
+  Serial.println("=== Sensor Upload Stats ===");
+  Serial.printf("Uploads: %lu (%lu failed)\n", uploads, uploadFailures);
+  Serial.printf("Samples uploaded: %lu, buffered: %d, dropped: %lu\n",
+                samplesUploaded, buffer.size(), (unsigned long)buffer.getDropped());
+  if (uploads > 0) {
+    Serial.printf("Samples per upload: %.1f\n", (float)samplesUploaded / uploads);
+  }
+  sensors.printSensorData();
+}
@@ -0,0 +1,302 @@
+/*
+ * Cache Snapshot for VRAM System
+ * Persists critical and important cache entries to LittleFS for warm starts
+ */
+
+#ifndef CACHE_SNAPSHOT_H
+#define CACHE_SNAPSHOT_H
+
+#include <Arduino.h>
+#include "vram_log.h"
+#include <FS.h>
+#include <LittleFS.h>
+#include "memory_manager.h"
+#include "resource_cache.h"
+#include "inflate.h"
+
+// Snapshot configuration
+#define SNAPSHOT_PATH            "/cache.snap"
+#define SNAPSHOT_TEMP_PATH       "/cache.snap.tmp"
+#define SNAPSHOT_MAGIC           0x50414E53   // "SNAP"
+#define SNAPSHOT_FORMAT_VERSION  1
+#define SNAPSHOT_MAX_ENTRIES     32
+#define SNAPSHOT_HASH_SIZE       32           // SHA-256 kept as raw bytes
+#define SNAPSHOT_SAVE_INTERVAL   60000        // Limit flash writes to once a minute
+
+/*
+ * File layout:
+ *   SnapshotHeader
+ *   SnapshotRecord[count]   index, readable without touching payloads
+ *   for each record at its offset: resource id bytes, then payload bytes
+ */
+struct SnapshotHeader {
+  uint32_t magic;
+  uint16_t formatVersion;
+  uint16_t count;
+};
+
+struct SnapshotRecord {
+  uint32_t offset;      // Start of the id bytes
+  uint32_t length;      // Payload length
+  uint32_t crc;         // CRC-32 of the payload
+  uint32_t version;
+  uint8_t priority;
+  uint8_t idLength;
+  uint8_t hash[SNAPSHOT_HASH_SIZE];
+  uint8_t reserved[2];
+};
+
+class CacheSnapshot {
+private:
+  bool mounted;
+  unsigned long savedGeneration;
+  unsigned long lastSaveTime;
+  int restoredCount;
+  
+  bool restoreRecord(File& file, const SnapshotRecord& record, ResourceCache& cache);
+  
+public:
+  CacheSnapshot();
+  
+  // Encoding helpers, shared with the flash cache tier
+  static uint32_t checksum(const uint8_t* data, size_t length);
+  static void hashToBytes(const String& hash, uint8_t* bytes);
+  static String bytesToHash(const uint8_t* bytes);
+  
+  // Mount LittleFS, formatting it on first use
+  bool begin();
+  
+  // Load the snapshot into the cache; returns the number of entries restored
+  int restore(ResourceCache& cache);
+  
+  // Write CRITICAL/IMPORTANT entries, replacing the previous snapshot
+  bool save(ResourceCache& cache);
+  
+  // Save if persistent entries changed, at most every SNAPSHOT_SAVE_INTERVAL
+  void update(ResourceCache& cache);
+  
+  void erase();
+  int getRestoredCount() { return restoredCount; }
+};
+
+// Implementation
+CacheSnapshot::CacheSnapshot() {
+  mounted = false;
+  savedGeneration = 0;
+  lastSaveTime = 0;
+  restoredCount = 0;
+}
+
+bool CacheSnapshot::begin() {
+  mounted = LittleFS.begin(true);
+  if (!mounted) {
+    VRAM_LOGW("Snapshot: LittleFS mount failed");
+  }
+  return mounted;
+}
+
+int CacheSnapshot::restore(ResourceCache& cache) {
+  restoredCount = 0;
+  if (!mounted) return 0;
+  
+  File file = LittleFS.open(SNAPSHOT_PATH, FILE_READ);
+  if (!file) {
+    VRAM_LOGI("Snapshot: none found, cold start");
+    return 0;
+  }
+  
+  SnapshotHeader header;
+  if (file.read((uint8_t*)&header, sizeof(header)) != sizeof(header) ||
+      header.magic != SNAPSHOT_MAGIC ||
+      header.formatVersion != SNAPSHOT_FORMAT_VERSION ||
+      header.count > SNAPSHOT_MAX_ENTRIES) {
+    VRAM_LOGW("Snapshot: unrecognised file, ignoring");
+    file.close();
+    return 0;
+  }
+  
+  for (uint16_t i = 0; i < header.count; i++) {
+    SnapshotRecord record;
+    file.seek(sizeof(SnapshotHeader) + i * sizeof(SnapshotRecord));
+    if (file.read((uint8_t*)&record, sizeof(record)) != sizeof(record)) {
+      VRAM_LOGW("Snapshot: index truncated");
+      break;
+    }
+    
+    if (restoreRecord(file, record, cache)) {
+      restoredCount++;
+    }
+  }
+  
+  file.close();
+  
+  // What was just loaded is already on flash
+  savedGeneration = cache.getPersistGeneration();
+  
+  VRAM_LOGI("Snapshot: restored %d of %d entries", restoredCount, header.count);
+  return restoredCount;
+}
+
+bool CacheSnapshot::restoreRecord(File& file, const SnapshotRecord& record, ResourceCache& cache) {
+  if (record.length > MAX_RESOURCE_SIZE || record.idLength > RESOURCE_ID_MAX_LENGTH) {
+    return false;
+  }
+  
+  char id[RESOURCE_ID_MAX_LENGTH];
+  file.seek(record.offset);
+  if (file.read((uint8_t*)id, record.idLength) != record.idLength) {
+    return false;
+  }
+  
+  ResourceId resourceId(id, record.idLength);
+  if (!resourceId.isValid()) {
+    return false;
+  }
+  
+  // Read straight into the buffer the cache will own
+  uint8_t* data = (uint8_t*)VRAM_MALLOC(record.length + 1, resourceId);
+  if (data == nullptr) {
+    return false;
+  }
+  
+  if (file.read(data, record.length) != record.length ||
+      checksum(data, record.length) != record.crc) {
+    VRAM_LOGW("Snapshot: entry %s is corrupt", resourceId.c_str());
+    VRAM_FREE(data);
+    return false;
+  }
+  data[record.length] = '\0';
+  
+  if (!cache.adopt(resourceId, data, record.length, record.priority)) {
+    return false;
+  }
+  
+  cache.setVersion(resourceId, bytesToHash(record.hash), record.version);
+  cache.markValidated(resourceId, false);  // Server may have moved on while we were off
+  VRAM_LOGD("Snapshot: restored %s (%d bytes, v%d)", resourceId.c_str(), record.length, record.version);
+  return true;
+}
+
+bool CacheSnapshot::save(ResourceCache& cache) {
+  if (!mounted) return false;
+  
+  std::vector<ResourceId> ids;
+  for (int priority = PRIORITY_CRITICAL; priority <= CACHE_PERSIST_MAX_PRIORITY; priority++) {
+    std::vector<ResourceId> level = cache.getResourcesByPriority(priority);
+    ids.insert(ids.end(), level.begin(), level.end());
+  }
+  if (ids.size() > SNAPSHOT_MAX_ENTRIES) {
+    ids.resize(SNAPSHOT_MAX_ENTRIES);
+  }
+  
+  File file = LittleFS.open(SNAPSHOT_TEMP_PATH, FILE_WRITE);
+  if (!file) {
+    VRAM_LOGW("Snapshot: cannot create %s", SNAPSHOT_TEMP_PATH);
+    return false;
+  }
+  
+  SnapshotHeader header = { SNAPSHOT_MAGIC, SNAPSHOT_FORMAT_VERSION, (uint16_t)ids.size() };
+  bool success = file.write((const uint8_t*)&header, sizeof(header)) == sizeof(header);
+  
+  // Index first; payload offsets follow from the id and payload lengths
+  uint32_t offset = sizeof(SnapshotHeader) + ids.size() * sizeof(SnapshotRecord);
+  for (size_t i = 0; i < ids.size() && success; i++) {
+    const CacheEntry* entry = cache.peek(ids[i]);
+    
+    SnapshotRecord record;
+    memset(&record, 0, sizeof(record));
+    record.offset = offset;
+    record.length = entry->length;
+    record.crc = checksum(entry->data, entry->length);
+    record.version = entry->version;
+    record.priority = entry->priority;
+    record.idLength = entry->resourceId.length();
+    hashToBytes(entry->hash, record.hash);
+    
+    success = file.write((const uint8_t*)&record, sizeof(record)) == sizeof(record);
+    offset += record.idLength + record.length;
+  }
+  
+  for (size_t i = 0; i < ids.size() && success; i++) {
+    const CacheEntry* entry = cache.peek(ids[i]);
+    size_t idLength = entry->resourceId.length();
+    
+    success = file.write((const uint8_t*)entry->resourceId.c_str(), idLength) == idLength &&
+              file.write(entry->data, entry->length) == entry->length;
+  }
+  
+  file.close();
+  
+  // Replace the old snapshot only once the new one is complete
+  if (success) {
+    LittleFS.remove(SNAPSHOT_PATH);
+    success = LittleFS.rename(SNAPSHOT_TEMP_PATH, SNAPSHOT_PATH);
+  }
+  
+  if (!success) {
+    VRAM_LOGW("Snapshot: write failed");
+    LittleFS.remove(SNAPSHOT_TEMP_PATH);
+    return false;
+  }
+  
+  savedGeneration = cache.getPersistGeneration();
+  lastSaveTime = millis();
+  VRAM_LOGI("Snapshot: saved %u entries (%lu bytes)", (unsigned)ids.size(), (unsigned long)offset);
+  return true;
+}
+
+void CacheSnapshot::update(ResourceCache& cache) {
+  if (!mounted || cache.getPersistGeneration() == savedGeneration) {
+    return;
+  }
+  
+  if (millis() - lastSaveTime >= SNAPSHOT_SAVE_INTERVAL) {
+    save(cache);
+  }
+}
+
+void CacheSnapshot::erase() {
+  if (!mounted) return;
+  
+  LittleFS.remove(SNAPSHOT_PATH);
+  LittleFS.remove(SNAPSHOT_TEMP_PATH);
+  VRAM_LOGI("Snapshot: erased");
+}
+
+uint32_t CacheSnapshot::checksum(const uint8_t* data, size_t length) {
+  uint32_t crc = 0xFFFFFFFF;
+  for (size_t i = 0; i < length; i++) {
+    crc = Inflater::updateCrc(crc, data[i]);
+  }
+  return ~crc;
+}
+
+void CacheSnapshot::hashToBytes(const String& hash, uint8_t* bytes) {
+  memset(bytes, 0, SNAPSHOT_HASH_SIZE);
+  if (hash.length() != SNAPSHOT_HASH_SIZE * 2) {
+    return;  // Unknown hash is stored as zeros
+  }
+  
+  for (int i = 0; i < SNAPSHOT_HASH_SIZE; i++) {
+    char byteString[3] = { hash[i * 2], hash[i * 2 + 1], '\0' };
+    bytes[i] = (uint8_t)strtol(byteString, NULL, 16);
+  }
+}
+
+String CacheSnapshot::bytesToHash(const uint8_t* bytes) {
+  bool known = false;
+  for (int i = 0; i < SNAPSHOT_HASH_SIZE; i++) {
+    known |= bytes[i] != 0;
+  }
+  if (!known) {
+    return "";
+  }
+  
+  char hex[SNAPSHOT_HASH_SIZE * 2 + 1];
+  for (int i = 0; i < SNAPSHOT_HASH_SIZE; i++) {
+    sprintf(hex + i * 2, "%02x", bytes[i]);
+  }
+  return String(hex);
+}
+
+#endif // CACHE_SNAPSHOT_H
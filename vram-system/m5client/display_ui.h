@@ -0,0 +1,225 @@
+/*
+ * Display UI for VRAM System
+ * Text fields that are redrawn only when their value changes, through a
+ * one-line off-screen canvas, and timed overlays for status screens
+ */
+
+#ifndef DISPLAY_UI_H
+#define DISPLAY_UI_H
+
+#include <M5StickCPlus2.h>
+#include <stdarg.h>
+#include "vram_log.h"
+
+// UI configuration
+#define UI_PAGE_FIELDS   8      // Fields on the dashboard, and lines on an overlay
+#define UI_TEXT_SIZE     32     // Longest field text, with its terminator
+#define UI_LINE_HEIGHT   20     // Default field height in pixels
+#define UI_BAND_HEIGHT   24     // Canvas height; taller fields are drawn straight to the display
+#define UI_BACKGROUND    BLACK
+
+/*
+ * A field is a full-width strip centred on its y. Setting a field to the
+ * text and color it already shows costs a compare; a change marks it
+ * dirty, and update() renders each dirty field into the canvas and
+ * pushes just that strip, so nothing is cleared and nothing flickers.
+ *
+ * The canvas is one strip (240 x UI_BAND_HEIGHT at 16 bits, about 11KB)
+ * rather than a full frame, which would take 64KB of the heap the cache
+ * budget is sized from. Without it fields are still redrawn one at a
+ * time, each over a cleared strip.
+ *
+ * An overlay replaces the dashboard for a while and then gives it back,
+ * so a status screen never blocks the loop.
+ */
+struct UiField {
+  int16_t top;
+  int16_t height;
+  float textSize;
+  uint16_t color;
+  char text[UI_TEXT_SIZE];
+  bool dirty;
+};
+
+struct UiPage {
+  UiField fields[UI_PAGE_FIELDS];
+  int count;
+};
+
+class DisplayUi {
+private:
+  M5Canvas band;
+  bool banded;              // Canvas allocated
+  UiPage dashboard;
+  UiPage overlay;
+  bool overlayActive;
+  unsigned long overlayStart;
+  unsigned long overlayDuration;  // 0 keeps the overlay until the next one
+  UiPage* shown;            // Page on screen; nullptr forces a full repaint
+  unsigned long pushes;     // Strips pushed to the display
+  
+  int addTo(UiPage& page, int16_t y, float textSize, int16_t height);
+  static void setText(UiField& field, uint16_t color, const char* format, va_list args);
+  void drawField(const UiField& field);
+  
+public:
+  DisplayUi();
+  
+  // After the display's rotation and font are set
+  bool begin();
+  
+  // Dashboard fields, numbered from 0 in the order they are added
+  int addField(int16_t y, float textSize = 1, int16_t height = UI_LINE_HEIGHT);
+  void setField(int field, uint16_t color, const char* format, ...) __attribute__((format(printf, 4, 5)));
+  
+  // Start an empty overlay shown for duration ms (0 until the next one), then add its lines
+  void showOverlay(unsigned long duration);
+  void addOverlayLine(int16_t y, uint16_t color, float textSize, const char* format, ...) __attribute__((format(printf, 5, 6)));
+  void dismissOverlay();
+  bool isOverlayActive() { return overlayActive; }
+  
+  // Push whatever changed; call every loop, and after composing a screen in setup()
+  void update();
+  
+  unsigned long getPushCount() { return pushes; }
+};
+
+// Implementation
+DisplayUi::DisplayUi() : band(&M5.Display) {
+  banded = false;
+  dashboard.count = 0;
+  overlay.count = 0;
+  overlayActive = false;
+  overlayStart = 0;
+  overlayDuration = 0;
+  shown = nullptr;
+  pushes = 0;
+}
+
+bool DisplayUi::begin() {
+  band.setColorDepth(16);
+  band.setPsram(false);
+  banded = band.createSprite(M5.Display.width(), UI_BAND_HEIGHT) != nullptr;
+  if (!banded) {
+    VRAM_LOGW("DisplayUi: no memory for the canvas, drawing fields directly");
+    return false;
+  }
+  
+  band.setFont(M5.Display.getFont());
+  band.setTextDatum(middle_center);
+  return true;
+}
+
+int DisplayUi::addTo(UiPage& page, int16_t y, float textSize, int16_t height) {
+  if (page.count >= UI_PAGE_FIELDS) {
+    VRAM_LOGE("DisplayUi: more than %d fields on a page", UI_PAGE_FIELDS);
+    return -1;
+  }
+  
+  UiField& field = page.fields[page.count];
+  field.top = y - height / 2;
+  field.height = height;
+  field.textSize = textSize;
+  field.color = GREEN;
+  field.text[0] = '\0';
+  field.dirty = true;
+  return page.count++;
+}
+
+void DisplayUi::setText(UiField& field, uint16_t color, const char* format, va_list args) {
+  char text[UI_TEXT_SIZE];
+  vsnprintf(text, sizeof(text), format, args);
+  if (color == field.color && strcmp(text, field.text) == 0) {
+    return;
+  }
+  
+  memcpy(field.text, text, sizeof(text));
+  field.color = color;
+  field.dirty = true;
+}
+
+int DisplayUi::addField(int16_t y, float textSize, int16_t height) {
+  return addTo(dashboard, y, textSize, height);
+}
+
+void DisplayUi::setField(int field, uint16_t color, const char* format, ...) {
+  if (field < 0 || field >= dashboard.count) {
+    return;
+  }
+  
+  va_list args;
+  va_start(args, format);
+  setText(dashboard.fields[field], color, format, args);
+  va_end(args);
+}
+
+void DisplayUi::showOverlay(unsigned long duration) {
+  overlay.count = 0;
+  overlayActive = true;
+  overlayStart = millis();
+  overlayDuration = duration;
+  shown = nullptr;  // New lines, new layout
+}
+
+void DisplayUi::addOverlayLine(int16_t y, uint16_t color, float textSize, const char* format, ...) {
+  int line = addTo(overlay, y, textSize, UI_LINE_HEIGHT * textSize);
+  if (line < 0) {
+    return;
+  }
+  
+  va_list args;
+  va_start(args, format);
+  setText(overlay.fields[line], color, format, args);
+  va_end(args);
+}
+
+void DisplayUi::dismissOverlay() {
+  overlayActive = false;
+}
+
+void DisplayUi::drawField(const UiField& field) {
+  int width = M5.Display.width();
+  
+  if (banded && field.height <= UI_BAND_HEIGHT) {
+    band.fillScreen(UI_BACKGROUND);
+    band.setTextSize(field.textSize);
+    band.setTextColor(field.color, UI_BACKGROUND);
+    band.drawString(field.text, width / 2, field.height / 2);
+    
+    // The clip keeps the rest of the canvas off the neighbouring fields
+    M5.Display.setClipRect(0, field.top, width, field.height);
+    band.pushSprite(0, field.top);
+    M5.Display.clearClipRect();
+  } else {
+    M5.Display.fillRect(0, field.top, width, field.height, UI_BACKGROUND);
+    M5.Display.setTextSize(field.textSize);
+    M5.Display.setTextColor(field.color, UI_BACKGROUND);
+    M5.Display.drawString(field.text, width / 2, field.top + field.height / 2);
+  }
+  pushes++;
+}
+
+void DisplayUi::update() {
+  if (overlayActive && overlayDuration > 0 && millis() - overlayStart >= overlayDuration) {
+    overlayActive = false;
+  }
+  
+  // A page change repaints everything once; after that only dirty fields
+  UiPage* page = overlayActive ? &overlay : &dashboard;
+  bool repaint = page != shown;
+  M5.Display.startWrite();
+  if (repaint) {
+    M5.Display.fillScreen(UI_BACKGROUND);
+    shown = page;
+  }
+  for (int i = 0; i < page->count; i++) {
+    UiField& field = page->fields[i];
+    if (field.dirty || repaint) {
+      drawField(field);
+      field.dirty = false;
+    }
+  }
+  M5.Display.endWrite();
+}
+
+#endif // DISPLAY_UI_H
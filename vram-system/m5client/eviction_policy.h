@@ -0,0 +1,276 @@
+/*
+ * Eviction Policies for VRAM System
+ * Alternatives to the default PriorityPolicy, selected per deployment
+ * with ResourceCache::setEvictionPolicy()
+ */
+
+#ifndef EVICTION_POLICY_H
+#define EVICTION_POLICY_H
+
+#include <Arduino.h>
+#include "vram_log.h"
+#include "resource_cache.h"
+
+// Policy configuration
+#define LFU_AGING_INTERVAL     1024  // Uses between halving every count
+#define LFU_COUNT_MAX          0xFFFF
+#define TINYLFU_SKETCH_WIDTH   256   // Counters per sketch row, power of two
+#define TINYLFU_SKETCH_ROWS    4
+#define TINYLFU_COUNTER_MAX    15
+#define TINYLFU_WINDOW_PCT     20    // Share of entries in the admission window
+#define TINYLFU_PROTECTED_PCT  80    // Share of the main region kept for reused entries
+
+// Plain recency; priority only decides eligibility. Each priority has
+// its own list and the victim is the least recent of their tails.
+class LruPolicy : public EvictionPolicy {
+private:
+  PriorityLists order;
+  
+public:
+  LruPolicy() { order.reset(); }
+  
+  const char* getName() override { return "LRU"; }
+  void onInsert(CacheEntry* entry) override { order.pushHead(entry); }
+  void onAccess(CacheEntry* entry) override { order.moveToHead(entry); }
+  void onRemove(CacheEntry* entry) override { order.remove(entry); }
+  void onPriorityChange(CacheEntry* entry, int oldPriority) override { order.changePriority(entry, oldPriority); }
+  CacheEntry* selectVictim(int minPriority, bool reclaim) override;
+  void clear() override { order.reset(); }
+};
+
+// Least used first, ties broken by recency. Each priority's list stays
+// sorted by use count, so a use moves an entry past the ones it now
+// outranks. Counts are halved periodically so formerly hot entries can age out.
+class LfuPolicy : public EvictionPolicy {
+private:
+  PriorityLists order;
+  unsigned long uses;
+  
+  void place(CacheEntry* entry, CacheEntry* from);
+  void age();
+  static CacheEntry* lessUsed(CacheEntry* a, CacheEntry* b);
+  
+public:
+  LfuPolicy() { order.reset(); uses = 0; }
+  
+  const char* getName() override { return "LFU"; }
+  void onInsert(CacheEntry* entry) override;
+  void onAccess(CacheEntry* entry) override;
+  void onRemove(CacheEntry* entry) override { order.remove(entry); }
+  void onPriorityChange(CacheEntry* entry, int oldPriority) override;
+  CacheEntry* selectVictim(int minPriority, bool reclaim) override;
+  void clear() override { order.reset(); uses = 0; }
+};
+
+/*
+ * W-TinyLFU. New entries land in a small LRU window; the main region is
+ * a segmented LRU whose protected part holds entries used again after
+ * admission. When room is needed, the window's oldest entry only
+ * displaces the main region's victim if a frequency sketch says it is
+ * used more often. One-off scans therefore churn through the window
+ * and probation, and the hot set stays protected. Each segment keeps a
+ * list per priority, so victims are found at the tails.
+ */
+class TinyLfuPolicy : public EvictionPolicy {
+private:
+  enum Segment { WINDOW = 0, PROBATION = 1, PROTECTED = 2 };
+  
+  PriorityLists window;
+  PriorityLists probation;
+  PriorityLists protectedList;
+  
+  // Count-min sketch of recent uses, 4-bit counters kept in bytes
+  uint8_t sketch[TINYLFU_SKETCH_ROWS][TINYLFU_SKETCH_WIDTH];
+  unsigned long sketchAdditions;
+  
+  PriorityLists& listFor(CacheEntry* entry);
+  void moveTo(CacheEntry* entry, Segment segment);
+  void balance();
+  size_t slotFor(uint32_t hash, int row);
+  void record(uint32_t hash);
+  int estimate(uint32_t hash);
+  
+public:
+  TinyLfuPolicy();
+  
+  const char* getName() override { return "W-TinyLFU"; }
+  void onInsert(CacheEntry* entry) override;
+  void onAccess(CacheEntry* entry) override;
+  void onRemove(CacheEntry* entry) override { listFor(entry).remove(entry); }
+  void onPriorityChange(CacheEntry* entry, int oldPriority) override { listFor(entry).changePriority(entry, oldPriority); }
+  void onMiss(const ResourceId& resourceId) override { record(resourceId.hash()); }
+  CacheEntry* selectVictim(int minPriority, bool reclaim) override;
+  void clear() override;
+};
+
+// Implementation
+CacheEntry* LruPolicy::selectVictim(int minPriority, bool reclaim) {
+  return order.coldest(minPriority);
+}
+
+void LfuPolicy::place(CacheEntry* entry, CacheEntry* from) {
+  // Entries nearer the tail than `from` already have lower or equal counts
+  PolicyList& list = order.levels[entry->priority];
+  CacheEntry* hotter = from;
+  while (hotter != nullptr && hotter->policyCount <= entry->policyCount) {
+    hotter = hotter->policyPrev;
+  }
+  list.insertBefore(hotter ? hotter->policyNext : list.head, entry);
+}
+
+void LfuPolicy::age() {
+  // Halving keeps the lists sorted
+  for (int level = PRIORITY_CRITICAL; level <= PRIORITY_LOW; level++) {
+    for (CacheEntry* entry = order.levels[level].head; entry != nullptr; entry = entry->policyNext) {
+      entry->policyCount /= 2;
+    }
+  }
+}
+
+CacheEntry* LfuPolicy::lessUsed(CacheEntry* a, CacheEntry* b) {
+  if (a->policyCount != b->policyCount) {
+    return a->policyCount < b->policyCount ? a : b;
+  }
+  return PriorityLists::older(a, b);
+}
+
+void LfuPolicy::onInsert(CacheEntry* entry) {
+  entry->policyCount = 1;
+  place(entry, order.levels[entry->priority].tail);
+}
+
+void LfuPolicy::onPriorityChange(CacheEntry* entry, int oldPriority) {
+  order.levels[oldPriority].remove(entry);
+  place(entry, order.levels[entry->priority].tail);
+}
+
+void LfuPolicy::onAccess(CacheEntry* entry) {
+  CacheEntry* from = entry->policyPrev;
+  order.remove(entry);
+  if (entry->policyCount < LFU_COUNT_MAX) {
+    entry->policyCount++;
+  }
+  place(entry, from);
+  
+  if (++uses % LFU_AGING_INTERVAL == 0) {
+    age();
+  }
+}
+
+CacheEntry* LfuPolicy::selectVictim(int minPriority, bool reclaim) {
+  return order.coldest(minPriority, lessUsed);
+}
+
+TinyLfuPolicy::TinyLfuPolicy() {
+  clear();
+}
+
+void TinyLfuPolicy::clear() {
+  window.reset();
+  probation.reset();
+  protectedList.reset();
+  memset(sketch, 0, sizeof(sketch));
+  sketchAdditions = 0;
+}
+
+PriorityLists& TinyLfuPolicy::listFor(CacheEntry* entry) {
+  switch (entry->policySegment) {
+    case PROBATION: return probation;
+    case PROTECTED: return protectedList;
+    default:        return window;
+  }
+}
+
+void TinyLfuPolicy::moveTo(CacheEntry* entry, Segment segment) {
+  listFor(entry).remove(entry);
+  entry->policySegment = segment;
+  listFor(entry).pushHead(entry);
+}
+
+void TinyLfuPolicy::balance() {
+  size_t windowCount = window.count();
+  size_t protectedCount = protectedList.count();
+  size_t total = windowCount + probation.count() + protectedCount;
+  size_t windowLimit = max((size_t)1, total * TINYLFU_WINDOW_PCT / 100);
+  size_t protectedLimit = max((size_t)1, (total - windowLimit) * TINYLFU_PROTECTED_PCT / 100);
+  
+  // With room to spare, window overflow enters probation uncontested
+  for (; windowCount > windowLimit; windowCount--) {
+    moveTo(window.tail(), PROBATION);
+  }
+  for (; protectedCount > protectedLimit; protectedCount--) {
+    moveTo(protectedList.tail(), PROBATION);
+  }
+}
+
+void TinyLfuPolicy::onInsert(CacheEntry* entry) {
+  record(entry->resourceId.hash());
+  entry->policySegment = WINDOW;
+  window.pushHead(entry);
+  balance();
+}
+
+void TinyLfuPolicy::onAccess(CacheEntry* entry) {
+  record(entry->resourceId.hash());
+  
+  if (entry->policySegment == WINDOW) {
+    window.moveToHead(entry);
+  } else {
+    // Reuse in the main region earns protection
+    moveTo(entry, PROTECTED);
+    balance();
+  }
+}
+
+CacheEntry* TinyLfuPolicy::selectVictim(int minPriority, bool reclaim) {
+  CacheEntry* candidate = window.coldest(minPriority);
+  CacheEntry* victim = probation.coldest(minPriority);
+  if (victim == nullptr) {
+    victim = protectedList.coldest(minPriority);
+  }
+  
+  if (candidate == nullptr || victim == nullptr) {
+    return candidate ? candidate : victim;
+  }
+  
+  // Admission: the window's oldest entry is kept only if used more often
+  if (estimate(candidate->resourceId.hash()) > estimate(victim->resourceId.hash())) {
+    moveTo(candidate, PROBATION);
+    return victim;
+  }
+  return candidate;
+}
+
+size_t TinyLfuPolicy::slotFor(uint32_t hash, int row) {
+  static const uint32_t seeds[TINYLFU_SKETCH_ROWS] = { 0x9E3779B1, 0x85EBCA77, 0xC2B2AE3D, 0x27D4EB2F };
+  return ((hash * seeds[row]) >> 16) & (TINYLFU_SKETCH_WIDTH - 1);
+}
+
+void TinyLfuPolicy::record(uint32_t hash) {
+  for (int row = 0; row < TINYLFU_SKETCH_ROWS; row++) {
+    uint8_t& counter = sketch[row][slotFor(hash, row)];
+    if (counter < TINYLFU_COUNTER_MAX) {
+      counter++;
+    }
+  }
+  
+  // Halve everything periodically so the sketch follows recent use
+  if (++sketchAdditions >= TINYLFU_SKETCH_WIDTH * 10) {
+    for (int row = 0; row < TINYLFU_SKETCH_ROWS; row++) {
+      for (int i = 0; i < TINYLFU_SKETCH_WIDTH; i++) {
+        sketch[row][i] >>= 1;
+      }
+    }
+    sketchAdditions /= 2;
+  }
+}
+
+int TinyLfuPolicy::estimate(uint32_t hash) {
+  int frequency = TINYLFU_COUNTER_MAX;
+  for (int row = 0; row < TINYLFU_SKETCH_ROWS; row++) {
+    frequency = min(frequency, (int)sketch[row][slotFor(hash, row)]);
+  }
+  return frequency;
+}
+
+#endif // EVICTION_POLICY_H
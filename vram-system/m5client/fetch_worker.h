@@ -0,0 +1,624 @@
+/*
+ * Fetch Worker for VRAM System
+ * Runs resource requests in a FreeRTOS task on the other core, so the
+ * main loop never waits on the network
+ */
+
+#ifndef FETCH_WORKER_H
+#define FETCH_WORKER_H
+
+#include <Arduino.h>
+#include "vram_log.h"
+#include <HTTPClient.h>
+#include <ArduinoJson.h>
+#include <vector>
+#include "resource_id.h"
+#include "resource_cache.h"
+#include "resource_stream.h"
+#include "wifi_manager.h"
+
+// Worker configuration
+#define FETCH_WORKER_CORE        0      // Core of the WiFi stack; loop() runs on core 1
+#define FETCH_WORKER_STACK       8192
+#define FETCH_WORKER_PRIORITY    1
+#define FETCH_JOB_QUEUE_SIZE     8
+#define FETCH_RESULT_QUEUE_SIZE  8
+#define FETCH_BATCH_MAX          8      // Resources per batch job
+// Recent handles whose outcome can still be queried. Up to a full job
+// queue, the running job and a full result queue's worth of jobs can be
+// unfinished at once; twice that leaves their successors' outcomes readable.
+#define FETCH_TRACKED_JOBS       (2 * (FETCH_JOB_QUEUE_SIZE + 1 + FETCH_RESULT_QUEUE_SIZE))
+#define FETCH_TIMEOUT            10000
+#define FETCH_HASH_SIZE          65     // Hex SHA-256 and terminator
+#define FETCH_HINTS_SIZE         192    // X-Resource-Hints value, truncated beyond this
+#define FETCH_PAGES_MAX          4      // Pages per range request
+#define RESOURCE_PATH_SIZE       112    // Longest resource id plus endpoint and query
+
+enum FetchState {
+  FETCH_UNKNOWN,   // Never issued, or too old to be tracked
+  FETCH_PENDING,
+  FETCH_DONE,      // At least one resource delivered, or confirmed current
+  FETCH_FAILED
+};
+
+// Future for a submitted job; poll it with FetchWorker::getState()
+struct FetchHandle {
+  uint32_t ticket;
+  
+  FetchHandle() : ticket(0) {}
+  bool isValid() const { return ticket != 0; }
+};
+
+// Queued by value, so it holds no Strings; its ids' references travel with
+// the bytes (see ResourceId::detach())
+struct FetchJob {
+  uint32_t ticket;
+  bool batch;
+  bool raw;                   // Binary body instead of the JSON envelope
+  bool prefetch;
+  uint16_t firstPage;         // Range jobs: pages [firstPage, firstPage + pageCount)
+  uint8_t pageCount;          // 0 for whole-resource jobs
+  char etag[FETCH_HASH_SIZE]; // Cached hash for a conditional GET, empty if none
+  uint8_t count;
+  ResourceRequest requests[FETCH_BATCH_MAX];
+};
+
+// One fetched resource, handed from the worker to the main task
+struct FetchResult {
+  uint32_t ticket;
+  bool last;                  // No more results follow for this ticket
+  bool prefetch;
+  bool revalidation;          // Sent with If-None-Match
+  ResourceId resourceId;      // Invalid on the closing result of a batch or range
+  uint16_t page;              // CACHE_NO_PAGE unless it came from a range job
+  size_t totalLength;         // Range jobs: full resource size from Content-Range
+  int priority;
+  int httpCode;               // 200 with no data means the body could not be read; 226 carries a delta
+  uint8_t* data;              // VRAM_MALLOC buffer; the delivery callback owns it
+  size_t length;
+  int version;
+  char hash[FETCH_HASH_SIZE];
+  char hints[FETCH_HINTS_SIZE];
+  unsigned long ttl;          // Seconds from X-Resource-TTL or the batch part, 0 for none
+  unsigned long elapsed;      // From the start of the job
+};
+
+// Runs on the main task; return true if the resource is now cached and current
+typedef bool (*FetchDelivery)(FetchResult& result);
+
+/*
+ * The worker only does network I/O and response parsing. Every result
+ * comes back through poll() on the main task, which is the only task
+ * that touches ResourceCache. Buffers are allocated through the locked
+ * MemoryManager and the socket is shared through WiFiManager's session
+ * lock, so the main loop's own health checks take turns with the worker.
+ */
+class FetchWorker {
+private:
+  struct TrackedJob {
+    uint32_t ticket;
+    FetchState state;
+    int delivered;
+  };
+  
+  WiFiManager* wifi;
+  FetchDelivery delivery;
+  Telemetry* telemetry;
+  QueueHandle_t jobs;
+  QueueHandle_t results;
+  TaskHandle_t task;
+  uint32_t nextTicket;
+  TrackedJob tracked[FETCH_TRACKED_JOBS];
+  
+  // Each counter has one writer, so isBusy() needs no lock
+  volatile unsigned long submitted;   // Main task
+  volatile unsigned long finished;    // Worker task
+  unsigned long delivered;
+  unsigned long failed;
+  
+  static void taskEntry(void* worker);
+  void run();
+  void runGet(const FetchJob& job);
+  void runBatch(const FetchJob& job);
+  void runPages(const FetchJob& job);
+  void publish(FetchResult& result);
+  void recordTiming(unsigned long bodyStart);
+  static void initResult(FetchResult& result, const FetchJob& job);
+  static void copyField(char* field, size_t size, const String& value);
+  
+  FetchHandle submit(FetchJob& job, bool urgent);
+  TrackedJob* findTracked(uint32_t ticket);
+  
+public:
+  FetchWorker();
+  
+  // Start the task; delivery is called from poll() for every resource
+  bool begin(WiFiManager& wifiManager, FetchDelivery deliveryCallback);
+  void setTelemetry(Telemetry* target) { telemetry = target; }  // Network phases on the worker, delivery on poll()
+  
+  // Queue work; an invalid handle means the queue is full.
+  // Single fetches are urgent and go ahead of queued batches.
+  FetchHandle fetch(const ResourceId& resourceId, int priority, bool raw);
+  FetchHandle revalidate(const ResourceId& resourceId, int priority, const String& hash);
+  FetchHandle fetchBatch(const std::vector<ResourceRequest>& requests, bool prefetch);
+  FetchHandle fetchPages(const ResourceId& resourceId, uint16_t firstPage, int pageCount, int priority);  // Urgent; up to FETCH_PAGES_MAX
+  
+  // Main task: deliver finished results; returns the number delivered
+  int poll();
+  
+  FetchState getState(const FetchHandle& handle);
+  FetchState wait(const FetchHandle& handle, unsigned long timeout = FETCH_TIMEOUT * 2);  // Polls; for setup() only
+  bool isBusy() { return submitted != finished; }
+  
+  // Endpoint path for a resource, formatted in place instead of concatenated
+  static void formatPath(char* path, const ResourceId& resourceId, bool raw, bool compress);
+  
+  void printStats();
+};
+
+// Implementation
+FetchWorker::FetchWorker() {
+  wifi = nullptr;
+  delivery = nullptr;
+  telemetry = nullptr;
+  jobs = nullptr;
+  results = nullptr;
+  task = nullptr;
+  nextTicket = 1;
+  memset(tracked, 0, sizeof(tracked));
+  submitted = 0;
+  finished = 0;
+  delivered = 0;
+  failed = 0;
+}
+
+bool FetchWorker::begin(WiFiManager& wifiManager, FetchDelivery deliveryCallback) {
+  wifi = &wifiManager;
+  delivery = deliveryCallback;
+  
+  jobs = xQueueCreate(FETCH_JOB_QUEUE_SIZE, sizeof(FetchJob));
+  results = xQueueCreate(FETCH_RESULT_QUEUE_SIZE, sizeof(FetchResult));
+  if (jobs == nullptr || results == nullptr) {
+    VRAM_LOGE("Fetch worker: cannot create queues");
+    return false;
+  }
+  
+  if (xTaskCreatePinnedToCore(taskEntry, "vram_fetch", FETCH_WORKER_STACK, this,
+                              FETCH_WORKER_PRIORITY, &task, FETCH_WORKER_CORE) != pdPASS) {
+    VRAM_LOGE("Fetch worker: cannot start task");
+    return false;
+  }
+  
+  VRAM_LOGI("Fetch worker running on core %d", FETCH_WORKER_CORE);
+  return true;
+}
+
+void FetchWorker::taskEntry(void* worker) {
+  ((FetchWorker*)worker)->run();
+}
+
+void FetchWorker::run() {
+  while (true) {
+    // Fresh each time, so the received ids are released after the job
+    FetchJob job;
+    if (xQueueReceive(jobs, &job, portMAX_DELAY) != pdTRUE) {
+      continue;
+    }
+    
+    if (job.batch) {
+      runBatch(job);
+    } else if (job.pageCount > 0) {
+      runPages(job);
+    } else {
+      runGet(job);
+    }
+    finished++;
+  }
+}
+
+void FetchWorker::initResult(FetchResult& result, const FetchJob& job) {
+  memset(&result, 0, sizeof(result));
+  result.ticket = job.ticket;
+  result.page = CACHE_NO_PAGE;
+  result.prefetch = job.prefetch;
+  result.revalidation = job.etag[0] != '\0';
+}
+
+void FetchWorker::copyField(char* field, size_t size, const String& value) {
+  strncpy(field, value.c_str(), size - 1);
+  field[size - 1] = '\0';
+}
+
+void FetchWorker::publish(FetchResult& result) {
+  // Back-pressure: a slow main loop holds the worker, not the heap
+  xQueueSend(results, &result, portMAX_DELAY);
+  result.resourceId.detach();  // The queued copy holds the reference now
+}
+
+void FetchWorker::recordTiming(unsigned long bodyStart) {
+  if (telemetry == nullptr) {
+    return;
+  }
+  
+  // Read while the session is still ours; the next request overwrites it
+  RequestTiming timing = wifi->getLastTiming();
+  if (timing.opened) {
+    telemetry->record(METRIC_FETCH_DNS, timing.dns);
+    telemetry->record(METRIC_FETCH_CONNECT, timing.connect);
+  }
+  telemetry->record(METRIC_FETCH_TTFB, timing.firstByte);
+  telemetry->record(METRIC_FETCH_BODY, millis() - bodyStart);
+}
+
+void FetchWorker::runGet(const FetchJob& job) {
+  unsigned long startTime = millis();
+  const ResourceRequest& request = job.requests[0];
+  
+  FetchResult result;
+  initResult(result, job);
+  result.last = true;
+  result.resourceId = request.resourceId;
+  result.priority = request.priority;
+  
+  // Compression pays off for anything not being evicted soon
+  char path[RESOURCE_PATH_SIZE];
+  formatPath(path, request.resourceId, job.raw, request.priority <= PRIORITY_NORMAL);
+  
+  if (!wifi->beginRequest(path, FETCH_TIMEOUT)) {
+    result.httpCode = HTTPC_ERROR_NOT_CONNECTED;
+    result.elapsed = millis() - startTime;
+    publish(result);
+    return;
+  }
+  
+  HTTPClient& http = wifi->getHTTPClient();
+  if (job.raw) {
+    ResourceBodyReader::collectHeaders(http);
+  }
+  if (result.revalidation) {
+    wifi->addHeader("If-None-Match", "\"" + String(job.etag) + "\"");
+    wifi->addHeader(HEADER_ACCEPT_IM, DELTA_ENCODING);  // A changed entry may come back as a delta
+  }
+  
+  result.httpCode = wifi->sendRequest("GET");
+  unsigned long bodyStart = millis();
+  bool consumed = result.httpCode == HTTP_CODE_NOT_MODIFIED;
+  if (job.raw) {
+    result.ttl = http.header(HEADER_RESOURCE_TTL).toInt();  // Sent with 304s too
+  }
+  
+  // A delta reads like a body; the main task applies it to the cached base
+  bool delta = result.httpCode == HTTP_CODE_IM_USED && result.revalidation;
+  if ((result.httpCode == HTTP_CODE_OK || delta) && job.raw) {
+    ResourceBodyReader reader(MAX_RESOURCE_SIZE);
+    consumed = reader.read(http);
+    if (consumed) {
+      result.length = reader.getLength();
+      result.data = reader.takeData();
+      result.version = reader.getVersion();
+      copyField(result.hash, sizeof(result.hash), reader.getHash());
+      copyField(result.hints, sizeof(result.hints), http.header(HEADER_RESOURCE_HINTS));
+    }
+  } else if (result.httpCode == HTTP_CODE_OK) {
+    // Hex-encoded compressed bodies are twice the payload
+    ResourceEnvelopeReader reader(MAX_RESOURCE_SIZE * 2);
+    consumed = reader.read(http);
+    if (consumed) {
+      result.length = reader.getLength();
+      result.data = reader.takeData();
+    }
+  }
+  
+  if (result.httpCode > 0) {
+    recordTiming(bodyStart);
+  }
+  wifi->endRequest(consumed);
+  result.elapsed = millis() - startTime;
+  publish(result);
+}
+
+void FetchWorker::runBatch(const FetchJob& job) {
+  unsigned long startTime = millis();
+  
+  DynamicJsonDocument doc(64 + job.count * 96);
+  JsonArray list = doc.createNestedArray("resources");
+  for (int i = 0; i < job.count; i++) {
+    JsonObject item = list.createNestedObject();
+    item["id"] = job.requests[i].resourceId.c_str();  // Interned names outlive the document
+    item["priority"] = job.requests[i].priority;
+    item["compress"] = job.requests[i].priority <= PRIORITY_NORMAL;  // Same rule as runGet()
+  }
+  if (job.prefetch) {
+    doc["prefetch"] = true;
+  }
+  
+  String body;
+  serializeJson(doc, body);
+  
+  // Closes the ticket whatever happens to the parts
+  FetchResult closing;
+  initResult(closing, job);
+  closing.last = true;
+  
+  if (!wifi->beginRequest("/api/resources/batch", FETCH_TIMEOUT)) {
+    closing.httpCode = HTTPC_ERROR_NOT_CONNECTED;
+    publish(closing);
+    return;
+  }
+  
+  wifi->addHeader("Content-Type", "application/json");
+  closing.httpCode = wifi->sendRequest("POST", body);
+  unsigned long bodyStart = millis();
+  if (closing.httpCode != HTTP_CODE_OK) {
+    VRAM_LOGW("Batch request failed: %d", closing.httpCode);
+    wifi->endRequest(false);
+    closing.elapsed = millis() - startTime;
+    publish(closing);
+    return;
+  }
+  
+  ResourceBatchReader batch(wifi->getHTTPClient());
+  while (batch.nextPart()) {
+    FetchResult result;
+    initResult(result, job);
+    result.resourceId = batch.getResourceId();
+    result.priority = batch.getPriority();
+    result.httpCode = batch.getStatus();
+    result.ttl = batch.getTtl();
+    
+    if (result.httpCode == HTTP_CODE_OK) {
+      ResourceBodyReader reader(MAX_RESOURCE_SIZE);
+      if (batch.readPart(reader)) {
+        result.length = reader.getLength();
+        result.data = reader.takeData();
+        result.version = reader.getVersion();
+        copyField(result.hash, sizeof(result.hash), reader.getHash());
+      }
+    }
+    
+    result.elapsed = millis() - startTime;
+    publish(result);
+  }
+  
+  if (!batch.isFinished()) {
+    VRAM_LOGW("Batch response truncated");
+  }
+  
+  recordTiming(bodyStart);
+  wifi->endRequest(batch.isFinished());
+  closing.elapsed = millis() - startTime;
+  publish(closing);
+}
+
+void FetchWorker::runPages(const FetchJob& job) {
+  unsigned long startTime = millis();
+  const ResourceRequest& request = job.requests[0];
+  size_t first = (size_t)job.firstPage * RESOURCE_PAGE_SIZE;
+  size_t last = first + (size_t)job.pageCount * RESOURCE_PAGE_SIZE - 1;
+  
+  // Closes the ticket, as in runBatch()
+  FetchResult closing;
+  initResult(closing, job);
+  closing.last = true;
+  
+  // Ranges address the stored bytes, so never ask for compression
+  char path[RESOURCE_PATH_SIZE];
+  formatPath(path, request.resourceId, true, false);
+  
+  if (!wifi->beginRequest(path, FETCH_TIMEOUT)) {
+    closing.httpCode = HTTPC_ERROR_NOT_CONNECTED;
+    publish(closing);
+    return;
+  }
+  
+  HTTPClient& http = wifi->getHTTPClient();
+  ResourceBodyReader::collectHeaders(http);
+  char range[32];
+  snprintf(range, sizeof(range), "bytes=%u-%u", (unsigned)first, (unsigned)last);
+  wifi->addHeader("Range", range);
+  
+  closing.httpCode = wifi->sendRequest("GET");
+  unsigned long bodyStart = millis();
+  if (closing.httpCode != HTTP_CODE_PARTIAL_CONTENT) {
+    // 200 means the server ignored the range; the body is not worth reading
+    VRAM_LOGW("Range %s of %s failed: %d", range, request.resourceId.c_str(), closing.httpCode);
+    wifi->endRequest(false);
+    closing.elapsed = millis() - startTime;
+    publish(closing);
+    return;
+  }
+  
+  // Content-Range: bytes <first>-<last>/<total>
+  String contentRange = http.header(HEADER_CONTENT_RANGE);
+  int slash = contentRange.indexOf('/');
+  size_t totalLength = slash >= 0 ? contentRange.substring(slash + 1).toInt() : 0;
+  int remaining = http.getSize();
+  String hash = http.header(HEADER_RESOURCE_HASH);
+  int version = http.header(HEADER_RESOURCE_VERSION).toInt();
+  
+  // Each page gets its own buffer, straight from the stream
+  bool consumed = remaining >= 0;
+  for (int i = 0; i < job.pageCount && consumed && remaining > 0; i++) {
+    FetchResult result;
+    initResult(result, job);
+    result.resourceId = request.resourceId;
+    result.priority = request.priority;
+    result.page = job.firstPage + i;
+    result.totalLength = totalLength;
+    result.httpCode = closing.httpCode;
+    
+    size_t pageLength = min((size_t)remaining, (size_t)RESOURCE_PAGE_SIZE);
+    ResourceBodyReader reader(RESOURCE_PAGE_SIZE);
+    reader.setMetadata(hash, version, false, pageLength);
+    if (reader.readPayload(http, pageLength)) {
+      result.length = reader.getLength();
+      result.data = reader.takeData();
+      result.version = version;
+      copyField(result.hash, sizeof(result.hash), hash);
+    }
+    consumed = reader.streamConsumed();
+    remaining -= pageLength;
+    
+    result.elapsed = millis() - startTime;
+    publish(result);
+  }
+  
+  recordTiming(bodyStart);
+  wifi->endRequest(consumed && remaining == 0);
+  closing.elapsed = millis() - startTime;
+  publish(closing);
+}
+
+FetchHandle FetchWorker::submit(FetchJob& job, bool urgent) {
+  FetchHandle handle;
+  if (jobs == nullptr) {
+    return handle;
+  }
+  
+  job.ticket = nextTicket++;
+  if (nextTicket == 0) {
+    nextTicket = 1;  // 0 marks an invalid handle
+  }
+  
+  // Counted first, so isBusy() never misses a job the worker already took
+  submitted++;
+  BaseType_t queued = urgent ? xQueueSendToFront(jobs, &job, 0) : xQueueSendToBack(jobs, &job, 0);
+  if (queued != pdTRUE) {
+    submitted--;
+    VRAM_LOGW("Fetch queue full, %s not queued", job.requests[0].resourceId.c_str());
+    return handle;
+  }
+  for (int i = 0; i < job.count; i++) {
+    job.requests[i].resourceId.detach();  // The queued copy holds the references now
+  }
+  
+  TrackedJob& slot = tracked[job.ticket % FETCH_TRACKED_JOBS];
+  slot.ticket = job.ticket;
+  slot.state = FETCH_PENDING;
+  slot.delivered = 0;
+  
+  handle.ticket = job.ticket;
+  return handle;
+}
+
+FetchHandle FetchWorker::fetch(const ResourceId& resourceId, int priority, bool raw) {
+  FetchJob job;
+  memset(&job, 0, sizeof(job));
+  job.raw = raw;
+  job.count = 1;
+  job.requests[0] = { resourceId, priority };
+  return submit(job, true);
+}
+
+FetchHandle FetchWorker::revalidate(const ResourceId& resourceId, int priority, const String& hash) {
+  FetchJob job;
+  memset(&job, 0, sizeof(job));
+  job.raw = true;
+  job.count = 1;
+  job.requests[0] = { resourceId, priority };
+  copyField(job.etag, sizeof(job.etag), hash);
+  return submit(job, false);
+}
+
+FetchHandle FetchWorker::fetchBatch(const std::vector<ResourceRequest>& requests, bool prefetch) {
+  FetchJob job;
+  memset(&job, 0, sizeof(job));
+  job.batch = true;
+  job.raw = true;
+  job.prefetch = prefetch;
+  job.count = min(requests.size(), (size_t)FETCH_BATCH_MAX);
+  for (int i = 0; i < job.count; i++) {
+    job.requests[i] = requests[i];
+  }
+  
+  if (requests.size() > FETCH_BATCH_MAX) {
+    VRAM_LOGW("Batch of %u truncated to %d", (unsigned)requests.size(), FETCH_BATCH_MAX);
+  }
+  return submit(job, false);
+}
+
+FetchHandle FetchWorker::fetchPages(const ResourceId& resourceId, uint16_t firstPage, int pageCount, int priority) {
+  FetchJob job;
+  memset(&job, 0, sizeof(job));
+  job.raw = true;
+  job.count = 1;
+  job.requests[0] = { resourceId, priority };
+  job.firstPage = firstPage;
+  job.pageCount = constrain(pageCount, 1, FETCH_PAGES_MAX);
+  return submit(job, true);
+}
+
+FetchWorker::TrackedJob* FetchWorker::findTracked(uint32_t ticket) {
+  TrackedJob& slot = tracked[ticket % FETCH_TRACKED_JOBS];
+  return slot.ticket == ticket ? &slot : nullptr;
+}
+
+int FetchWorker::poll() {
+  if (results == nullptr) {
+    return 0;
+  }
+  
+  int count = 0;
+  while (true) {
+    // Fresh each time, so the received id is released after delivery
+    FetchResult result;
+    if (xQueueReceive(results, &result, 0) != pdTRUE) {
+      break;
+    }
+    
+    bool success = false;
+    if (result.resourceId.isValid()) {
+      if (delivery) {
+        TelemetryTimer timer(telemetry, METRIC_FETCH_PARSE);
+        success = delivery(result);
+      } else {
+        VRAM_FREE(result.data);
+      }
+      count++;
+      if (success) {
+        delivered++;
+      } else {
+        failed++;
+      }
+    }
+    
+    TrackedJob* job = findTracked(result.ticket);
+    if (job != nullptr) {
+      if (success) {
+        job->delivered++;
+      }
+      if (result.last) {
+        job->state = job->delivered > 0 ? FETCH_DONE : FETCH_FAILED;
+      }
+    }
+  }
+  return count;
+}
+
+FetchState FetchWorker::getState(const FetchHandle& handle) {
+  TrackedJob* job = handle.isValid() ? findTracked(handle.ticket) : nullptr;
+  return job ? job->state : FETCH_UNKNOWN;
+}
+
+FetchState FetchWorker::wait(const FetchHandle& handle, unsigned long timeout) {
+  unsigned long startTime = millis();
+  while (getState(handle) == FETCH_PENDING && millis() - startTime < timeout) {
+    poll();
+    delay(10);
+  }
+  return getState(handle);
+}
+
+void FetchWorker::formatPath(char* path, const ResourceId& resourceId, bool raw, bool compress) {
+  snprintf(path, RESOURCE_PATH_SIZE, "/api/resources/%s%s%s", resourceId.c_str(),
+           raw ? "/raw" : "", compress ? "?compress=true" : "");
+}
+
+void FetchWorker::printStats() {
+  Serial.println("\n=== Fetch Worker ===");
+  Serial.printf("Jobs: %lu submitted, %lu finished\n", submitted, finished);
+  Serial.printf("Resources: %lu delivered, %lu failed\n", delivered, failed);
+  Serial.println("====================\n");
+}
+
+#endif // FETCH_WORKER_H
@@ -0,0 +1,292 @@
+/*
+ * Flash Tier for VRAM System
+ * Second cache tier on LittleFS that RAM evictions are demoted into
+ */
+
+#ifndef FLASH_TIER_H
+#define FLASH_TIER_H
+
+#include <Arduino.h>
+#include "vram_log.h"
+#include <FS.h>
+#include <LittleFS.h>
+#include <map>
+#include "memory_manager.h"
+#include "resource_cache.h"
+#include "cache_snapshot.h"
+
+// Tier configuration
+#define FLASH_TIER_DIR          "/tier"
+#define FLASH_TIER_MAX_SIZE     (512 * 1024)  // Flash budget for demoted entries
+#define FLASH_TIER_MAX_ENTRIES  64
+#define FLASH_TIER_MAGIC        0x52454954    // "TIER"
+
+// One file per entry: header, resource id bytes, payload bytes
+struct FlashTierHeader {
+  uint32_t magic;
+  uint32_t length;
+  uint32_t crc;
+  uint32_t version;
+  uint8_t priority;
+  uint8_t idLength;
+  uint8_t hash[SNAPSHOT_HASH_SIZE];
+  uint8_t reserved[2];
+};
+
+struct FlashTierSlot {
+  String path;
+  size_t size;          // Bytes on flash, header included
+  unsigned long lastUse;
+};
+
+class FlashTier : public CacheTier {
+private:
+  bool mounted;
+  std::map<ResourceId, FlashTierSlot> slots;
+  size_t totalSize;
+  size_t maxSize;
+  unsigned long useCounter;
+  
+  static String pathFor(const ResourceId& resourceId);
+  bool removeSlot(const ResourceId& resourceId);
+  bool evictOldest();
+  void loadIndex();
+  
+public:
+  FlashTier();
+  
+  // Mount LittleFS and index entries demoted before the last reboot
+  bool begin(size_t maxSize = FLASH_TIER_MAX_SIZE);
+  void clear();
+  
+  // CacheTier
+  bool put(const CacheEntry& entry) override;
+  uint8_t* read(const ResourceId& resourceId, TierRecord& record) override;
+  bool contains(const ResourceId& resourceId) override;
+  bool remove(const ResourceId& resourceId) override;
+  
+  const char* getName() override { return "Flash"; }
+  int getCount() override { return slots.size(); }
+  size_t getSize() override { return totalSize; }
+  size_t getMaxSize() override { return maxSize; }
+};
+
+// Implementation
+FlashTier::FlashTier() {
+  mounted = false;
+  totalSize = 0;
+  maxSize = FLASH_TIER_MAX_SIZE;
+  useCounter = 0;
+}
+
+bool FlashTier::begin(size_t tierSize) {
+  maxSize = tierSize;
+  mounted = LittleFS.begin(true);
+  if (!mounted) {
+    VRAM_LOGW("Flash tier: LittleFS mount failed");
+    return false;
+  }
+  
+  if (!LittleFS.exists(FLASH_TIER_DIR)) {
+    LittleFS.mkdir(FLASH_TIER_DIR);
+  }
+  
+  loadIndex();
+  VRAM_LOGI("Flash tier: %u entries (%u / %u bytes)", (unsigned)slots.size(), (unsigned)totalSize, (unsigned)maxSize);
+  return true;
+}
+
+void FlashTier::loadIndex() {
+  File dir = LittleFS.open(FLASH_TIER_DIR);
+  if (!dir || !dir.isDirectory()) {
+    return;
+  }
+  
+  File file = dir.openNextFile();
+  while (file) {
+    String path = file.path();
+    FlashTierHeader header;
+    char id[RESOURCE_ID_MAX_LENGTH];
+    ResourceId resourceId;
+    
+    if (file.read((uint8_t*)&header, sizeof(header)) == sizeof(header) &&
+        header.magic == FLASH_TIER_MAGIC &&
+        header.idLength <= RESOURCE_ID_MAX_LENGTH &&
+        file.read((uint8_t*)id, header.idLength) == header.idLength) {
+      resourceId = ResourceId(id, header.idLength);
+    }
+    file.close();
+    
+    if (resourceId.isValid() && slots.size() < FLASH_TIER_MAX_ENTRIES) {
+      size_t size = sizeof(header) + header.idLength + header.length;
+      slots[resourceId] = { path, size, ++useCounter };
+      totalSize += size;
+    } else {
+      LittleFS.remove(path);
+    }
+    
+    file = dir.openNextFile();
+  }
+  
+  dir.close();
+}
+
+void FlashTier::clear() {
+  while (!slots.empty()) {
+    ResourceId resourceId = slots.begin()->first;
+    removeSlot(resourceId);
+  }
+}
+
+bool FlashTier::put(const CacheEntry& entry) {
+  if (!mounted) return false;
+  
+  size_t idLength = entry.resourceId.length();
+  size_t size = sizeof(FlashTierHeader) + idLength + entry.length;
+  if (size > maxSize) {
+    return false;
+  }
+  
+  removeSlot(entry.resourceId);
+  
+  // Ids are stored by hash; another id may own the same file
+  String path = pathFor(entry.resourceId);
+  for (auto it = slots.begin(); it != slots.end(); ++it) {
+    if (it->second.path == path) {
+      ResourceId owner = it->first;
+      removeSlot(owner);
+      break;
+    }
+  }
+  
+  while (totalSize + size > maxSize || slots.size() >= FLASH_TIER_MAX_ENTRIES) {
+    if (!evictOldest()) return false;
+  }
+  
+  FlashTierHeader header;
+  memset(&header, 0, sizeof(header));
+  header.magic = FLASH_TIER_MAGIC;
+  header.length = entry.length;
+  header.crc = CacheSnapshot::checksum(entry.data, entry.length);
+  header.version = entry.version;
+  header.priority = entry.priority;
+  header.idLength = idLength;
+  CacheSnapshot::hashToBytes(entry.hash, header.hash);
+  
+  File file = LittleFS.open(path, FILE_WRITE);
+  if (!file) {
+    VRAM_LOGW("Flash tier: cannot create %s", path.c_str());
+    return false;
+  }
+  
+  bool success = file.write((const uint8_t*)&header, sizeof(header)) == sizeof(header) &&
+                 file.write((const uint8_t*)entry.resourceId.c_str(), idLength) == idLength &&
+                 file.write(entry.data, entry.length) == entry.length;
+  file.close();
+  
+  if (!success) {
+    VRAM_LOGW("Flash tier: write failed for %s", entry.resourceId.c_str());
+    LittleFS.remove(path);
+    return false;
+  }
+  
+  slots[entry.resourceId] = { path, size, ++useCounter };
+  totalSize += size;
+  
+  VRAM_LOGD("Flash tier: demoted %s (%u bytes)", entry.resourceId.c_str(), (unsigned)entry.length);
+  return true;
+}
+
+uint8_t* FlashTier::read(const ResourceId& resourceId, TierRecord& record) {
+  auto it = slots.find(resourceId);
+  if (it == slots.end()) {
+    return nullptr;
+  }
+  
+  File file = LittleFS.open(it->second.path, FILE_READ);
+  FlashTierHeader header;
+  uint8_t* data = nullptr;
+  bool corrupt = true;
+  
+  if (file && file.read((uint8_t*)&header, sizeof(header)) == sizeof(header) &&
+      header.magic == FLASH_TIER_MAGIC && header.length <= MAX_RESOURCE_SIZE) {
+    file.seek(sizeof(header) + header.idLength);
+    
+    // Read straight into the buffer the RAM tier will own
+    data = (uint8_t*)VRAM_MALLOC(header.length + 1, resourceId);
+    if (data == nullptr) {
+      corrupt = false;  // Only short of RAM; try again later
+    } else if (file.read(data, header.length) == header.length &&
+               CacheSnapshot::checksum(data, header.length) == header.crc) {
+      corrupt = false;
+    } else {
+      VRAM_FREE(data);
+      data = nullptr;
+    }
+  }
+  if (file) {
+    file.close();
+  }
+  
+  if (corrupt) {
+    VRAM_LOGW("Flash tier: entry %s is corrupt", resourceId.c_str());
+    removeSlot(resourceId);
+  }
+  if (data == nullptr) {
+    return nullptr;
+  }
+  it->second.lastUse = ++useCounter;
+  
+  data[header.length] = '\0';
+  record.length = header.length;
+  record.priority = header.priority;
+  record.hash = CacheSnapshot::bytesToHash(header.hash);
+  record.version = header.version;
+  return data;
+}
+
+bool FlashTier::contains(const ResourceId& resourceId) {
+  return slots.find(resourceId) != slots.end();
+}
+
+bool FlashTier::remove(const ResourceId& resourceId) {
+  return removeSlot(resourceId);
+}
+
+bool FlashTier::removeSlot(const ResourceId& resourceId) {
+  auto it = slots.find(resourceId);
+  if (it == slots.end()) {
+    return false;
+  }
+  
+  LittleFS.remove(it->second.path);
+  totalSize -= it->second.size;
+  slots.erase(it);
+  return true;
+}
+
+bool FlashTier::evictOldest() {
+  auto oldest = slots.end();
+  for (auto it = slots.begin(); it != slots.end(); ++it) {
+    if (oldest == slots.end() || it->second.lastUse < oldest->second.lastUse) {
+      oldest = it;
+    }
+  }
+  
+  if (oldest == slots.end()) {
+    return false;
+  }
+  
+  VRAM_LOGD("Flash tier: dropping %s", oldest->first.c_str());
+  ResourceId resourceId = oldest->first;
+  return removeSlot(resourceId);
+}
+
+String FlashTier::pathFor(const ResourceId& resourceId) {
+  // Hashed names stay short whatever the id looks like
+  char path[32];
+  snprintf(path, sizeof(path), "%s/%08x", FLASH_TIER_DIR, resourceId.hash());
+  return String(path);
+}
+
+#endif // FLASH_TIER_H
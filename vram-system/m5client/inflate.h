@@ -0,0 +1,436 @@
+/*
+ * Inflate for VRAM System
+ * Streaming gzip/deflate decompression into a fixed destination buffer
+ */
+
+#ifndef INFLATE_H
+#define INFLATE_H
+
+#include <Arduino.h>
+
+// Inflate results
+enum InflateResult {
+  INFLATE_OK,
+  INFLATE_BAD_HEADER,
+  INFLATE_BAD_DATA,
+  INFLATE_OVERFLOW,      // Output larger than the destination buffer
+  INFLATE_TRUNCATED,     // Input ended before the final block
+  INFLATE_BAD_CHECKSUM
+};
+
+// Source of compressed bytes, pulled one at a time by the inflater
+class InflateSource {
+public:
+  virtual ~InflateSource() {}
+  virtual int readByte() = 0;  // -1 once the input is exhausted
+};
+
+// Compressed bytes already held in memory
+class MemoryInflateSource : public InflateSource {
+private:
+  const uint8_t* data;
+  size_t length;
+  size_t position;
+
+public:
+  MemoryInflateSource(const uint8_t* data, size_t length)
+    : data(data), length(length), position(0) {}
+
+  int readByte() override {
+    return position < length ? data[position++] : -1;
+  }
+};
+
+// Canonical Huffman table
+struct HuffmanTable {
+  uint16_t counts[16];   // Number of codes of each bit length
+  uint16_t symbols[288]; // Symbols ordered by code
+};
+
+/*
+ * Deflate decoder (RFC 1951) with a gzip wrapper (RFC 1952).
+ * Input is pulled from an InflateSource as the decoder needs it, so a
+ * network stream can be inflated while it is still arriving. Output goes
+ * straight into the caller's buffer, which doubles as the history window:
+ * back-references are resolved against bytes already written, so no
+ * separate 32KB window is allocated.
+ */
+class Inflater {
+private:
+  InflateSource* source;
+  uint8_t* dest;
+  size_t destCapacity;
+  size_t destLength;
+  uint32_t bitBuffer;
+  int bitCount;
+  bool inputEnded;
+  uint32_t crc;
+
+  HuffmanTable lengthTable;
+  HuffmanTable distanceTable;
+
+  int readBits(int count);
+  int readByteAligned();
+  int decodeSymbol(const HuffmanTable& table);
+  void buildTable(HuffmanTable& table, const uint8_t* lengths, int count);
+  void buildFixedTables();
+  InflateResult buildDynamicTables();
+  InflateResult inflateStored();
+  InflateResult inflateBlock();
+  bool emit(uint8_t value);
+
+public:
+  Inflater(InflateSource* source, uint8_t* dest, size_t destCapacity);
+
+  // CRC-32 as used by gzip; start from 0xFFFFFFFF and invert the result
+  static uint32_t updateCrc(uint32_t crc, uint8_t value);
+
+  InflateResult inflateRaw();
+  InflateResult inflateGzip();
+
+  size_t getOutputLength() { return destLength; }
+  static const char* resultString(InflateResult result);
+};
+
+// Implementation
+static const uint16_t INFLATE_LENGTH_BASE[29] = {
+  3, 4, 5, 6, 7, 8, 9, 10, 11, 13, 15, 17, 19, 23, 27, 31,
+  35, 43, 51, 59, 67, 83, 99, 115, 131, 163, 195, 227, 258
+};
+static const uint8_t INFLATE_LENGTH_EXTRA[29] = {
+  0, 0, 0, 0, 0, 0, 0, 0, 1, 1, 1, 1, 2, 2, 2, 2,
+  3, 3, 3, 3, 4, 4, 4, 4, 5, 5, 5, 5, 0
+};
+static const uint16_t INFLATE_DIST_BASE[30] = {
+  1, 2, 3, 4, 5, 7, 9, 13, 17, 25, 33, 49, 65, 97, 129, 193,
+  257, 385, 513, 769, 1025, 1537, 2049, 3073, 4097, 6145,
+  8193, 12289, 16385, 24577
+};
+static const uint8_t INFLATE_DIST_EXTRA[30] = {
+  0, 0, 0, 0, 1, 1, 2, 2, 3, 3, 4, 4, 5, 5, 6, 6,
+  7, 7, 8, 8, 9, 9, 10, 10, 11, 11, 12, 12, 13, 13
+};
+static const uint8_t INFLATE_CODE_ORDER[19] = {
+  16, 17, 18, 0, 8, 7, 9, 6, 10, 5, 11, 4, 12, 3, 13, 2, 14, 1, 15
+};
+
+Inflater::Inflater(InflateSource* src, uint8_t* buffer, size_t capacity) {
+  source = src;
+  dest = buffer;
+  destCapacity = capacity;
+  destLength = 0;
+  bitBuffer = 0;
+  bitCount = 0;
+  inputEnded = false;
+  crc = 0xFFFFFFFF;
+}
+
+int Inflater::readBits(int count) {
+  while (bitCount < count) {
+    int value = source->readByte();
+    if (value < 0) {
+      inputEnded = true;
+      value = 0;
+    }
+    bitBuffer |= (uint32_t)value << bitCount;
+    bitCount += 8;
+  }
+
+  int result = bitBuffer & ((1UL << count) - 1);
+  bitBuffer >>= count;
+  bitCount -= count;
+  return result;
+}
+
+int Inflater::readByteAligned() {
+  // Drop the partial byte, then read whole bytes
+  bitBuffer >>= bitCount & 7;
+  bitCount -= bitCount & 7;
+  return readBits(8);
+}
+
+int Inflater::decodeSymbol(const HuffmanTable& table) {
+  int code = 0;
+  int first = 0;
+  int index = 0;
+
+  for (int length = 1; length < 16; length++) {
+    code |= readBits(1);
+    int count = table.counts[length];
+    if (code - first < count) {
+      return table.symbols[index + code - first];
+    }
+    index += count;
+    first = (first + count) << 1;
+    code <<= 1;
+  }
+
+  return -1;
+}
+
+void Inflater::buildTable(HuffmanTable& table, const uint8_t* lengths, int count) {
+  uint16_t offsets[16];
+
+  memset(table.counts, 0, sizeof(table.counts));
+  for (int i = 0; i < count; i++) {
+    table.counts[lengths[i]]++;
+  }
+  table.counts[0] = 0;
+
+  offsets[1] = 0;
+  for (int i = 1; i < 15; i++) {
+    offsets[i + 1] = offsets[i] + table.counts[i];
+  }
+
+  for (int i = 0; i < count; i++) {
+    if (lengths[i]) {
+      table.symbols[offsets[lengths[i]]++] = i;
+    }
+  }
+}
+
+void Inflater::buildFixedTables() {
+  uint8_t lengths[288];
+
+  for (int i = 0; i < 144; i++) lengths[i] = 8;
+  for (int i = 144; i < 256; i++) lengths[i] = 9;
+  for (int i = 256; i < 280; i++) lengths[i] = 7;
+  for (int i = 280; i < 288; i++) lengths[i] = 8;
+  buildTable(lengthTable, lengths, 288);
+
+  for (int i = 0; i < 30; i++) lengths[i] = 5;
+  buildTable(distanceTable, lengths, 30);
+}
+
+InflateResult Inflater::buildDynamicTables() {
+  uint8_t lengths[288 + 32];
+
+  int literalCount = readBits(5) + 257;
+  int distanceCount = readBits(5) + 1;
+  int codeLengthCount = readBits(4) + 4;
+
+  if (literalCount > 286 || distanceCount > 30) {
+    return INFLATE_BAD_DATA;
+  }
+
+  // Code length alphabet, reusing distanceTable as scratch
+  memset(lengths, 0, 19);
+  for (int i = 0; i < codeLengthCount; i++) {
+    lengths[INFLATE_CODE_ORDER[i]] = readBits(3);
+  }
+  buildTable(distanceTable, lengths, 19);
+
+  int total = literalCount + distanceCount;
+  int index = 0;
+  while (index < total) {
+    int symbol = decodeSymbol(distanceTable);
+    if (symbol < 0 || inputEnded) {
+      return inputEnded ? INFLATE_TRUNCATED : INFLATE_BAD_DATA;
+    }
+
+    if (symbol < 16) {
+      lengths[index++] = symbol;
+      continue;
+    }
+
+    uint8_t value = 0;
+    int repeat;
+    if (symbol == 16) {
+      if (index == 0) return INFLATE_BAD_DATA;
+      value = lengths[index - 1];
+      repeat = readBits(2) + 3;
+    } else if (symbol == 17) {
+      repeat = readBits(3) + 3;
+    } else {
+      repeat = readBits(7) + 11;
+    }
+
+    if (index + repeat > total) {
+      return INFLATE_BAD_DATA;
+    }
+    while (repeat--) {
+      lengths[index++] = value;
+    }
+  }
+
+  buildTable(lengthTable, lengths, literalCount);
+  buildTable(distanceTable, lengths + literalCount, distanceCount);
+  return INFLATE_OK;
+}
+
+InflateResult Inflater::inflateStored() {
+  int low = readByteAligned();
+  int high = readBits(8);
+  int length = low | (high << 8);
+  int inverted = readBits(8) | (readBits(8) << 8);
+
+  if (length != (~inverted & 0xFFFF)) {
+    return INFLATE_BAD_DATA;
+  }
+
+  while (length--) {
+    int value = readBits(8);
+    if (inputEnded) return INFLATE_TRUNCATED;
+    if (!emit(value)) return INFLATE_OVERFLOW;
+  }
+
+  return INFLATE_OK;
+}
+
+InflateResult Inflater::inflateBlock() {
+  while (true) {
+    int symbol = decodeSymbol(lengthTable);
+    if (inputEnded) return INFLATE_TRUNCATED;
+    if (symbol < 0) return INFLATE_BAD_DATA;
+
+    if (symbol < 256) {
+      if (!emit(symbol)) return INFLATE_OVERFLOW;
+      continue;
+    }
+
+    if (symbol == 256) {
+      return INFLATE_OK;  // End of block
+    }
+
+    symbol -= 257;
+    if (symbol >= 29) return INFLATE_BAD_DATA;
+    int length = INFLATE_LENGTH_BASE[symbol] + readBits(INFLATE_LENGTH_EXTRA[symbol]);
+
+    int distanceSymbol = decodeSymbol(distanceTable);
+    if (distanceSymbol < 0 || distanceSymbol >= 30) return INFLATE_BAD_DATA;
+    size_t distance = INFLATE_DIST_BASE[distanceSymbol] + readBits(INFLATE_DIST_EXTRA[distanceSymbol]);
+
+    if (distance > destLength) {
+      return INFLATE_BAD_DATA;
+    }
+
+    // Copy byte by byte; the source may overlap the bytes being written
+    while (length--) {
+      if (!emit(dest[destLength - distance])) return INFLATE_OVERFLOW;
+    }
+  }
+}
+
+bool Inflater::emit(uint8_t value) {
+  if (destLength >= destCapacity) {
+    return false;
+  }
+  dest[destLength++] = value;
+  crc = updateCrc(crc, value);
+  return true;
+}
+
+uint32_t Inflater::updateCrc(uint32_t crc, uint8_t value) {
+  // Nibble-wise CRC-32 keeps the table at 64 bytes
+  static const uint32_t table[16] = {
+    0x00000000, 0x1DB71064, 0x3B6E20C8, 0x26D930AC,
+    0x76DC4190, 0x6B6B51F4, 0x4DB26158, 0x5005713C,
+    0xEDB88320, 0xF00F9344, 0xD6D6A3E8, 0xCB61B38C,
+    0x9B64C2B0, 0x86D3D2D4, 0xA00AE278, 0xBDBDF21C
+  };
+
+  crc ^= value;
+  crc = (crc >> 4) ^ table[crc & 0x0F];
+  crc = (crc >> 4) ^ table[crc & 0x0F];
+  return crc;
+}
+
+InflateResult Inflater::inflateRaw() {
+  int finalBlock;
+
+  do {
+    finalBlock = readBits(1);
+    int type = readBits(2);
+    InflateResult result;
+
+    switch (type) {
+      case 0:
+        result = inflateStored();
+        break;
+      case 1:
+        buildFixedTables();
+        result = inflateBlock();
+        break;
+      case 2:
+        result = buildDynamicTables();
+        if (result == INFLATE_OK) {
+          result = inflateBlock();
+        }
+        break;
+      default:
+        result = INFLATE_BAD_DATA;
+        break;
+    }
+
+    if (result != INFLATE_OK) {
+      return result;
+    }
+  } while (!finalBlock);
+
+  return INFLATE_OK;
+}
+
+InflateResult Inflater::inflateGzip() {
+  // Header: magic, method, flags, mtime, xfl, os
+  if (readBits(8) != 0x1F || readBits(8) != 0x8B || readBits(8) != 8) {
+    return INFLATE_BAD_HEADER;
+  }
+
+  int flags = readBits(8);
+  for (int i = 0; i < 6; i++) {
+    readBits(8);
+  }
+
+  if (flags & 0x04) {  // FEXTRA
+    int extraLength = readBits(8) | (readBits(8) << 8);
+    while (extraLength-- && !inputEnded) readBits(8);
+  }
+  if (flags & 0x08) {  // FNAME
+    while (readBits(8) != 0 && !inputEnded);
+  }
+  if (flags & 0x10) {  // FCOMMENT
+    while (readBits(8) != 0 && !inputEnded);
+  }
+  if (flags & 0x02) {  // FHCRC
+    readBits(16);
+  }
+
+  if (inputEnded) {
+    return INFLATE_TRUNCATED;
+  }
+
+  InflateResult result = inflateRaw();
+  if (result != INFLATE_OK) {
+    return result;
+  }
+
+  // Trailer: CRC-32 and input size, both little endian
+  uint32_t expectedCrc = readByteAligned();
+  for (int i = 1; i < 4; i++) expectedCrc |= (uint32_t)readBits(8) << (8 * i);
+  uint32_t expectedSize = 0;
+  for (int i = 0; i < 4; i++) expectedSize |= (uint32_t)readBits(8) << (8 * i);
+
+  if (inputEnded) {
+    return INFLATE_TRUNCATED;
+  }
+
+  if ((crc ^ 0xFFFFFFFF) != expectedCrc || expectedSize != (uint32_t)destLength) {
+    return INFLATE_BAD_CHECKSUM;
+  }
+
+  return INFLATE_OK;
+}
+
+const char* Inflater::resultString(InflateResult result) {
+  switch (result) {
+    case INFLATE_OK: return "OK";
+    case INFLATE_BAD_HEADER: return "Bad header";
+    case INFLATE_BAD_DATA: return "Bad data";
+    case INFLATE_OVERFLOW: return "Output overflow";
+    case INFLATE_TRUNCATED: return "Truncated input";
+    case INFLATE_BAD_CHECKSUM: return "Checksum mismatch";
+    default: return "Unknown";
+  }
+}
+
+#endif // INFLATE_H
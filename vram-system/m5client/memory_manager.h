@@ -7,6 +7,23 @@
 #define MEMORY_MANAGER_H
 
 #include <Arduino.h>
+#include "vram_log.h"
+#include "resource_id.h"
+#include "vram_lock.h"
+#include <new>
+
+// Slab pool configuration
+#define SLAB_CLASS_COUNT   6
+#define SLAB_SLOT_SLACK    16            // Room for a terminator past a full-size payload
+#define SLAB_HEAP_RESERVE  (64 * 1024)   // Heap left for WiFi and the stack after reservation
+
+// Allocation tracking configuration
+#define TRACKING_TABLE_SIZE     512   // Initial slots in the tracking table, power of two
+#define TRACKING_MAX_LOAD_PCT   75    // Double the table beyond this load
+
+// Slot size and slot count per size class, smallest first
+static const size_t SLAB_CLASS_SIZES[SLAB_CLASS_COUNT] = { 64, 256, 1024, 4096, 16384, 65536 };
+static const size_t SLAB_CLASS_SLOTS[SLAB_CLASS_COUNT] = { 64, 32, 16, 6, 2, 1 };
 
 // Memory information structure
 struct MemoryInfo {
@@ -14,22 +31,45 @@ struct MemoryInfo {
   size_t freeHeap;
   size_t usedHeap;
   size_t largestFreeBlock;
-  int usagePercent;
+  size_t slabReserved;   // Bytes held by slab pools
+  size_t slabFree;       // Reserved bytes in free slots
+  int usagePercent;      // Counts free slab slots as available
   int fragmentation;
 };
 
-// Memory allocation tracking
+// Fixed-size slab pool, reserved as one contiguous block
+struct SlabClass {
+  size_t slotSize;         // Usable bytes per slot
+  size_t slotCount;
+  uint8_t* base;
+  void* freeList;          // Free slots, linked through their first word
+  size_t used;
+  size_t peakUsed;
+  unsigned long fallbacks; // Requests that found this class full
+};
+
+// Memory allocation tracking, one slot of the open-addressing table
 struct MemoryBlock {
-  void* ptr;
+  void* ptr;               // nullptr marks an empty slot
   size_t size;
   unsigned long allocTime;
-  String identifier;
-  MemoryBlock* next;
+  ResourceId identifier;   // Interned, so the table holds no heap strings
 };
 
 class MemoryManager {
 private:
-  MemoryBlock* allocatedBlocks;
+  // Held by every method that touches the tracking table or the slab pools;
+  // the fetch worker allocates response buffers from the other core
+  VramMutex lock;
+  
+  // Tracking table keyed on pointer, linear probing
+  MemoryBlock* blockTable;
+  size_t tableCapacity;
+  uint8_t tableShift;       // 32 - log2(tableCapacity), for homeSlot()
+  size_t trackedCount;
+  unsigned long untrackedCount;
+  
+  SlabClass slabs[SLAB_CLASS_COUNT];
   size_t totalAllocated;
   size_t peakUsage;
   unsigned long allocationCount;
@@ -40,26 +80,38 @@ private:
   static const int CRITICAL_USAGE_THRESHOLD = 90;
   static const int WARNING_USAGE_THRESHOLD = 75;
   
-  void addBlock(void* ptr, size_t size, const String& identifier);
-  void removeBlock(void* ptr);
+  void addBlock(void* ptr, size_t size, const ResourceId& identifier);
+  void removeBlock(MemoryBlock* block);
   MemoryBlock* findBlock(void* ptr);
+  size_t homeSlot(const void* ptr);
+  bool growTable();
+  
+  // Slab pools
+  void reserveSlabs();
+  void* slabAllocate(size_t size);
+  int slabClassOf(const void* ptr);
+  void slabFree(void* ptr, int classIndex);
+  void* acquire(size_t size);   // Slab slot or heap, untracked
+  void release(void* ptr);
   
 public:
   MemoryManager();
   ~MemoryManager();
   
   // Initialization
-  void begin();
+  void begin(size_t trackingCapacity = TRACKING_TABLE_SIZE);
   
   // Memory allocation with tracking
-  void* allocate(size_t size, const String& identifier = "");
-  void* reallocate(void* ptr, size_t newSize, const String& identifier = "");
+  void* allocate(size_t size, const ResourceId& identifier = ResourceId());
+  void* reallocate(void* ptr, size_t newSize, const ResourceId& identifier = ResourceId());
   void deallocate(void* ptr);
   
   // Memory information
   MemoryInfo getMemoryInfo();
   size_t getTotalAllocated() { return totalAllocated; }
   size_t getPeakUsage() { return peakUsage; }
+  size_t getTrackedCount() { return trackedCount; }
+  const SlabClass& getSlabClass(int index) { return slabs[index]; }
   
   // Memory optimization
   bool isMemoryLow();
@@ -85,46 +137,187 @@ extern MemoryManager memoryManager;
 
 // Implementation
 MemoryManager::MemoryManager() {
-  allocatedBlocks = nullptr;
+  blockTable = nullptr;
+  tableCapacity = 0;
+  tableShift = 32;
+  trackedCount = 0;
+  untrackedCount = 0;
   totalAllocated = 0;
   peakUsage = 0;
   allocationCount = 0;
   freeCount = 0;
+  
+  for (int i = 0; i < SLAB_CLASS_COUNT; i++) {
+    slabs[i].slotSize = SLAB_CLASS_SIZES[i] + SLAB_SLOT_SLACK;
+    slabs[i].slotCount = 0;
+    slabs[i].base = nullptr;
+    slabs[i].freeList = nullptr;
+    slabs[i].used = 0;
+    slabs[i].peakUsed = 0;
+    slabs[i].fallbacks = 0;
+  }
 }
 
 MemoryManager::~MemoryManager() {
   // Clean up all allocated blocks
-  MemoryBlock* current = allocatedBlocks;
-  while (current != nullptr) {
-    MemoryBlock* next = current->next;
-    free(current->ptr);
-    delete current;
-    current = next;
+  for (size_t i = 0; i < tableCapacity; i++) {
+    if (blockTable[i].ptr != nullptr) {
+      release(blockTable[i].ptr);
+    }
+    blockTable[i].~MemoryBlock();
+  }
+  free(blockTable);
+  
+  for (int i = 0; i < SLAB_CLASS_COUNT; i++) {
+    free(slabs[i].base);
   }
 }
 
-void MemoryManager::begin() {
-  Serial.println("MemoryManager: Initializing...");
+void MemoryManager::begin(size_t trackingCapacity) {
+  VramLock guard(lock);
+  VRAM_LOGI("MemoryManager: Initializing...");
+  
+  // Size the tracking table, rounded up to a power of two; it doubles as needed
+  if (blockTable == nullptr) {
+    tableCapacity = 16;
+    tableShift = 28;
+    while (tableCapacity < trackingCapacity) {
+      tableCapacity <<= 1;
+      tableShift--;
+    }
+    
+    blockTable = (MemoryBlock*)malloc(tableCapacity * sizeof(MemoryBlock));
+    if (blockTable == nullptr) {
+      VRAM_LOGW("WARNING: Allocation tracking disabled!");
+      tableCapacity = 0;
+    } else {
+      for (size_t i = 0; i < tableCapacity; i++) {
+        new (&blockTable[i]) MemoryBlock();
+        blockTable[i].ptr = nullptr;
+      }
+      VRAM_LOGI("Tracking table: %u slots (%u bytes)", 
+                    (unsigned)tableCapacity, (unsigned)(tableCapacity * sizeof(MemoryBlock)));
+    }
+  }
   
   MemoryInfo info = getMemoryInfo();
-  Serial.printf("Initial heap: %d bytes free, %d bytes total\n", 
-                info.freeHeap, info.totalHeap);
+  VRAM_LOGI("Initial heap: %u bytes free, %u bytes total", 
+                (unsigned)info.freeHeap, (unsigned)info.totalHeap);
   
   if (info.freeHeap < MIN_FREE_HEAP) {
-    Serial.println("WARNING: Low initial memory!");
+    VRAM_LOGW("WARNING: Low initial memory!");
   }
+  
+  reserveSlabs();
 }
 
-void* MemoryManager::allocate(size_t size, const String& identifier) {
-  // Check if allocation would cause memory issues
-  MemoryInfo info = getMemoryInfo();
-  if (info.freeHeap < size + MIN_FREE_HEAP) {
-    Serial.printf("Allocation failed: insufficient memory (requested: %d, available: %d)\n", 
-                  size, info.freeHeap);
+void MemoryManager::reserveSlabs() {
+  // Largest classes first, while the heap still has big contiguous blocks
+  for (int i = SLAB_CLASS_COUNT - 1; i >= 0; i--) {
+    SlabClass& slab = slabs[i];
+    if (slab.base != nullptr) continue;
+    
+    size_t bytes = slab.slotSize * SLAB_CLASS_SLOTS[i];
+    if (ESP.getFreeHeap() < bytes + SLAB_HEAP_RESERVE || ESP.getMaxAllocHeap() < bytes) {
+      VRAM_LOGW("Slab %uB: skipped, cannot reserve %u bytes", (unsigned)SLAB_CLASS_SIZES[i], (unsigned)bytes);
+      continue;
+    }
+    
+    slab.base = (uint8_t*)malloc(bytes);
+    if (slab.base == nullptr) continue;
+    
+    // Thread every slot onto the free list
+    slab.slotCount = SLAB_CLASS_SLOTS[i];
+    slab.freeList = nullptr;
+    for (size_t slot = slab.slotCount; slot > 0; slot--) {
+      void* slotPtr = slab.base + (slot - 1) * slab.slotSize;
+      *(void**)slotPtr = slab.freeList;
+      slab.freeList = slotPtr;
+    }
+    
+    VRAM_LOGI("Slab %uB: %u slots reserved (%u bytes)", 
+                  (unsigned)SLAB_CLASS_SIZES[i], (unsigned)slab.slotCount, (unsigned)bytes);
+  }
+}
+
+void* MemoryManager::slabAllocate(size_t size) {
+  for (int i = 0; i < SLAB_CLASS_COUNT; i++) {
+    if (slabs[i].slotSize < size) continue;
+    
+    // Best-fit class first, then one class up before giving up
+    for (int j = i; j < SLAB_CLASS_COUNT && j <= i + 1; j++) {
+      SlabClass& slab = slabs[j];
+      if (slab.freeList != nullptr) {
+        void* ptr = slab.freeList;
+        slab.freeList = *(void**)ptr;
+        slab.used++;
+        if (slab.used > slab.peakUsed) {
+          slab.peakUsed = slab.used;
+        }
+        return ptr;
+      }
+    }
+    
+    slabs[i].fallbacks++;
     return nullptr;
   }
   
-  void* ptr = malloc(size);
+  return nullptr;  // Larger than every class
+}
+
+int MemoryManager::slabClassOf(const void* ptr) {
+  const uint8_t* bytes = (const uint8_t*)ptr;
+  for (int i = 0; i < SLAB_CLASS_COUNT; i++) {
+    const SlabClass& slab = slabs[i];
+    if (slab.base != nullptr && bytes >= slab.base && 
+        bytes < slab.base + slab.slotSize * slab.slotCount) {
+      return i;
+    }
+  }
+  return -1;
+}
+
+void MemoryManager::slabFree(void* ptr, int classIndex) {
+  SlabClass& slab = slabs[classIndex];
+  *(void**)ptr = slab.freeList;
+  slab.freeList = ptr;
+  slab.used--;
+}
+
+void* MemoryManager::acquire(size_t size) {
+  void* ptr = slabAllocate(size);
+  return ptr != nullptr ? ptr : malloc(size);
+}
+
+void MemoryManager::release(void* ptr) {
+  if (ptr == nullptr) return;
+  
+  int classIndex = slabClassOf(ptr);
+  if (classIndex >= 0) {
+    slabFree(ptr, classIndex);
+  } else {
+    free(ptr);
+  }
+}
+
+void* MemoryManager::allocate(size_t size, const ResourceId& identifier) {
+  VramLock guard(lock);
+  
+  // Slab slots are already reserved, so only heap allocations need the check
+  void* ptr = slabAllocate(size);
+  
+  if (ptr == nullptr) {
+    // Check if allocation would cause memory issues
+    MemoryInfo info = getMemoryInfo();
+    if (info.freeHeap < size + MIN_FREE_HEAP) {
+      VRAM_LOGW("Allocation failed: insufficient memory (requested: %u, available: %u)", 
+                    (unsigned)size, (unsigned)info.freeHeap);
+      return nullptr;
+    }
+    
+    ptr = malloc(size);
+  }
+  
   if (ptr != nullptr) {
     addBlock(ptr, size, identifier);
     allocationCount++;
@@ -134,36 +327,58 @@ void* MemoryManager::allocate(size_t size, const String& identifier) {
       peakUsage = totalAllocated;
     }
     
-    Serial.printf("Allocated %d bytes for '%s' at %p\n", 
-                  size, identifier.c_str(), ptr);
+    VRAM_LOGD("Allocated %u bytes for '%s' at %p", 
+                  (unsigned)size, identifier.c_str(), ptr);
   } else {
-    Serial.printf("malloc failed for %d bytes\n", size);
+    VRAM_LOGE("malloc failed for %u bytes", (unsigned)size);
   }
   
   return ptr;
 }
 
-void* MemoryManager::reallocate(void* ptr, size_t newSize, const String& identifier) {
+void* MemoryManager::reallocate(void* ptr, size_t newSize, const ResourceId& identifier) {
+  VramLock guard(lock);
+  
   if (ptr == nullptr) {
     return allocate(newSize, identifier);
   }
   
+  // A block that could not be tracked is still ours to resize; its old
+  // size is then unknown, but a slot never holds more than slotSize
   MemoryBlock* block = findBlock(ptr);
-  if (block == nullptr) {
-    Serial.println("realloc: pointer not found in tracking");
-    return nullptr;
+  int classIndex = slabClassOf(ptr);
+  size_t oldSize;
+  if (block != nullptr) {
+    oldSize = block->size;
+  } else {
+    oldSize = classIndex >= 0 ? slabs[classIndex].slotSize : 0;
+    VRAM_LOGD("realloc: untracked block");
   }
   
-  size_t oldSize = block->size;
-  void* newPtr = realloc(ptr, newSize);
+  void* newPtr;
+  if (classIndex >= 0) {
+    if (newSize <= slabs[classIndex].slotSize) {
+      newPtr = ptr;  // Still fits the slot
+    } else {
+      newPtr = acquire(newSize);
+      if (newPtr != nullptr) {
+        memcpy(newPtr, ptr, min(oldSize, newSize));
+        slabFree(ptr, classIndex);
+      }
+    }
+  } else {
+    newPtr = realloc(ptr, newSize);
+  }
   
   if (newPtr != nullptr) {
-    // Update tracking
-    removeBlock(ptr);
+    // Update tracking; the slot is still valid, nothing touched the table
+    if (block != nullptr) {
+      removeBlock(block);
+    }
     addBlock(newPtr, newSize, identifier);
     
-    Serial.printf("Reallocated from %d to %d bytes for '%s'\n", 
-                  oldSize, newSize, identifier.c_str());
+    VRAM_LOGD("Reallocated from %u to %u bytes for '%s'", 
+                  (unsigned)oldSize, (unsigned)newSize, identifier.c_str());
   }
   
   return newPtr;
@@ -172,72 +387,147 @@ void* MemoryManager::reallocate(void* ptr, size_t newSize, const String& identif
 void MemoryManager::deallocate(void* ptr) {
   if (ptr == nullptr) return;
   
+  VramLock guard(lock);
+  
   MemoryBlock* block = findBlock(ptr);
   if (block != nullptr) {
-    Serial.printf("Freed %d bytes for '%s'\n", 
-                  block->size, block->identifier.c_str());
-    removeBlock(ptr);
+    VRAM_LOGD("Freed %u bytes for '%s'", 
+                  (unsigned)block->size, block->identifier.c_str());
+    removeBlock(block);
     freeCount++;
-  } else {
-    Serial.println("Free: pointer not found in tracking");
+  } else if (untrackedCount == 0) {
+    VRAM_LOGW("Free: pointer not found in tracking");
   }
   
-  free(ptr);
+  release(ptr);
+}
+
+size_t MemoryManager::homeSlot(const void* ptr) {
+  // Fibonacci hashing: the top bits of the product, which every bit of
+  // the key feeds. The low bits would keep the key's trailing zeros, and
+  // slab slots are 16-byte multiples
+  uint32_t key = (uint32_t)((uintptr_t)ptr >> 2);
+  return (uint32_t)(key * 2654435769u) >> tableShift;
 }
 
-void MemoryManager::addBlock(void* ptr, size_t size, const String& identifier) {
-  MemoryBlock* block = new MemoryBlock();
-  block->ptr = ptr;
-  block->size = size;
-  block->allocTime = millis();
-  block->identifier = identifier;
-  block->next = allocatedBlocks;
+void MemoryManager::addBlock(void* ptr, size_t size, const ResourceId& identifier) {
+  if (trackedCount * 100 >= tableCapacity * TRACKING_MAX_LOAD_PCT && !growTable()) {
+    // The block still works; only its size is missing from the totals
+    if (untrackedCount++ == 0) {
+      VRAM_LOGW("Tracking table full at %u blocks, totals now undercount", (unsigned)trackedCount);
+    }
+    return;
+  }
+  
+  size_t slot = homeSlot(ptr);
+  while (blockTable[slot].ptr != nullptr) {
+    slot = (slot + 1) & (tableCapacity - 1);
+  }
+  
+  MemoryBlock& block = blockTable[slot];
+  block.ptr = ptr;
+  block.size = size;
+  block.allocTime = millis();
+  block.identifier = identifier;
   
-  allocatedBlocks = block;
+  trackedCount++;
   totalAllocated += size;
 }
 
-void MemoryManager::removeBlock(void* ptr) {
-  MemoryBlock* current = allocatedBlocks;
-  MemoryBlock* previous = nullptr;
+void MemoryManager::removeBlock(MemoryBlock* block) {
+  totalAllocated -= block->size;
+  trackedCount--;
+  
+  // Backward-shift deletion keeps probe chains intact without tombstones
+  size_t mask = tableCapacity - 1;
+  size_t hole = block - blockTable;
+  size_t slot = hole;
+  
+  while (true) {
+    slot = (slot + 1) & mask;
+    if (blockTable[slot].ptr == nullptr) break;
+    
+    // Move the entry back unless its home lies cyclically in (hole, slot]
+    size_t home = homeSlot(blockTable[slot].ptr);
+    if (((slot - home) & mask) >= ((slot - hole) & mask)) {
+      blockTable[hole].ptr = blockTable[slot].ptr;
+      blockTable[hole].size = blockTable[slot].size;
+      blockTable[hole].allocTime = blockTable[slot].allocTime;
+      blockTable[hole].identifier = blockTable[slot].identifier;
+      hole = slot;
+    }
+  }
+  
+  blockTable[hole].ptr = nullptr;
+  blockTable[hole].identifier = ResourceId();
+}
+
+bool MemoryManager::growTable() {
+  if (tableCapacity == 0) return false;
+  
+  size_t newCapacity = tableCapacity * 2;
+  MemoryBlock* newTable = (MemoryBlock*)malloc(newCapacity * sizeof(MemoryBlock));
+  if (newTable == nullptr) {
+    return false;
+  }
+  for (size_t i = 0; i < newCapacity; i++) {
+    new (&newTable[i]) MemoryBlock();
+    newTable[i].ptr = nullptr;
+  }
+  
+  MemoryBlock* oldTable = blockTable;
+  size_t oldCapacity = tableCapacity;
+  blockTable = newTable;
+  tableCapacity = newCapacity;
+  tableShift--;
   
-  while (current != nullptr) {
-    if (current->ptr == ptr) {
-      if (previous != nullptr) {
-        previous->next = current->next;
-      } else {
-        allocatedBlocks = current->next;
+  size_t mask = newCapacity - 1;
+  for (size_t i = 0; i < oldCapacity; i++) {
+    if (oldTable[i].ptr != nullptr) {
+      size_t slot = homeSlot(oldTable[i].ptr);
+      while (blockTable[slot].ptr != nullptr) {
+        slot = (slot + 1) & mask;
       }
-      
-      totalAllocated -= current->size;
-      delete current;
-      return;
+      blockTable[slot] = oldTable[i];
     }
-    
-    previous = current;
-    current = current->next;
+    oldTable[i].~MemoryBlock();
   }
+  free(oldTable);
+  
+  VRAM_LOGD("Tracking table grown to %u slots", (unsigned)newCapacity);
+  return true;
 }
 
 MemoryBlock* MemoryManager::findBlock(void* ptr) {
-  MemoryBlock* current = allocatedBlocks;
-  while (current != nullptr) {
-    if (current->ptr == ptr) {
-      return current;
+  if (tableCapacity == 0) return nullptr;
+  
+  size_t slot = homeSlot(ptr);
+  while (blockTable[slot].ptr != nullptr) {
+    if (blockTable[slot].ptr == ptr) {
+      return &blockTable[slot];
     }
-    current = current->next;
+    slot = (slot + 1) & (tableCapacity - 1);
   }
   return nullptr;
 }
 
 MemoryInfo MemoryManager::getMemoryInfo() {
+  VramLock guard(lock);
   MemoryInfo info;
   
   info.freeHeap = ESP.getFreeHeap();
   info.totalHeap = ESP.getHeapSize();
   info.usedHeap = info.totalHeap - info.freeHeap;
   info.largestFreeBlock = ESP.getMaxAllocHeap();
-  info.usagePercent = (info.usedHeap * 100) / info.totalHeap;
+  
+  info.slabReserved = 0;
+  info.slabFree = 0;
+  for (int i = 0; i < SLAB_CLASS_COUNT; i++) {
+    info.slabReserved += slabs[i].slotSize * slabs[i].slotCount;
+    info.slabFree += slabs[i].slotSize * (slabs[i].slotCount - slabs[i].used);
+  }
+  size_t effectiveUsed = info.usedHeap > info.slabFree ? info.usedHeap - info.slabFree : 0;
+  info.usagePercent = (effectiveUsed * 100) / info.totalHeap;
   
   // Calculate fragmentation
   if (info.freeHeap > 0) {
@@ -261,7 +551,7 @@ bool MemoryManager::isMemoryCritical() {
 }
 
 void MemoryManager::forceGarbageCollection() {
-  Serial.println("Forcing garbage collection...");
+  VRAM_LOGI("Forcing garbage collection...");
   
   // On ESP32, we can't force GC directly, but we can encourage it
   // by temporarily allocating and freeing small blocks
@@ -273,7 +563,7 @@ void MemoryManager::forceGarbageCollection() {
     delay(1);
   }
   
-  Serial.println("Garbage collection attempt completed");
+  VRAM_LOGI("Garbage collection attempt completed");
 }
 
 size_t MemoryManager::getFragmentation() {
@@ -282,41 +572,62 @@ size_t MemoryManager::getFragmentation() {
 }
 
 void MemoryManager::printMemoryReport() {
+  VramLock guard(lock);
   MemoryInfo info = getMemoryInfo();
   
   Serial.println("\n=== Memory Report ===");
-  Serial.printf("Total Heap: %d bytes\n", info.totalHeap);
-  Serial.printf("Free Heap: %d bytes\n", info.freeHeap);
-  Serial.printf("Used Heap: %d bytes (%d%%)\n", info.usedHeap, info.usagePercent);
-  Serial.printf("Largest Free Block: %d bytes\n", info.largestFreeBlock);
+  Serial.printf("Total Heap: %u bytes\n", (unsigned)info.totalHeap);
+  Serial.printf("Free Heap: %u bytes\n", (unsigned)info.freeHeap);
+  Serial.printf("Used Heap: %u bytes (%d%%)\n", (unsigned)info.usedHeap, info.usagePercent);
+  Serial.printf("Largest Free Block: %u bytes\n", (unsigned)info.largestFreeBlock);
   Serial.printf("Fragmentation: %d%%\n", info.fragmentation);
-  Serial.printf("Tracked Allocations: %d bytes\n", totalAllocated);
-  Serial.printf("Peak Usage: %d bytes\n", peakUsage);
+  Serial.printf("Tracked Allocations: %u bytes\n", (unsigned)totalAllocated);
+  Serial.printf("Peak Usage: %u bytes\n", (unsigned)peakUsage);
   Serial.printf("Allocation Count: %lu\n", allocationCount);
   Serial.printf("Free Count: %lu\n", freeCount);
+  Serial.printf("Tracking Table: %u/%u slots, %lu untracked\n", 
+                (unsigned)trackedCount, (unsigned)tableCapacity, untrackedCount);
+  
+  Serial.println("\n=== Slab Pools ===");
+  for (int i = 0; i < SLAB_CLASS_COUNT; i++) {
+    const SlabClass& slab = slabs[i];
+    if (slab.slotCount == 0) {
+      Serial.printf("%5uB: not reserved (%lu fallbacks)\n", (unsigned)SLAB_CLASS_SIZES[i], slab.fallbacks);
+      continue;
+    }
+    Serial.printf("%5uB: %u/%u used (%d%%), peak %u, %lu fallbacks\n",
+                  (unsigned)SLAB_CLASS_SIZES[i], (unsigned)slab.used, (unsigned)slab.slotCount,
+                  (int)(slab.used * 100 / slab.slotCount), (unsigned)slab.peakUsed, slab.fallbacks);
+  }
   
   Serial.println("\n=== Tracked Blocks ===");
-  MemoryBlock* current = allocatedBlocks;
   int blockCount = 0;
-  while (current != nullptr) {
+  for (size_t i = 0; i < tableCapacity; i++) {
+    MemoryBlock& block = blockTable[i];
+    if (block.ptr == nullptr) continue;
+    
     blockCount++;
-    Serial.printf("Block %d: %d bytes, '%s', age: %lums\n", 
-                  blockCount, current->size, current->identifier.c_str(),
-                  millis() - current->allocTime);
-    current = current->next;
+    Serial.printf("Block %d: %u bytes, '%s', age: %lums\n", 
+                  blockCount, (unsigned)block.size, block.identifier.c_str(),
+                  millis() - block.allocTime);
   }
   Serial.println("=====================\n");
 }
 
 void MemoryManager::resetStatistics() {
+  VramLock guard(lock);
   allocationCount = 0;
   freeCount = 0;
   peakUsage = totalAllocated;
-  Serial.println("Memory statistics reset");
+  for (int i = 0; i < SLAB_CLASS_COUNT; i++) {
+    slabs[i].peakUsed = slabs[i].used;
+    slabs[i].fallbacks = 0;
+  }
+  VRAM_LOGI("Memory statistics reset");
 }
 
 void MemoryManager::emergencyCleanup() {
-  Serial.println("EMERGENCY: Critical memory condition!");
+  VRAM_LOGE("EMERGENCY: Critical memory condition!");
   
   // Force garbage collection
   forceGarbageCollection();
@@ -326,8 +637,8 @@ void MemoryManager::emergencyCleanup() {
   
   // If still critical, we might need to restart
   if (isMemoryCritical()) {
-    Serial.println("CRITICAL: Memory still low after cleanup!");
-    Serial.println("System may need restart...");
+    VRAM_LOGE("CRITICAL: Memory still low after cleanup!");
+    VRAM_LOGE("System may need restart...");
   }
 }
 
@@ -0,0 +1,168 @@
+/*
+ * Prefetcher for VRAM System
+ * Queues the resources the server says usually follow a fetch and loads
+ * them while the device is idle
+ */
+
+#ifndef PREFETCHER_H
+#define PREFETCHER_H
+
+#include <Arduino.h>
+#include <vector>
+#include "vram_log.h"
+#include "resource_id.h"
+#include "resource_cache.h"
+#include "resource_stream.h"
+
+// Prefetch configuration
+#define PREFETCH_QUEUE_SIZE  8      // Pending hints; the oldest is dropped when full
+#define PREFETCH_INTERVAL    2000   // Minimum gap between prefetch batches
+#define PREFETCH_BATCH       2      // Resources per prefetch batch
+#define PREFETCH_PRIORITY    PRIORITY_LOW  // Prefetched entries are the first to go
+
+/*
+ * Hints arrive in the X-Resource-Hints header of a resource response.
+ * Prefetched entries are stored at PREFETCH_PRIORITY, so they only ever
+ * displace other low priority entries, and the cache counts how many are
+ * read before being evicted.
+ */
+class Prefetcher {
+private:
+  ResourceId queue[PREFETCH_QUEUE_SIZE];
+  int queueHead;        // Oldest pending hint
+  int queueCount;
+  unsigned long lastBatchTime;
+  unsigned long issued;
+  unsigned long dropped;
+  
+  bool isQueued(const ResourceId& resourceId);
+  void push(const ResourceId& resourceId);
+  
+public:
+  Prefetcher();
+  
+  // Queue the ids in a comma-separated hints header, skipping cached ones
+  int addHints(const String& hints, ResourceCache& cache);
+  
+  // Hints are waiting and the last batch was long enough ago
+  bool isDue(unsigned long now);
+  
+  // Move up to PREFETCH_BATCH still-uncached hints into requests
+  int takeBatch(std::vector<ResourceRequest>& requests, ResourceCache& cache, unsigned long now);
+  
+  void clear();
+  int getPendingCount() { return queueCount; }
+  unsigned long getIssuedCount() { return issued; }
+  void printStats(ResourceCache& cache);
+};
+
+// Implementation
+Prefetcher::Prefetcher() {
+  queueHead = 0;
+  queueCount = 0;
+  lastBatchTime = 0;
+  issued = 0;
+  dropped = 0;
+}
+
+void Prefetcher::clear() {
+  for (int i = 0; i < PREFETCH_QUEUE_SIZE; i++) {
+    queue[i] = ResourceId();
+  }
+  queueHead = 0;
+  queueCount = 0;
+}
+
+bool Prefetcher::isQueued(const ResourceId& resourceId) {
+  for (int i = 0; i < queueCount; i++) {
+    if (queue[(queueHead + i) % PREFETCH_QUEUE_SIZE] == resourceId) {
+      return true;
+    }
+  }
+  return false;
+}
+
+void Prefetcher::push(const ResourceId& resourceId) {
+  // Fresh hints describe what is about to happen; old ones are dropped
+  if (queueCount == PREFETCH_QUEUE_SIZE) {
+    queue[queueHead] = ResourceId();
+    queueHead = (queueHead + 1) % PREFETCH_QUEUE_SIZE;
+    queueCount--;
+    dropped++;
+  }
+  
+  queue[(queueHead + queueCount) % PREFETCH_QUEUE_SIZE] = resourceId;
+  queueCount++;
+}
+
+int Prefetcher::addHints(const String& hints, ResourceCache& cache) {
+  int added = 0;
+  const char* cursor = hints.c_str();
+  
+  while (*cursor) {
+    const char* end = strchr(cursor, ',');
+    size_t length = end ? end - cursor : strlen(cursor);
+    
+    while (length > 0 && *cursor == ' ') {
+      cursor++;
+      length--;
+    }
+    
+    if (length > 0) {
+      // A name the table does not know is neither cached nor queued, and
+      // is interned only if it goes in the queue
+      ResourceId known = ResourceId::find(cursor, length);
+      if (!known.isValid() || (!cache.contains(known) && !isQueued(known))) {
+        ResourceId resourceId = known.isValid() ? known : ResourceId(cursor, length);
+        if (resourceId.isValid()) {
+          push(resourceId);
+          added++;
+        }
+      }
+    }
+    
+    if (!end) break;
+    cursor = end + 1;
+  }
+  
+  if (added > 0) {
+    VRAM_LOGD("Prefetch: queued %d hints (%d pending)", added, queueCount);
+  }
+  return added;
+}
+
+bool Prefetcher::isDue(unsigned long now) {
+  return queueCount > 0 && now - lastBatchTime >= PREFETCH_INTERVAL;
+}
+
+int Prefetcher::takeBatch(std::vector<ResourceRequest>& requests, ResourceCache& cache, unsigned long now) {
+  lastBatchTime = now;
+  int taken = 0;
+  
+  while (queueCount > 0 && taken < PREFETCH_BATCH) {
+    ResourceId resourceId = std::move(queue[queueHead]);  // The slot lets go of the name
+    queueHead = (queueHead + 1) % PREFETCH_QUEUE_SIZE;
+    queueCount--;
+    
+    // May have been fetched for real since it was hinted
+    if (cache.contains(resourceId)) {
+      continue;
+    }
+    
+    requests.push_back({ resourceId, PREFETCH_PRIORITY });
+    taken++;
+  }
+  
+  issued += taken;
+  return taken;
+}
+
+void Prefetcher::printStats(ResourceCache& cache) {
+  Serial.println("\n=== Prefetch ===");
+  Serial.printf("Pending: %d / %d\n", queueCount, PREFETCH_QUEUE_SIZE);
+  Serial.printf("Issued: %lu (dropped hints: %lu)\n", issued, dropped);
+  Serial.printf("Used: %d, evicted unused: %d\n", cache.getPrefetchHits(), cache.getPrefetchWasted());
+  Serial.println("================\n");
+}
+
+#endif // PREFETCHER_H
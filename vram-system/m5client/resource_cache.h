@@ -1,63 +1,323 @@
 /*
  * Resource Cache for VRAM System
  * Implements intelligent caching with LRU algorithm and priority management
+ * Safe to share between tasks; ResourceView pins a payload while it is read
  */
 
 #ifndef RESOURCE_CACHE_H
 #define RESOURCE_CACHE_H
 
 #include <Arduino.h>
-#include <map>
+#include "vram_log.h"
 #include <vector>
+#include <algorithm>
+#include "memory_manager.h"
+#include "resource_id.h"
+#include "vram_lock.h"
+#include "telemetry.h"
 
 // Priority levels
 #define PRIORITY_CRITICAL   1
 #define PRIORITY_IMPORTANT  2
 #define PRIORITY_NORMAL     3
 #define PRIORITY_LOW        4
+#define PRIORITY_LEVELS     (PRIORITY_LOW + 1)  // Arrays indexed by priority; slot 0 unused
 
 // Cache configuration
-#define MAX_CACHE_SIZE      (256 * 1024)  // 256KB cache limit
+#define MAX_CACHE_SIZE      (256 * 1024)  // 256KB budget ceiling; adaptBudget() works below it
 #define MAX_RESOURCE_SIZE   (64 * 1024)   // 64KB per resource limit
+#define RESOURCE_PAGE_SIZE  4096          // Larger resources are cached in pages of this size
+#define CACHE_NO_PAGE       0xFFFF        // Page number of a whole-resource entry
 #define CACHE_ENTRY_OVERHEAD 64           // Estimated overhead per entry
+#define CACHE_PERSIST_MAX_PRIORITY PRIORITY_IMPORTANT  // Entries at or above this survive reboots
+#define CACHE_INDEX_INITIAL_SIZE 32       // Index slots, power of two
+#define CACHE_INDEX_MAX_LOAD_PCT 75       // Grow the index beyond this load
+#define CACHE_STALE_AGE     300000        // PriorityPolicy: same-priority entries idle this long may go
+#define CACHE_STALE_HITS    3             // ...if they were used fewer times than this
+#define EXPIRY_HEAP_INITIAL_SIZE 16       // Expiry heap slots, grown by doubling
+#define EXPIRY_MAX_PER_TICK 4             // Most due entries expireDue() handles per call
+#define EXPIRY_RETRY_DELAY  1000          // A due entry still being viewed is retried after this
+
+// Adaptive budget: adaptBudget() moves the limit between these bounds
+#define BUDGET_MIN_SIZE        (32 * 1024)   // Never shrink below this
+#define BUDGET_LOW_WATERMARK   (48 * 1024)   // Free heap below this starts shrinking
+#define BUDGET_HIGH_WATERMARK  (80 * 1024)   // ...which goes on until free heap is back above this
+#define BUDGET_MIN_FREE_BLOCK  (16 * 1024)   // Largest free block below this is pressure too
+#define BUDGET_FRAGMENTATION_PCT 50          // ...if the heap is at least this fragmented
+#define BUDGET_STEP            (8 * 1024)    // Most bytes evicted per call
+#define BUDGET_GROW_STEP       (16 * 1024)   // Most bytes regained per call once pressure ends
 
 // Cache entry structure
 struct CacheEntry {
-  String resourceId;
-  String data;
+  ResourceId resourceId;
+  uint16_t page;      // Page of a paged resource, CACHE_NO_PAGE for a whole one
+  uint8_t* data;      // Payload bytes, NUL-terminated one past length
+  size_t length;      // Payload length in bytes
   int priority;
   size_t size;
+  String hash;        // Server content hash, empty if unknown
+  int version;        // Server version, 0 if unknown
+  unsigned long validatedTime;  // Last confirmed current by the server, 0 if never
+  unsigned long ttl;        // Server lifetime in ms from each load or validation, 0 for none
+  unsigned long expiresAt;  // millis() deadline while scheduled
+  int expiryIndex;          // 1-based position in the expiry heap, 0 if not scheduled
+  size_t indexSlot;         // Position in the index, kept current as slots move
   unsigned long accessTime;
   unsigned long createTime;
   int accessCount;
+  bool prefetched;    // Loaded ahead of use and not read since
+  uint16_t pins;      // Live ResourceViews of data
   CacheEntry* prev;
   CacheEntry* next;
+  
+  // Eviction order, owned by the active EvictionPolicy
+  CacheEntry* policyPrev;
+  CacheEntry* policyNext;
+  uint16_t policyCount;   // Policy-defined, e.g. a use count
+  uint8_t policySegment;  // Policy-defined, e.g. which list holds the entry
+};
+
+// Intrusive list over the policy links, head hottest, tail coldest
+struct PolicyList {
+  CacheEntry* head;
+  CacheEntry* tail;
+  size_t count;
+  
+  void reset();
+  void pushHead(CacheEntry* entry);
+  void insertBefore(CacheEntry* position, CacheEntry* entry);  // nullptr appends at the tail
+  void remove(CacheEntry* entry);
+  void moveToHead(CacheEntry* entry);
+  CacheEntry* coldest(int minPriority);  // Tail-most unpinned entry of minPriority or less important
+};
+
+// One PolicyList per priority. A victim of minPriority or less important
+// is then found among the level tails, without walking past entries the
+// store may not evict. `colder` picks between two tails; recency by default.
+struct PriorityLists {
+  PolicyList levels[PRIORITY_LEVELS];
+  
+  void reset();
+  size_t count();
+  void pushHead(CacheEntry* entry) { levels[entry->priority].pushHead(entry); }
+  void remove(CacheEntry* entry) { levels[entry->priority].remove(entry); }
+  void moveToHead(CacheEntry* entry) { levels[entry->priority].moveToHead(entry); }
+  void changePriority(CacheEntry* entry, int oldPriority);
+  CacheEntry* tail();  // Coldest entry of any priority, pinned or not
+  CacheEntry* coldest(int minPriority, CacheEntry* (*colder)(CacheEntry*, CacheEntry*) = older);
+  
+  static CacheEntry* older(CacheEntry* a, CacheEntry* b);  // Less recently used; either may be nullptr
+};
+
+/*
+ * Decides which entry leaves the cache next. The cache reports every
+ * insert, hit, miss and removal; policies keep their ordering in the
+ * policy links of each entry, so they need no allocations of their own.
+ *
+ * selectVictim() never returns a pinned entry, nor one more important
+ * than minPriority (a lower number). With reclaim false the cache is making room for an
+ * entry of minPriority and the policy may refuse; with reclaim true
+ * memory is needed regardless and any eligible entry should be offered.
+ * The returned entry is evicted before the next call.
+ */
+class EvictionPolicy {
+public:
+  virtual ~EvictionPolicy() {}
+  
+  virtual const char* getName() = 0;
+  virtual void onInsert(CacheEntry* entry) = 0;
+  virtual void onAccess(CacheEntry* entry) = 0;
+  virtual void onRemove(CacheEntry* entry) = 0;
+  virtual void onMiss(const ResourceId& resourceId) {}
+  virtual void onPriorityChange(CacheEntry* entry, int oldPriority) {}
+  virtual CacheEntry* selectVictim(int minPriority, bool reclaim) = 0;
+  virtual void clear() = 0;  // Forget all entries without touching them
+  
+  // Bytes selectVictim() would free for the same arguments, counted no
+  // further than `needed`. levelBytes holds the unpinned bytes per priority.
+  virtual size_t evictableBytes(const size_t* levelBytes, int minPriority, bool reclaim, size_t needed);
+};
+
+// One LRU list per priority: the least important level goes first, and
+// an entry of the incoming priority only once it is idle and rarely used.
+// Pages keep lists of their own and are plain LRU at every level: a range
+// request brings one back, and a paged read must be able to cycle its
+// working set. Victims come from list tails; only pinned entries are skipped.
+class PriorityPolicy : public EvictionPolicy {
+protected:
+  PolicyList levels[PRIORITY_LEVELS];
+  PolicyList pageLevels[PRIORITY_LEVELS];
+  
+  PolicyList& listFor(CacheEntry* entry, int priority);
+  static bool isStale(CacheEntry* entry, unsigned long now);
+  
+public:
+  PriorityPolicy() { clear(); }
+  
+  const char* getName() override { return "Priority LRU"; }
+  void onInsert(CacheEntry* entry) override { listFor(entry, entry->priority).pushHead(entry); }
+  void onAccess(CacheEntry* entry) override { listFor(entry, entry->priority).moveToHead(entry); }
+  void onRemove(CacheEntry* entry) override { listFor(entry, entry->priority).remove(entry); }
+  void onPriorityChange(CacheEntry* entry, int oldPriority) override;
+  CacheEntry* selectVictim(int minPriority, bool reclaim) override;
+  size_t evictableBytes(const size_t* levelBytes, int minPriority, bool reclaim, size_t needed) override;
+  void clear() override;
+};
+
+// Metadata of an entry held by a second tier
+struct TierRecord {
+  size_t length;
+  int priority;
+  String hash;
+  int version;
+};
+
+// Slower store that evicted entries are demoted into instead of being dropped
+class CacheTier {
+public:
+  virtual ~CacheTier() {}
+  
+  virtual bool put(const CacheEntry& entry) = 0;  // Copies the payload
+  virtual uint8_t* read(const ResourceId& resourceId, TierRecord& record) = 0;  // VRAM_MALLOC copy; the tier keeps its own
+  virtual bool contains(const ResourceId& resourceId) = 0;
+  virtual bool remove(const ResourceId& resourceId) = 0;
+  
+  virtual const char* getName() = 0;
+  virtual int getCount() = 0;
+  virtual size_t getSize() = 0;
+  virtual size_t getMaxSize() = 0;
+};
+
+class ResourceCache;
+
+/*
+ * Pinned, read-only view of a cached payload. The bytes stay valid for
+ * the life of the view, even if another task evicts, replaces or removes
+ * the entry meanwhile; the cache then frees them when the last view goes.
+ * Views move but do not copy.
+ */
+class ResourceView {
+private:
+  ResourceCache* cache;
+  ResourceId resourceId;
+  uint16_t page;
+  const uint8_t* data;
+  size_t length;
+  
+  friend class ResourceCache;
+  ResourceView(ResourceCache* owner, const ResourceId& id, uint16_t pageNumber, const uint8_t* bytes, size_t size)
+    : cache(owner), resourceId(id), page(pageNumber), data(bytes), length(size) {}
+  
+public:
+  ResourceView() : cache(nullptr), page(CACHE_NO_PAGE), data(nullptr), length(0) {}
+  ResourceView(ResourceView&& other);
+  ResourceView& operator=(ResourceView&& other);
+  ~ResourceView() { release(); }
+  
+  ResourceView(const ResourceView&) = delete;
+  ResourceView& operator=(const ResourceView&) = delete;
+  
+  bool isValid() const { return data != nullptr; }
+  const ResourceId& getResourceId() const { return resourceId; }
+  uint16_t getPage() const { return page; }  // CACHE_NO_PAGE for a whole resource
+  const uint8_t* getData() const { return data; }
+  const char* c_str() const { return data ? (const char*)data : ""; }  // NUL-terminated
+  size_t getLength() const { return length; }
+  
+  void release();  // Unpin early; the view becomes invalid
 };
 
 class ResourceCache {
 private:
+  // One recursive lock over all cache state. Operations are short and
+  // every one touches the shared LRU list, so finer locks would buy little.
+  VramMutex lock;
+  
   // LRU linked list
   CacheEntry* head;
   CacheEntry* tail;
   
-  // Hash map for O(1) access
-  std::map<String, CacheEntry*> cacheMap;
+  // Open-addressing index over the entries themselves; the LRU links live
+  // in each entry, so an entry is one allocation shared by both structures
+  CacheEntry** indexTable;
+  size_t indexCapacity;
+  size_t indexGeneration;  // Bumped when slots move, invalidating probe results
   
   // Cache statistics
   size_t totalCacheSize;
-  size_t maxCacheSize;
+  size_t maxCacheSize;       // Current budget
+  size_t budgetCeiling;      // From setMaxCacheSize()
+  bool underPressure;        // Between the low and high watermarks on the way down
+  int budgetSteps;           // adaptBudget() calls that evicted
   int totalEntries;
+  int pageEntries;    // Part of totalEntries holding pages
+  size_t priorityBytes[PRIORITY_LEVELS];  // Charged bytes per priority, overhead included
+  size_t pinnedBytes[PRIORITY_LEVELS];    // Part of priorityBytes held by views, so not evictable
   int cacheHits;
   int cacheMisses;
   int evictions;
+  int prefetchHits;
+  int prefetchWasted;
+  
+  // Eviction
+  PriorityPolicy defaultPolicy;
+  EvictionPolicy* policy;
+  
+  // Second tier
+  CacheTier* secondTier;
+  int tierHits;
+  int tierMisses;
+  int demotions;
+  
+  // Operation timings and evictions, if attached
+  Telemetry* telemetry;
+  
+  // Bumped whenever a persistent entry changes, so snapshots know when to save
+  unsigned long persistGeneration;
+  
+  // Entries that left the cache while pinned, linked through next
+  CacheEntry* retired;
+  int retiredCount;
+  size_t retiredBytes;
+  
+  // Min-heap of entries with a TTL, earliest deadline first, so expiry
+  // costs O(log n) per entry instead of a scan of the cache
+  CacheEntry** expiryHeap;
+  int expiryCount;
+  int expiryCapacity;
+  int expirations;
   
   // Internal methods
   void moveToHead(CacheEntry* entry);
   void removeEntry(CacheEntry* entry);
   void addToHead(CacheEntry* entry);
   CacheEntry* removeTail();
-  bool shouldEvict(CacheEntry* entry, int newPriority);
-  size_t calculateEntrySize(const String& data);
+  void destroyEntry(CacheEntry* entry);
+  void retire(CacheEntry* entry);
+  void pin(CacheEntry* entry);
+  void unpin(const ResourceId& resourceId, uint16_t page, const uint8_t* data);  // From ResourceView
+  friend class ResourceView;
+  void markPersistentChange(int priority);
+  void evict(CacheEntry* entry);
+  bool adoptEntry(const ResourceId& resourceId, uint16_t page, uint8_t* data, size_t length, int priority);
+  bool removeFromMemory(const ResourceId& resourceId, uint16_t page = CACHE_NO_PAGE);
+  void dropEntry(CacheEntry* entry);  // Unlinks from every structure and destroys, no lookup
+  bool promote(const ResourceId& resourceId);
+  void recordHit(CacheEntry* entry);
+  
+  // Index, keyed by id and page
+  size_t homeSlot(const ResourceId& resourceId, uint16_t page);
+  size_t probeSlot(const ResourceId& resourceId, uint16_t page);  // Match or empty slot
+  CacheEntry* findEntry(const ResourceId& resourceId, uint16_t page = CACHE_NO_PAGE);
+  void removeSlot(size_t slot);
+  bool growIndex();
+  
+  // Expiry heap
+  void armExpiry(CacheEntry* entry);  // Schedules ttl from now, or unschedules
+  void scheduleExpiry(CacheEntry* entry, unsigned long deadline);
+  void unscheduleExpiry(CacheEntry* entry);
+  void placeExpiry(int position, CacheEntry* entry);
+  void siftExpiry(int position);
   
 public:
   ResourceCache();
@@ -66,23 +326,53 @@ public:
   // Initialization
   void begin();
   void setMaxCacheSize(size_t maxSize);
+  void setSecondTier(CacheTier* tier);  // nullptr drops evicted entries outright
+  void setEvictionPolicy(EvictionPolicy* newPolicy);  // nullptr restores PriorityPolicy
+  void setTelemetry(Telemetry* target) { telemetry = target; }  // nullptr stops recording
+  EvictionPolicy* getEvictionPolicy() { return policy; }
   
   // Cache operations
-  bool store(const String& resourceId, const String& data, int priority, size_t dataSize = 0);
-  String get(const String& resourceId);
-  bool contains(const String& resourceId);
-  bool remove(const String& resourceId);
+  bool store(const ResourceId& resourceId, const String& data, int priority);
+  bool store(const ResourceId& resourceId, const uint8_t* data, size_t length, int priority);
+  bool adopt(const ResourceId& resourceId, uint8_t* data, size_t length, int priority);  // Takes ownership of a VRAM_MALLOC buffer
+  String get(const ResourceId& resourceId);
+  ResourceView view(const ResourceId& resourceId);  // Counted like get(), without the copy
+  bool getInto(const ResourceId& resourceId, uint8_t* buffer, size_t bufferSize, size_t& length);  // Copies up to bufferSize bytes; length is the full payload size
+  
+  // Unpinned: valid until the entry changes, so only for the task that changes it
+  const uint8_t* getBytes(const ResourceId& resourceId, size_t& length);
+  const CacheEntry* peek(const ResourceId& resourceId);  // No stats or LRU update
+  bool contains(const ResourceId& resourceId);
+  bool setVersion(const ResourceId& resourceId, const String& hash, int version);
+  bool markValidated(const ResourceId& resourceId, bool validated = true);  // Also restarts the TTL
+  bool setTtl(const ResourceId& resourceId, unsigned long ttl);  // ms from now, 0 for none; critical entries never expire
+  bool markPrefetched(const ResourceId& resourceId);  // Counted as a prefetch hit on first read
+  bool remove(const ResourceId& resourceId);  // Its pages too
   void clear();
   
+  // Pages of resources over MAX_RESOURCE_SIZE, each up to RESOURCE_PAGE_SIZE
+  // bytes. Every page is evicted on its own; ResourcePager faults them in.
+  bool adoptPage(const ResourceId& resourceId, uint16_t page, uint8_t* data, size_t length, int priority);
+  ResourceView viewPage(const ResourceId& resourceId, uint16_t page);
+  bool containsPage(const ResourceId& resourceId, uint16_t page);
+  int removePages(const ResourceId& resourceId);
+  
   // Memory management
   int freeMemory(size_t targetBytes);
   void optimizeCache();
   bool makeSpaceFor(size_t requiredSize, int priority);
   
+  // Resize the budget to the heap and evict at most BUDGET_STEP bytes
+  // toward it; call every loop. Returns the entries evicted.
+  int adaptBudget(const MemoryInfo& info);
+  
   // Cache information
   int getResourceCount() { return totalEntries; }
+  int getPageCount() { return pageEntries; }
   size_t getCacheSize() { return totalCacheSize; }
   size_t getMaxCacheSize() { return maxCacheSize; }
+  size_t getBudgetCeiling() { return budgetCeiling; }
+  bool isUnderPressure() { return underPressure; }
   float getCacheUtilization() { return (float)totalCacheSize / maxCacheSize; }
   
   // Statistics
@@ -90,38 +380,283 @@ public:
   void resetStats();
   int getCacheHits() { return cacheHits; }
   int getCacheMisses() { return cacheMisses; }
-  float getHitRate() { return (float)cacheHits / (cacheHits + cacheMisses); }
+  int getEvictions() { return evictions; }
+  int getTierHits() { return tierHits; }
+  int getTierMisses() { return tierMisses; }
+  int getPrefetchHits() { return prefetchHits; }
+  int getPrefetchWasted() { return prefetchWasted; }
+  float getHitRate() { return cacheHits + cacheMisses > 0 ? (float)cacheHits / (cacheHits + cacheMisses) : 0.0f; }
+  unsigned long getPersistGeneration() { return persistGeneration; }
+  int getRetiredCount() { return retiredCount; }
   
   // Cache maintenance
-  void cleanupExpired(unsigned long maxAge = 3600000);  // 1 hour default
-  std::vector<String> getResourcesByPriority(int priority);
-  void updatePriority(const String& resourceId, int newPriority);
+  int expireDue(unsigned long now, int maxCount = EXPIRY_MAX_PER_TICK);  // Call every loop; returns entries removed
+  std::vector<ResourceId> getResourcesByPriority(int priority);  // Whole resources only, as below
+  std::vector<ResourceId> getStaleResources(unsigned long maxAge, size_t maxCount);  // Oldest validation first
+  void updatePriority(const ResourceId& resourceId, int newPriority);
 };
 
 // Implementation
+void PolicyList::reset() {
+  head = nullptr;
+  tail = nullptr;
+  count = 0;
+}
+
+void PolicyList::pushHead(CacheEntry* entry) {
+  insertBefore(head, entry);
+}
+
+void PolicyList::insertBefore(CacheEntry* position, CacheEntry* entry) {
+  entry->policyNext = position;
+  entry->policyPrev = position ? position->policyPrev : tail;
+  
+  if (entry->policyPrev) {
+    entry->policyPrev->policyNext = entry;
+  } else {
+    head = entry;
+  }
+  
+  if (position) {
+    position->policyPrev = entry;
+  } else {
+    tail = entry;
+  }
+  count++;
+}
+
+void PolicyList::remove(CacheEntry* entry) {
+  if (entry->policyPrev) {
+    entry->policyPrev->policyNext = entry->policyNext;
+  } else {
+    head = entry->policyNext;
+  }
+  
+  if (entry->policyNext) {
+    entry->policyNext->policyPrev = entry->policyPrev;
+  } else {
+    tail = entry->policyPrev;
+  }
+  
+  entry->policyPrev = nullptr;
+  entry->policyNext = nullptr;
+  count--;
+}
+
+void PolicyList::moveToHead(CacheEntry* entry) {
+  if (entry == head) return;
+  
+  remove(entry);
+  pushHead(entry);
+}
+
+CacheEntry* PolicyList::coldest(int minPriority) {
+  for (CacheEntry* entry = tail; entry != nullptr; entry = entry->policyPrev) {
+    if (entry->priority >= minPriority && entry->pins == 0) {
+      return entry;
+    }
+  }
+  return nullptr;
+}
+
+void PriorityLists::reset() {
+  for (int level = 0; level < PRIORITY_LEVELS; level++) {
+    levels[level].reset();
+  }
+}
+
+size_t PriorityLists::count() {
+  size_t total = 0;
+  for (int level = PRIORITY_CRITICAL; level <= PRIORITY_LOW; level++) {
+    total += levels[level].count;
+  }
+  return total;
+}
+
+void PriorityLists::changePriority(CacheEntry* entry, int oldPriority) {
+  levels[oldPriority].remove(entry);
+  levels[entry->priority].pushHead(entry);
+}
+
+CacheEntry* PriorityLists::tail() {
+  CacheEntry* coldest = nullptr;
+  for (int level = PRIORITY_CRITICAL; level <= PRIORITY_LOW; level++) {
+    coldest = older(coldest, levels[level].tail);
+  }
+  return coldest;
+}
+
+CacheEntry* PriorityLists::coldest(int minPriority, CacheEntry* (*colder)(CacheEntry*, CacheEntry*)) {
+  // Every entry of a level is eligible, so only pinned ones are walked
+  // past. Less important levels come first and win ties.
+  CacheEntry* victim = nullptr;
+  for (int level = PRIORITY_LOW; level >= max(minPriority, PRIORITY_CRITICAL); level--) {
+    CacheEntry* entry = levels[level].coldest(level);
+    if (entry != nullptr) {
+      victim = victim ? colder(victim, entry) : entry;
+    }
+  }
+  return victim;
+}
+
+CacheEntry* PriorityLists::older(CacheEntry* a, CacheEntry* b) {
+  if (a == nullptr || b == nullptr) {
+    return a ? a : b;
+  }
+  return (long)(a->accessTime - b->accessTime) <= 0 ? a : b;
+}
+
+size_t EvictionPolicy::evictableBytes(const size_t* levelBytes, int minPriority, bool reclaim, size_t needed) {
+  // Policies that may take any eligible entry
+  size_t total = 0;
+  for (int level = max(minPriority, PRIORITY_CRITICAL); level <= PRIORITY_LOW; level++) {
+    total += levelBytes[level];
+  }
+  return total;
+}
+
+void PriorityPolicy::clear() {
+  for (int level = 0; level < PRIORITY_LEVELS; level++) {
+    levels[level].reset();
+    pageLevels[level].reset();
+  }
+}
+
+PolicyList& PriorityPolicy::listFor(CacheEntry* entry, int priority) {
+  return entry->page == CACHE_NO_PAGE ? levels[priority] : pageLevels[priority];
+}
+
+void PriorityPolicy::onPriorityChange(CacheEntry* entry, int oldPriority) {
+  listFor(entry, oldPriority).remove(entry);
+  listFor(entry, entry->priority).pushHead(entry);
+}
+
+bool PriorityPolicy::isStale(CacheEntry* entry, unsigned long now) {
+  // Evict if not accessed recently and low access count
+  return now - entry->accessTime > CACHE_STALE_AGE && entry->accessCount < CACHE_STALE_HITS;
+}
+
+CacheEntry* PriorityPolicy::selectVictim(int minPriority, bool reclaim) {
+  // Always evict lower priority
+  for (int level = PRIORITY_LOW; level > minPriority; level--) {
+    CacheEntry* entry = PriorityLists::older(levels[level].coldest(level), pageLevels[level].coldest(level));
+    if (entry != nullptr) {
+      return entry;
+    }
+  }
+  
+  if (minPriority < PRIORITY_CRITICAL || minPriority > PRIORITY_LOW) {
+    return nullptr;
+  }
+  
+  CacheEntry* page = pageLevels[minPriority].coldest(minPriority);
+  if (reclaim) {
+    return PriorityLists::older(levels[minPriority].coldest(minPriority), page);
+  }
+  if (page != nullptr) {
+    return page;
+  }
+  
+  // For same priority, consider age and access frequency. Only the idle
+  // end of the list can qualify, so the walk stops at the first recent entry.
+  unsigned long now = millis();
+  for (CacheEntry* entry = levels[minPriority].tail; entry != nullptr; entry = entry->policyPrev) {
+    if (now - entry->accessTime <= CACHE_STALE_AGE) break;
+    if (isStale(entry, now) && entry->pins == 0) return entry;
+  }
+  return nullptr;
+}
+
+size_t PriorityPolicy::evictableBytes(const size_t* levelBytes, int minPriority, bool reclaim, size_t needed) {
+  size_t total = 0;
+  for (int level = PRIORITY_LOW; level > minPriority; level--) {
+    total += levelBytes[level];
+  }
+  
+  if (minPriority < PRIORITY_CRITICAL || minPriority > PRIORITY_LOW || total >= needed) {
+    return total;
+  }
+  if (reclaim) {
+    return total + levelBytes[minPriority];
+  }
+  
+  for (CacheEntry* entry = pageLevels[minPriority].tail; entry != nullptr && total < needed; entry = entry->policyPrev) {
+    if (entry->pins == 0) {
+      total += entry->size + CACHE_ENTRY_OVERHEAD;
+    }
+  }
+  
+  unsigned long now = millis();
+  for (CacheEntry* entry = levels[minPriority].tail; entry != nullptr && total < needed; entry = entry->policyPrev) {
+    if (now - entry->accessTime <= CACHE_STALE_AGE) break;
+    if (isStale(entry, now) && entry->pins == 0) {
+      total += entry->size + CACHE_ENTRY_OVERHEAD;
+    }
+  }
+  return total;
+}
+
 ResourceCache::ResourceCache() {
   head = nullptr;
   tail = nullptr;
+  indexCapacity = CACHE_INDEX_INITIAL_SIZE;
+  indexTable = (CacheEntry**)calloc(indexCapacity, sizeof(CacheEntry*));
+  indexGeneration = 0;
   totalCacheSize = 0;
   maxCacheSize = MAX_CACHE_SIZE;
+  budgetCeiling = MAX_CACHE_SIZE;
+  underPressure = false;
+  budgetSteps = 0;
   totalEntries = 0;
+  pageEntries = 0;
+  memset(priorityBytes, 0, sizeof(priorityBytes));
+  memset(pinnedBytes, 0, sizeof(pinnedBytes));
   cacheHits = 0;
   cacheMisses = 0;
   evictions = 0;
+  prefetchHits = 0;
+  prefetchWasted = 0;
+  policy = &defaultPolicy;
+  secondTier = nullptr;
+  tierHits = 0;
+  tierMisses = 0;
+  demotions = 0;
+  telemetry = nullptr;
+  persistGeneration = 0;
+  retired = nullptr;
+  retiredCount = 0;
+  retiredBytes = 0;
+  expiryHeap = nullptr;
+  expiryCount = 0;
+  expiryCapacity = 0;
+  expirations = 0;
 }
 
 ResourceCache::~ResourceCache() {
   clear();
+  free(indexTable);
+  free(expiryHeap);
+  
+  // Views must not outlive the cache; drop whatever they still pin
+  while (retired != nullptr) {
+    CacheEntry* next = retired->next;
+    retired->pins = 0;
+    destroyEntry(retired);
+    retired = next;
+  }
 }
 
 void ResourceCache::begin() {
-  Serial.println("ResourceCache: Initializing...");
+  VramLock guard(lock);
+  VRAM_LOGI("ResourceCache: Initializing...");
   clear();
-  Serial.printf("Cache initialized with max size: %d bytes\n", maxCacheSize);
+  VRAM_LOGI("Cache initialized with max size: %u bytes", (unsigned)maxCacheSize);
 }
 
 void ResourceCache::setMaxCacheSize(size_t maxSize) {
+  VramLock guard(lock);
   maxCacheSize = maxSize;
+  budgetCeiling = maxSize;
   
   // If current cache exceeds new limit, trigger cleanup
   if (totalCacheSize > maxCacheSize) {
@@ -129,167 +664,522 @@ void ResourceCache::setMaxCacheSize(size_t maxSize) {
   }
 }
 
-bool ResourceCache::store(const String& resourceId, const String& data, int priority, size_t dataSize) {
-  // Calculate entry size
-  size_t entrySize = dataSize > 0 ? dataSize : calculateEntrySize(data);
+void ResourceCache::setEvictionPolicy(EvictionPolicy* newPolicy) {
+  VramLock guard(lock);
+  if (newPolicy == nullptr) {
+    newPolicy = &defaultPolicy;
+  }
+  
+  // Hand the entries over coldest first, so recency carries across
+  policy->clear();
+  newPolicy->clear();
+  for (CacheEntry* entry = tail; entry != nullptr; entry = entry->prev) {
+    newPolicy->onInsert(entry);
+  }
   
+  policy = newPolicy;
+  VRAM_LOGI("Cache eviction policy: %s", policy->getName());
+}
+
+void ResourceCache::setSecondTier(CacheTier* tier) {
+  VramLock guard(lock);
+  secondTier = tier;
+  if (tier) {
+    VRAM_LOGI("Cache second tier: %s (%u bytes)", tier->getName(), (unsigned)tier->getMaxSize());
+  }
+}
+
+bool ResourceCache::store(const ResourceId& resourceId, const String& data, int priority) {
+  return store(resourceId, (const uint8_t*)data.c_str(), data.length(), priority);
+}
+
+bool ResourceCache::store(const ResourceId& resourceId, const uint8_t* data, size_t length, int priority) {
+  // Check before copying so oversized resources never touch the heap
+  if (length > MAX_RESOURCE_SIZE) {
+    VRAM_LOGW("Resource %s too large (%u bytes), max allowed: %d", 
+                  resourceId.c_str(), (unsigned)length, MAX_RESOURCE_SIZE);
+    return false;
+  }
+  
+  uint8_t* copy = (uint8_t*)VRAM_MALLOC(length + 1, resourceId);
+  if (copy == nullptr) {
+    return false;
+  }
+  
+  memcpy(copy, data, length);
+  copy[length] = '\0';
+  return adopt(resourceId, copy, length, priority);
+}
+
+bool ResourceCache::adopt(const ResourceId& resourceId, uint8_t* data, size_t length, int priority) {
+  return adoptEntry(resourceId, CACHE_NO_PAGE, data, length, priority);
+}
+
+bool ResourceCache::adoptPage(const ResourceId& resourceId, uint16_t page, uint8_t* data, size_t length, int priority) {
+  if (page == CACHE_NO_PAGE) {
+    VRAM_FREE(data);
+    return false;
+  }
+  return adoptEntry(resourceId, page, data, length, priority);
+}
+
+bool ResourceCache::adoptEntry(const ResourceId& resourceId, uint16_t page, uint8_t* data, size_t length, int priority) {
+  VramLock guard(lock);
+  TelemetryTimer timer(telemetry, METRIC_CACHE_STORE);
   // Check if resource is too large
-  if (entrySize > MAX_RESOURCE_SIZE) {
-    Serial.printf("Resource %s too large (%d bytes), max allowed: %d\n", 
-                  resourceId.c_str(), entrySize, MAX_RESOURCE_SIZE);
+  size_t maxLength = page == CACHE_NO_PAGE ? MAX_RESOURCE_SIZE : RESOURCE_PAGE_SIZE;
+  if (length > maxLength) {
+    VRAM_LOGW("Resource %s too large (%u bytes), max allowed: %u", 
+                  resourceId.c_str(), (unsigned)length, (unsigned)maxLength);
+    VRAM_FREE(data);
+    return false;
+  }
+  
+  if (indexTable == nullptr || !resourceId.isValid()) {
+    VRAM_FREE(data);
     return false;
   }
   
-  // Check if resource already exists
-  if (contains(resourceId)) {
+  priority = constrain(priority, PRIORITY_CRITICAL, PRIORITY_LOW);
+  
+  // One probe finds the existing entry or the slot a new one goes in
+  size_t indexSlot = probeSlot(resourceId, page);
+  
+  if (indexTable[indexSlot] != nullptr) {
     // Update existing entry
-    CacheEntry* entry = cacheMap[resourceId];
+    CacheEntry* entry = indexTable[indexSlot];
+    
+    // Views of the old bytes keep them; park them in a record of their own
+    if (entry->pins > 0) {
+      void* record = VRAM_MALLOC(sizeof(CacheEntry), resourceId);
+      if (record == nullptr) {
+        VRAM_FREE(data);
+        return false;
+      }
+      
+      CacheEntry* old = new (record) CacheEntry();
+      old->resourceId = resourceId;
+      old->page = page;
+      old->data = entry->data;
+      old->length = entry->length;
+      old->pins = entry->pins;
+      retire(old);
+      
+      pinnedBytes[entry->priority] -= entry->size + CACHE_ENTRY_OVERHEAD;
+      entry->data = nullptr;
+      entry->pins = 0;
+    }
+    
+    int oldPriority = entry->priority;
     totalCacheSize -= entry->size;
+    priorityBytes[oldPriority] -= entry->size + CACHE_ENTRY_OVERHEAD;
+    markPersistentChange(oldPriority);
+    markPersistentChange(priority);
     
+    VRAM_FREE(entry->data);
     entry->data = data;
-    entry->size = entrySize;
+    entry->length = length;
+    entry->size = length;
     entry->priority = priority;
+    entry->hash = "";  // Stale until the caller sets the new version
+    entry->version = 0;
+    entry->validatedTime = millis();
     entry->accessTime = millis();
     entry->accessCount++;
+    armExpiry(entry);  // Fresh bytes, a fresh lifetime under the TTL already set
     
-    totalCacheSize += entrySize;
+    totalCacheSize += length;
+    priorityBytes[priority] += length + CACHE_ENTRY_OVERHEAD;
     moveToHead(entry);
+    if (priority != oldPriority) {
+      policy->onPriorityChange(entry, oldPriority);
+    }
+    policy->onAccess(entry);
     
-    Serial.printf("Updated cached resource: %s (%d bytes)\n", 
-                  resourceId.c_str(), entrySize);
+    VRAM_LOGD("Updated cached resource: %s (%u bytes)", 
+                  resourceId.c_str(), (unsigned)length);
     return true;
   }
   
+  // An index whose growth failed is still at its load limit; probes end
+  // only at an empty slot, so take no new entries until it grows
+  if ((size_t)totalEntries * 100 >= indexCapacity * CACHE_INDEX_MAX_LOAD_PCT && !growIndex()) {
+    VRAM_LOGW("Cache index full, not caching %s", resourceId.c_str());
+    VRAM_FREE(data);
+    return false;
+  }
+  
   // Make space if necessary
-  if (!makeSpaceFor(entrySize + CACHE_ENTRY_OVERHEAD, priority)) {
-    Serial.printf("Cannot make space for resource %s (%d bytes)\n", 
-                  resourceId.c_str(), entrySize);
+  size_t generation = indexGeneration;
+  if (!makeSpaceFor(length + CACHE_ENTRY_OVERHEAD, priority)) {
+    VRAM_LOGW("Cannot make space for resource %s (%u bytes)", 
+                  resourceId.c_str(), (unsigned)length);
+    VRAM_FREE(data);
     return false;
   }
   
-  // Create new cache entry
-  CacheEntry* entry = new CacheEntry();
+  // Create new cache entry in a slab slot
+  void* slot = VRAM_MALLOC(sizeof(CacheEntry), resourceId);
+  if (slot == nullptr) {
+    VRAM_FREE(data);
+    return false;
+  }
+  
+  CacheEntry* entry = new (slot) CacheEntry();
   entry->resourceId = resourceId;
+  entry->page = page;
   entry->data = data;
+  entry->length = length;
   entry->priority = priority;
-  entry->size = entrySize;
+  entry->size = length;
+  entry->version = 0;
+  entry->validatedTime = millis();
+  entry->ttl = 0;
+  entry->expiryIndex = 0;
   entry->accessTime = millis();
   entry->createTime = millis();
   entry->accessCount = 1;
+  entry->prefetched = false;
+  entry->pins = 0;
   entry->prev = nullptr;
   entry->next = nullptr;
+  entry->policyPrev = nullptr;
+  entry->policyNext = nullptr;
+  entry->policyCount = 0;
+  entry->policySegment = 0;
+  
+  // Evictions shift index slots; probe again only if one happened
+  if (generation != indexGeneration) {
+    indexSlot = probeSlot(resourceId, page);
+  }
   
   // Add to cache
   addToHead(entry);
-  cacheMap[resourceId] = entry;
-  totalCacheSize += entrySize + CACHE_ENTRY_OVERHEAD;
+  policy->onInsert(entry);
+  indexTable[indexSlot] = entry;
+  entry->indexSlot = indexSlot;
+  totalCacheSize += length + CACHE_ENTRY_OVERHEAD;
+  priorityBytes[priority] += length + CACHE_ENTRY_OVERHEAD;
   totalEntries++;
+  if (page != CACHE_NO_PAGE) {
+    pageEntries++;
+  }
+  
+  // A demoted copy is stale once a new one is in
+  if (secondTier && page == CACHE_NO_PAGE) {
+    secondTier->remove(resourceId);
+  }
   
-  Serial.printf("Cached new resource: %s (%d bytes, priority: %d)\n", 
-                resourceId.c_str(), entrySize, priority);
+  if ((size_t)totalEntries * 100 >= indexCapacity * CACHE_INDEX_MAX_LOAD_PCT) {
+    growIndex();
+  }
+  markPersistentChange(priority);
+  
+  VRAM_LOGD("Cached new resource: %s page %d (%u bytes, priority: %d)", 
+                resourceId.c_str(), page == CACHE_NO_PAGE ? -1 : page, (unsigned)length, priority);
   
   return true;
 }
 
-String ResourceCache::get(const String& resourceId) {
-  auto it = cacheMap.find(resourceId);
-  if (it != cacheMap.end()) {
-    CacheEntry* entry = it->second;
-    
-    // Update access information
-    entry->accessTime = millis();
-    entry->accessCount++;
-    
-    // Move to head (most recently used)
-    moveToHead(entry);
-    
-    cacheHits++;
+String ResourceCache::get(const ResourceId& resourceId) {
+  VramLock guard(lock);
+  size_t length;
+  const uint8_t* data = getBytes(resourceId, length);
+  if (data == nullptr) {
+    return "";
+  }
+  
+  String result;
+  result.reserve(length);
+  result.concat((const char*)data, length);
+  return result;
+}
+
+ResourceView ResourceCache::view(const ResourceId& resourceId) {
+  VramLock guard(lock);
+  size_t length;
+  const uint8_t* data = getBytes(resourceId, length);
+  if (data == nullptr) {
+    return ResourceView();
+  }
+  
+  // getBytes() may have promoted it, so look the entry up afterwards
+  pin(findEntry(resourceId));
+  return ResourceView(this, resourceId, CACHE_NO_PAGE, data, length);
+}
+
+ResourceView ResourceCache::viewPage(const ResourceId& resourceId, uint16_t page) {
+  VramLock guard(lock);
+  CacheEntry* entry = findEntry(resourceId, page);
+  if (entry == nullptr) {
+    cacheMisses++;
+    return ResourceView();
+  }
+  
+  recordHit(entry);
+  pin(entry);
+  return ResourceView(this, resourceId, page, entry->data, entry->length);
+}
+
+bool ResourceCache::containsPage(const ResourceId& resourceId, uint16_t page) {
+  VramLock guard(lock);
+  return findEntry(resourceId, page) != nullptr;
+}
+
+int ResourceCache::removePages(const ResourceId& resourceId) {
+  VramLock guard(lock);
+  int removed = 0;
+  CacheEntry* current = head;
+  while (current != nullptr && pageEntries > 0) {
+    CacheEntry* next = current->next;
+    if (current->resourceId == resourceId && current->page != CACHE_NO_PAGE) {
+      dropEntry(current);
+      removed++;
+    }
+    current = next;
+  }
+  return removed;
+}
+
+bool ResourceCache::getInto(const ResourceId& resourceId, uint8_t* buffer, size_t bufferSize, size_t& length) {
+  VramLock guard(lock);
+  const uint8_t* data = getBytes(resourceId, length);
+  if (data == nullptr) {
+    return false;
+  }
+  
+  memcpy(buffer, data, min(length, bufferSize));
+  return true;
+}
+
+const uint8_t* ResourceCache::getBytes(const ResourceId& resourceId, size_t& length) {
+  VramLock guard(lock);
+  TelemetryTimer timer(telemetry, METRIC_CACHE_GET);
+  CacheEntry* entry = findEntry(resourceId);
+  if (entry != nullptr) {
+    recordHit(entry);
+    length = entry->length;
     return entry->data;
   }
   
   cacheMisses++;
-  return "";
+  policy->onMiss(resourceId);
+  
+  // Bring a demoted copy back before falling through to the network
+  if (secondTier && promote(resourceId)) {
+    entry = findEntry(resourceId);
+    length = entry->length;
+    return entry->data;
+  }
+  
+  length = 0;
+  return nullptr;
 }
 
-bool ResourceCache::contains(const String& resourceId) {
-  return cacheMap.find(resourceId) != cacheMap.end();
+void ResourceCache::recordHit(CacheEntry* entry) {
+  // Update access information
+  entry->accessTime = millis();
+  entry->accessCount++;
+  
+  // Move to head (most recently used)
+  moveToHead(entry);
+  policy->onAccess(entry);
+  
+  if (entry->prefetched) {
+    entry->prefetched = false;
+    prefetchHits++;
+  }
+  
+  cacheHits++;
 }
 
-bool ResourceCache::remove(const String& resourceId) {
-  auto it = cacheMap.find(resourceId);
-  if (it != cacheMap.end()) {
-    CacheEntry* entry = it->second;
-    
-    totalCacheSize -= (entry->size + CACHE_ENTRY_OVERHEAD);
-    totalEntries--;
-    
-    removeEntry(entry);
-    cacheMap.erase(it);
-    delete entry;
-    
-    Serial.printf("Removed cached resource: %s\n", resourceId.c_str());
-    return true;
+bool ResourceCache::promote(const ResourceId& resourceId) {
+  TierRecord record;
+  uint8_t* data = secondTier->read(resourceId, record);
+  if (data == nullptr) {
+    tierMisses++;
+    return false;
+  }
+  
+  // adopt() drops the tier copy once the entry is in; if it refuses, the
+  // copy stays where it was
+  if (!adopt(resourceId, data, record.length, record.priority)) {
+    tierMisses++;
+    return false;
   }
+  tierHits++;
   
-  return false;
+  setVersion(resourceId, record.hash, record.version);
+  markValidated(resourceId, false);  // May have changed while demoted
+  VRAM_LOGD("Promoted %s from %s", resourceId.c_str(), secondTier->getName());
+  return true;
+}
+
+const CacheEntry* ResourceCache::peek(const ResourceId& resourceId) {
+  VramLock guard(lock);
+  return findEntry(resourceId);
+}
+
+bool ResourceCache::contains(const ResourceId& resourceId) {
+  VramLock guard(lock);
+  return findEntry(resourceId) != nullptr ||
+         (secondTier && secondTier->contains(resourceId));
+}
+
+bool ResourceCache::setVersion(const ResourceId& resourceId, const String& hash, int version) {
+  VramLock guard(lock);
+  CacheEntry* entry = findEntry(resourceId);
+  if (entry == nullptr) {
+    return false;
+  }
+  
+  entry->hash = hash;
+  entry->version = version;
+  markPersistentChange(entry->priority);
+  return true;
+}
+
+bool ResourceCache::markValidated(const ResourceId& resourceId, bool validated) {
+  VramLock guard(lock);
+  CacheEntry* entry = findEntry(resourceId);
+  if (entry == nullptr) {
+    return false;
+  }
+  
+  entry->validatedTime = validated ? millis() : 0;
+  if (validated) {
+    armExpiry(entry);
+  }
+  return true;
+}
+
+bool ResourceCache::setTtl(const ResourceId& resourceId, unsigned long ttl) {
+  VramLock guard(lock);
+  CacheEntry* entry = findEntry(resourceId);
+  if (entry == nullptr) {
+    return false;
+  }
+  
+  entry->ttl = ttl;
+  armExpiry(entry);
+  return true;
+}
+
+bool ResourceCache::markPrefetched(const ResourceId& resourceId) {
+  VramLock guard(lock);
+  CacheEntry* entry = findEntry(resourceId);
+  if (entry == nullptr) {
+    return false;
+  }
+  
+  entry->prefetched = true;
+  return true;
+}
+
+bool ResourceCache::remove(const ResourceId& resourceId) {
+  VramLock guard(lock);
+  bool removedFromTier = secondTier && secondTier->remove(resourceId);
+  bool removedPages = removePages(resourceId) > 0;
+  return removeFromMemory(resourceId) || removedFromTier || removedPages;
+}
+
+bool ResourceCache::removeFromMemory(const ResourceId& resourceId, uint16_t page) {
+  CacheEntry* entry = findEntry(resourceId, page);
+  if (entry == nullptr) {
+    return false;
+  }
+  
+  dropEntry(entry);
+  return true;
+}
+
+void ResourceCache::dropEntry(CacheEntry* entry) {
+  totalCacheSize -= (entry->size + CACHE_ENTRY_OVERHEAD);
+  priorityBytes[entry->priority] -= entry->size + CACHE_ENTRY_OVERHEAD;
+  totalEntries--;
+  if (entry->page != CACHE_NO_PAGE) {
+    pageEntries--;
+  }
+  if (entry->pins > 0) {
+    pinnedBytes[entry->priority] -= entry->size + CACHE_ENTRY_OVERHEAD;
+  }
+  markPersistentChange(entry->priority);
+  if (entry->prefetched) {
+    prefetchWasted++;  // Fetched ahead and never read
+  }
+  
+  removeEntry(entry);
+  policy->onRemove(entry);
+  unscheduleExpiry(entry);
+  removeSlot(entry->indexSlot);
+  VRAM_LOGD("Removed cached resource: %s", entry->resourceId.c_str());
+  destroyEntry(entry);
 }
 
 void ResourceCache::clear() {
+  VramLock guard(lock);
   CacheEntry* current = head;
   while (current != nullptr) {
     CacheEntry* next = current->next;
-    delete current;
+    markPersistentChange(current->priority);
+    destroyEntry(current);
     current = next;
   }
   
   head = nullptr;
   tail = nullptr;
-  cacheMap.clear();
+  policy->clear();
+  if (indexTable) {
+    memset(indexTable, 0, indexCapacity * sizeof(CacheEntry*));
+  }
+  indexGeneration++;
+  expiryCount = 0;
   totalCacheSize = 0;
   totalEntries = 0;
+  pageEntries = 0;
+  memset(priorityBytes, 0, sizeof(priorityBytes));
+  memset(pinnedBytes, 0, sizeof(pinnedBytes));
   
-  Serial.println("Cache cleared");
+  VRAM_LOGI("Cache cleared");
 }
 
 int ResourceCache::freeMemory(size_t targetBytes) {
+  VramLock guard(lock);
   int freedResources = 0;
   size_t freedBytes = 0;
   
-  Serial.printf("Attempting to free %d bytes from cache\n", targetBytes);
+  VRAM_LOGD("Attempting to free %u bytes from cache", (unsigned)targetBytes);
   
-  // Start from least recently used (tail) and work backwards
-  CacheEntry* current = tail;
-  while (current != nullptr && freedBytes < targetBytes) {
-    CacheEntry* prev = current->prev;
-    
-    // Don't remove critical resources unless absolutely necessary
-    if (current->priority == PRIORITY_CRITICAL && freedBytes > targetBytes / 2) {
-      current = prev;
+  // Don't remove critical resources unless absolutely necessary
+  int minPriority = PRIORITY_IMPORTANT;
+  while (freedBytes < targetBytes) {
+    CacheEntry* victim = policy->selectVictim(minPriority, true);
+    if (victim == nullptr) {
+      if (minPriority == PRIORITY_CRITICAL) break;
+      minPriority = PRIORITY_CRITICAL;
       continue;
     }
     
-    freedBytes += current->size + CACHE_ENTRY_OVERHEAD;
+    freedBytes += victim->size + CACHE_ENTRY_OVERHEAD;
     freedResources++;
     
-    Serial.printf("Evicting resource: %s (%d bytes, priority: %d)\n", 
-                  current->resourceId.c_str(), current->size, current->priority);
+    VRAM_LOGD("Evicting resource: %s (%u bytes, priority: %d)", 
+                  victim->resourceId.c_str(), (unsigned)victim->size, victim->priority);
     
-    // Remove the entry
-    String resourceId = current->resourceId;
-    current = prev;
-    remove(resourceId);
-    evictions++;
+    // Demote or drop the entry
+    evict(victim);
   }
   
-  Serial.printf("Freed %d resources (%d bytes)\n", freedResources, freedBytes);
+  VRAM_LOGI("Freed %d resources (%u bytes)", freedResources, (unsigned)freedBytes);
   return freedResources;
 }
 
 void ResourceCache::optimizeCache() {
-  Serial.println("Optimizing cache...");
+  VramLock guard(lock);
+  VRAM_LOGI("Optimizing cache...");
   
   if (totalCacheSize <= maxCacheSize) {
-    Serial.println("Cache optimization not needed");
+    VRAM_LOGI("Cache optimization not needed");
     return;
   }
   
@@ -297,57 +1187,220 @@ void ResourceCache::optimizeCache() {
   freeMemory(targetReduction);
 }
 
+int ResourceCache::adaptBudget(const MemoryInfo& info) {
+  VramLock guard(lock);
+  bool fragmented = info.largestFreeBlock < BUDGET_MIN_FREE_BLOCK &&
+                    info.fragmentation >= BUDGET_FRAGMENTATION_PCT;
+  
+  // Hysteresis: pressure starts at the low watermark and ends at the high one
+  bool wasUnderPressure = underPressure;
+  if (info.freeHeap < BUDGET_LOW_WATERMARK || fragmented) {
+    underPressure = true;
+  } else if (info.freeHeap >= BUDGET_HIGH_WATERMARK) {
+    underPressure = false;
+  }
+  
+  if (underPressure != wasUnderPressure) {
+    VRAM_LOGI("Cache: heap pressure %s (%u bytes free, largest block %u), budget %u bytes",
+              underPressure ? "started" : "ended", (unsigned)info.freeHeap, (unsigned)info.largestFreeBlock, (unsigned)maxCacheSize);
+  }
+  
+  size_t lowest = min((size_t)BUDGET_MIN_SIZE, budgetCeiling);
+  if (underPressure) {
+    // One step below what the cache holds now, so every call frees something
+    size_t target = totalCacheSize > lowest + BUDGET_STEP ? totalCacheSize - BUDGET_STEP : lowest;
+    maxCacheSize = max(lowest, min(maxCacheSize, target));
+  } else if (info.freeHeap >= BUDGET_HIGH_WATERMARK && maxCacheSize < budgetCeiling) {
+    // Grow back no faster than the heap above the high watermark allows
+    size_t headroom = info.freeHeap - BUDGET_HIGH_WATERMARK;
+    maxCacheSize += min(headroom, min((size_t)BUDGET_GROW_STEP, budgetCeiling - maxCacheSize));
+  }
+  
+  if (totalCacheSize <= maxCacheSize) {
+    return 0;
+  }
+  
+  // Excess goes a step per call, so a drop never empties the cache at once
+  budgetSteps++;
+  return freeMemory(min(totalCacheSize - maxCacheSize, (size_t)BUDGET_STEP));
+}
+
 bool ResourceCache::makeSpaceFor(size_t requiredSize, int priority) {
+  VramLock guard(lock);
   if (totalCacheSize + requiredSize <= maxCacheSize) {
     return true;  // Already have space
   }
   
   size_t spaceNeeded = (totalCacheSize + requiredSize) - maxCacheSize;
-  
-  // Try to free space by removing lower priority items first
-  CacheEntry* current = tail;
   size_t freedSpace = 0;
   
-  while (current != nullptr && freedSpace < spaceNeeded) {
-    CacheEntry* prev = current->prev;
+  // Refuse before evicting anything if the evictable bytes fall short
+  size_t unpinnedBytes[PRIORITY_LEVELS];
+  for (int level = 0; level < PRIORITY_LEVELS; level++) {
+    unpinnedBytes[level] = priorityBytes[level] - pinnedBytes[level];
+  }
+  size_t evictable = policy->evictableBytes(unpinnedBytes, priority, false, spaceNeeded);
+  if (evictable < spaceNeeded) {
+    VRAM_LOGD("Cache: only %u evictable bytes for %u needed", (unsigned)evictable, (unsigned)spaceNeeded);
+    return false;
+  }
+  
+  // The policy picks victims the incoming priority may displace
+  while (freedSpace < spaceNeeded) {
+    CacheEntry* victim = policy->selectVictim(priority, false);
+    if (victim == nullptr) break;
     
-    // Remove if lower priority or same priority but older
-    if (shouldEvict(current, priority)) {
-      freedSpace += current->size + CACHE_ENTRY_OVERHEAD;
-      String resourceId = current->resourceId;
-      current = prev;
-      remove(resourceId);
-      evictions++;
-    } else {
-      current = prev;
-    }
+    freedSpace += victim->size + CACHE_ENTRY_OVERHEAD;
+    evict(victim);
   }
   
   return freedSpace >= spaceNeeded;
 }
 
-bool ResourceCache::shouldEvict(CacheEntry* entry, int newPriority) {
-  // Always evict lower priority
-  if (entry->priority > newPriority) {
-    return true;
+void ResourceCache::evict(CacheEntry* entry) {
+  // The tier holds whole resources; a page is refetched by range instead
+  if (secondTier && entry->page == CACHE_NO_PAGE && secondTier->put(*entry)) {
+    demotions++;
+  }
+  if (telemetry) {
+    telemetry->recordEviction(entry->priority);
+  }
+  
+  dropEntry(entry);
+  evictions++;
+}
+
+void ResourceCache::markPersistentChange(int priority) {
+  if (priority <= CACHE_PERSIST_MAX_PRIORITY) {
+    persistGeneration++;
+  }
+}
+
+size_t ResourceCache::homeSlot(const ResourceId& resourceId, uint16_t page) {
+  // Handles are small sequential integers; Fibonacci hashing spreads them.
+  // An odd step per page keeps the pages of one resource apart as well.
+  uint32_t key = resourceId.getHandle() + (uint32_t)page * 40503u;
+  return (key * 2654435769UL) & (indexCapacity - 1);
+}
+
+size_t ResourceCache::probeSlot(const ResourceId& resourceId, uint16_t page) {
+  size_t mask = indexCapacity - 1;
+  size_t slot = homeSlot(resourceId, page);
+  
+  // Interned ids compare as integers, so probes never touch the name
+  while (indexTable[slot] != nullptr &&
+         (indexTable[slot]->resourceId != resourceId || indexTable[slot]->page != page)) {
+    slot = (slot + 1) & mask;
   }
+  return slot;
+}
+
+CacheEntry* ResourceCache::findEntry(const ResourceId& resourceId, uint16_t page) {
+  if (indexTable == nullptr || !resourceId.isValid()) return nullptr;
+  return indexTable[probeSlot(resourceId, page)];
+}
+
+void ResourceCache::removeSlot(size_t hole) {
+  // Backward-shift deletion, as in the MemoryManager tracking table
+  size_t mask = indexCapacity - 1;
+  size_t slot = hole;
   
-  // For same priority, consider age and access frequency
-  if (entry->priority == newPriority) {
-    unsigned long age = millis() - entry->createTime;
-    unsigned long timeSinceAccess = millis() - entry->accessTime;
+  while (true) {
+    slot = (slot + 1) & mask;
+    if (indexTable[slot] == nullptr) break;
     
-    // Evict if not accessed recently and low access count
-    if (timeSinceAccess > 300000 && entry->accessCount < 3) {  // 5 minutes
-      return true;
+    size_t home = homeSlot(indexTable[slot]->resourceId, indexTable[slot]->page);
+    if (((slot - home) & mask) >= ((slot - hole) & mask)) {
+      indexTable[hole] = indexTable[slot];
+      indexTable[hole]->indexSlot = hole;
+      hole = slot;
     }
   }
   
-  return false;
+  indexTable[hole] = nullptr;
+  indexGeneration++;
 }
 
-size_t ResourceCache::calculateEntrySize(const String& data) {
-  return data.length() + sizeof(CacheEntry);
+bool ResourceCache::growIndex() {
+  size_t newCapacity = indexCapacity * 2;
+  CacheEntry** newTable = (CacheEntry**)calloc(newCapacity, sizeof(CacheEntry*));
+  if (newTable == nullptr) {
+    VRAM_LOGW("Cache index: cannot grow to %u slots", (unsigned)newCapacity);
+    return false;  // adoptEntry() refuses new entries until a later try succeeds
+  }
+  
+  free(indexTable);
+  indexTable = newTable;
+  indexCapacity = newCapacity;
+  
+  size_t mask = newCapacity - 1;
+  for (CacheEntry* entry = head; entry != nullptr; entry = entry->next) {
+    size_t slot = homeSlot(entry->resourceId, entry->page);
+    while (indexTable[slot] != nullptr) {
+      slot = (slot + 1) & mask;
+    }
+    indexTable[slot] = entry;
+    entry->indexSlot = slot;
+  }
+  indexGeneration++;
+  
+  VRAM_LOGD("Cache index grown to %u slots", (unsigned)newCapacity);
+  return true;
+}
+
+void ResourceCache::destroyEntry(CacheEntry* entry) {
+  // Already unlinked; a pinned entry lingers until its last view goes
+  if (entry->pins > 0) {
+    retire(entry);
+    return;
+  }
+  
+  VRAM_FREE(entry->data);
+  entry->~CacheEntry();
+  VRAM_FREE(entry);
+}
+
+void ResourceCache::retire(CacheEntry* entry) {
+  entry->hash = String();  // Only the payload is still needed
+  entry->next = retired;
+  retired = entry;
+  retiredCount++;
+  retiredBytes += entry->length;
+  VRAM_LOGD("Retired pinned payload of %s (%d views)", entry->resourceId.c_str(), entry->pins);
+}
+
+void ResourceCache::pin(CacheEntry* entry) {
+  if (entry->pins++ == 0) {
+    pinnedBytes[entry->priority] += entry->size + CACHE_ENTRY_OVERHEAD;
+  }
+}
+
+void ResourceCache::unpin(const ResourceId& resourceId, uint16_t page, const uint8_t* data) {
+  VramLock guard(lock);
+  
+  // Pinned buffers are never freed, so the pointer names one payload
+  CacheEntry* entry = findEntry(resourceId, page);
+  if (entry != nullptr && entry->data == data) {
+    if (--entry->pins == 0) {
+      pinnedBytes[entry->priority] -= entry->size + CACHE_ENTRY_OVERHEAD;
+    }
+    return;
+  }
+  
+  for (CacheEntry** link = &retired; *link != nullptr; link = &(*link)->next) {
+    CacheEntry* record = *link;
+    if (record->data != data) continue;
+    
+    if (--record->pins == 0) {
+      *link = record->next;
+      retiredCount--;
+      retiredBytes -= record->length;
+      destroyEntry(record);
+    }
+    return;
+  }
+  
+  VRAM_LOGE("Cache: released a view of %s it does not own", resourceId.c_str());
 }
 
 void ResourceCache::moveToHead(CacheEntry* entry) {
@@ -394,14 +1447,39 @@ CacheEntry* ResourceCache::removeTail() {
 }
 
 void ResourceCache::printCacheStats() {
+  VramLock guard(lock);
   Serial.println("\n=== Cache Statistics ===");
   Serial.printf("Entries: %d\n", totalEntries);
-  Serial.printf("Cache Size: %d / %d bytes (%.1f%%)\n", 
-                totalCacheSize, maxCacheSize, getCacheUtilization() * 100);
+  if (pageEntries > 0) {
+    Serial.printf("Pages: %d of %d bytes\n", pageEntries, RESOURCE_PAGE_SIZE);
+  }
+  Serial.printf("Cache Size: %u / %u bytes (%.1f%%)\n", 
+                (unsigned)totalCacheSize, (unsigned)maxCacheSize, getCacheUtilization() * 100);
+  if (maxCacheSize < budgetCeiling || budgetSteps > 0) {
+    Serial.printf("Budget: %u of %u bytes%s, %d eviction steps\n", (unsigned)maxCacheSize, (unsigned)budgetCeiling,
+                  underPressure ? " (heap pressure)" : "", budgetSteps);
+  }
   Serial.printf("Cache Hits: %d\n", cacheHits);
   Serial.printf("Cache Misses: %d\n", cacheMisses);
   Serial.printf("Hit Rate: %.1f%%\n", getHitRate() * 100);
   Serial.printf("Evictions: %d\n", evictions);
+  Serial.printf("Prefetch Hits: %d (wasted: %d)\n", prefetchHits, prefetchWasted);
+  Serial.printf("Eviction Policy: %s\n", policy->getName());
+  if (retiredCount > 0) {
+    Serial.printf("Retired (still viewed): %d (%u bytes)\n", retiredCount, (unsigned)retiredBytes);
+  }
+  if (expiryCount > 0 || expirations > 0) {
+    Serial.printf("Expiring: %d scheduled, %d expired\n", expiryCount, expirations);
+  }
+  
+  if (secondTier) {
+    Serial.printf("\n=== %s Tier ===\n", secondTier->getName());
+    Serial.printf("Entries: %d\n", secondTier->getCount());
+    Serial.printf("Size: %u / %u bytes\n", (unsigned)secondTier->getSize(), (unsigned)secondTier->getMaxSize());
+    Serial.printf("Tier Hits: %d\n", tierHits);
+    Serial.printf("Tier Misses: %d\n", tierMisses);
+    Serial.printf("Demotions: %d\n", demotions);
+  }
   
   Serial.println("\n=== Cached Resources ===");
   CacheEntry* current = head;
@@ -410,8 +1488,12 @@ void ResourceCache::printCacheStats() {
     unsigned long age = millis() - current->createTime;
     unsigned long lastAccess = millis() - current->accessTime;
     
-    Serial.printf("%d. %s (%d bytes, P%d, age: %lums, last: %lums, hits: %d)\n",
-                  ++index, current->resourceId.c_str(), current->size, 
+    char pageLabel[12] = "";
+    if (current->page != CACHE_NO_PAGE) {
+      snprintf(pageLabel, sizeof(pageLabel), " #%u", current->page);
+    }
+    Serial.printf("%d. %s%s (%u bytes, P%d, age: %lums, last: %lums, hits: %d)\n",
+                  ++index, current->resourceId.c_str(), pageLabel, (unsigned)current->size, 
                   current->priority, age, lastAccess, current->accessCount);
     current = current->next;
   }
@@ -419,41 +1501,128 @@ void ResourceCache::printCacheStats() {
 }
 
 void ResourceCache::resetStats() {
+  VramLock guard(lock);
   cacheHits = 0;
   cacheMisses = 0;
   evictions = 0;
-  Serial.println("Cache statistics reset");
+  prefetchHits = 0;
+  prefetchWasted = 0;
+  tierHits = 0;
+  tierMisses = 0;
+  demotions = 0;
+  VRAM_LOGI("Cache statistics reset");
 }
 
-void ResourceCache::cleanupExpired(unsigned long maxAge) {
-  CacheEntry* current = tail;
-  int cleaned = 0;
+int ResourceCache::expireDue(unsigned long now, int maxCount) {
+  VramLock guard(lock);
+  int expired = 0;
   
-  while (current != nullptr) {
-    CacheEntry* prev = current->prev;
-    unsigned long age = millis() - current->accessTime;
+  // Only the heap top is ever looked at, so the work is bounded by maxCount
+  for (int handled = 0; handled < maxCount && expiryCount > 0; handled++) {
+    CacheEntry* entry = expiryHeap[0];
+    if ((long)(now - entry->expiresAt) < 0) {
+      break;  // The earliest deadline is still ahead
+    }
     
-    // Remove expired non-critical resources
-    if (age > maxAge && current->priority > PRIORITY_CRITICAL) {
-      String resourceId = current->resourceId;
-      remove(resourceId);
-      cleaned++;
+    if (entry->pins > 0) {
+      scheduleExpiry(entry, now + EXPIRY_RETRY_DELAY);  // Let the reader finish
+      continue;
     }
     
-    current = prev;
+    // A demoted copy would be just as stale
+    if (secondTier) {
+      secondTier->remove(entry->resourceId);
+    }
+    VRAM_LOGD("Expired %s after %lums", entry->resourceId.c_str(), entry->ttl);
+    dropEntry(entry);
+    expirations++;
+    expired++;
+  }
+  
+  return expired;
+}
+
+void ResourceCache::armExpiry(CacheEntry* entry) {
+  // Critical entries are only ever revalidated; pages follow their pager
+  if (entry->ttl == 0 || entry->priority == PRIORITY_CRITICAL || entry->page != CACHE_NO_PAGE) {
+    unscheduleExpiry(entry);
+    return;
+  }
+  scheduleExpiry(entry, millis() + entry->ttl);
+}
+
+void ResourceCache::scheduleExpiry(CacheEntry* entry, unsigned long deadline) {
+  entry->expiresAt = deadline;
+  if (entry->expiryIndex == 0) {
+    if (expiryCount == expiryCapacity) {
+      int newCapacity = expiryCapacity > 0 ? expiryCapacity * 2 : EXPIRY_HEAP_INITIAL_SIZE;
+      CacheEntry** grown = (CacheEntry**)realloc(expiryHeap, newCapacity * sizeof(CacheEntry*));
+      if (grown == nullptr) {
+        VRAM_LOGW("Cache expiry: cannot grow to %d entries, %s will not expire",
+                  newCapacity, entry->resourceId.c_str());
+        return;
+      }
+      expiryHeap = grown;
+      expiryCapacity = newCapacity;
+    }
+    placeExpiry(expiryCount++, entry);
+  }
+  siftExpiry(entry->expiryIndex - 1);
+}
+
+void ResourceCache::unscheduleExpiry(CacheEntry* entry) {
+  if (entry->expiryIndex == 0) {
+    return;
+  }
+  
+  // The last entry fills the hole and moves whichever way its deadline says
+  int position = entry->expiryIndex - 1;
+  entry->expiryIndex = 0;
+  CacheEntry* last = expiryHeap[--expiryCount];
+  if (last != entry) {
+    placeExpiry(position, last);
+    siftExpiry(position);
+  }
+}
+
+void ResourceCache::placeExpiry(int position, CacheEntry* entry) {
+  expiryHeap[position] = entry;
+  entry->expiryIndex = position + 1;
+}
+
+void ResourceCache::siftExpiry(int position) {
+  CacheEntry* entry = expiryHeap[position];
+  
+  // Deadlines compare by difference, so millis() wrapping is harmless
+  while (position > 0) {
+    int parent = (position - 1) / 2;
+    if ((long)(entry->expiresAt - expiryHeap[parent]->expiresAt) >= 0) break;
+    placeExpiry(position, expiryHeap[parent]);
+    position = parent;
   }
   
-  if (cleaned > 0) {
-    Serial.printf("Cleaned up %d expired resources\n", cleaned);
+  while (true) {
+    int child = position * 2 + 1;
+    if (child >= expiryCount) break;
+    if (child + 1 < expiryCount &&
+        (long)(expiryHeap[child + 1]->expiresAt - expiryHeap[child]->expiresAt) < 0) {
+      child++;
+    }
+    if ((long)(expiryHeap[child]->expiresAt - entry->expiresAt) >= 0) break;
+    placeExpiry(position, expiryHeap[child]);
+    position = child;
   }
+  
+  placeExpiry(position, entry);
 }
 
-std::vector<String> ResourceCache::getResourcesByPriority(int priority) {
-  std::vector<String> resources;
+std::vector<ResourceId> ResourceCache::getResourcesByPriority(int priority) {
+  VramLock guard(lock);
+  std::vector<ResourceId> resources;
   
   CacheEntry* current = head;
   while (current != nullptr) {
-    if (current->priority == priority) {
+    if (current->priority == priority && current->page == CACHE_NO_PAGE) {
       resources.push_back(current->resourceId);
     }
     current = current->next;
@@ -462,12 +1631,87 @@ std::vector<String> ResourceCache::getResourcesByPriority(int priority) {
   return resources;
 }
 
-void ResourceCache::updatePriority(const String& resourceId, int newPriority) {
-  auto it = cacheMap.find(resourceId);
-  if (it != cacheMap.end()) {
-    it->second->priority = newPriority;
-    Serial.printf("Updated priority for %s to %d\n", resourceId.c_str(), newPriority);
+std::vector<ResourceId> ResourceCache::getStaleResources(unsigned long maxAge, size_t maxCount) {
+  VramLock guard(lock);
+  std::vector<CacheEntry*> stale;
+  unsigned long now = millis();
+  
+  // Only entries with a known hash can be revalidated
+  for (CacheEntry* current = head; current != nullptr; current = current->next) {
+    if (!current->hash.isEmpty() && current->page == CACHE_NO_PAGE &&
+        (current->validatedTime == 0 || now - current->validatedTime > maxAge)) {
+      stale.push_back(current);
+    }
+  }
+  
+  // By age rather than timestamp, which wraps with millis() after 49 days;
+  // never-validated entries first
+  std::sort(stale.begin(), stale.end(), [now](CacheEntry* a, CacheEntry* b) {
+    if ((a->validatedTime == 0) != (b->validatedTime == 0)) {
+      return a->validatedTime == 0;
+    }
+    return now - a->validatedTime > now - b->validatedTime;
+  });
+  
+  std::vector<ResourceId> resources;
+  for (size_t i = 0; i < stale.size() && i < maxCount; i++) {
+    resources.push_back(stale[i]->resourceId);
+  }
+  return resources;
+}
+
+void ResourceCache::updatePriority(const ResourceId& resourceId, int newPriority) {
+  VramLock guard(lock);
+  newPriority = constrain(newPriority, PRIORITY_CRITICAL, PRIORITY_LOW);
+  CacheEntry* entry = findEntry(resourceId);
+  if (entry != nullptr && entry->priority != newPriority) {
+    int oldPriority = entry->priority;
+    markPersistentChange(oldPriority);
+    markPersistentChange(newPriority);
+    priorityBytes[oldPriority] -= entry->size + CACHE_ENTRY_OVERHEAD;
+    priorityBytes[newPriority] += entry->size + CACHE_ENTRY_OVERHEAD;
+    if (entry->pins > 0) {
+      pinnedBytes[oldPriority] -= entry->size + CACHE_ENTRY_OVERHEAD;
+      pinnedBytes[newPriority] += entry->size + CACHE_ENTRY_OVERHEAD;
+    }
+    entry->priority = newPriority;
+    policy->onPriorityChange(entry, oldPriority);
+    if (newPriority == PRIORITY_CRITICAL || oldPriority == PRIORITY_CRITICAL) {
+      armExpiry(entry);
+    }
+    VRAM_LOGD("Updated priority for %s to %d", resourceId.c_str(), newPriority);
+  }
+}
+
+ResourceView::ResourceView(ResourceView&& other)
+  : cache(other.cache), resourceId(other.resourceId), page(other.page), data(other.data), length(other.length) {
+  other.cache = nullptr;
+  other.data = nullptr;
+  other.length = 0;
+}
+
+ResourceView& ResourceView::operator=(ResourceView&& other) {
+  if (this != &other) {
+    release();
+    cache = other.cache;
+    resourceId = other.resourceId;
+    page = other.page;
+    data = other.data;
+    length = other.length;
+    other.cache = nullptr;
+    other.data = nullptr;
+    other.length = 0;
+  }
+  return *this;
+}
+
+void ResourceView::release() {
+  if (cache != nullptr && data != nullptr) {
+    cache->unpin(resourceId, page, data);
   }
+  cache = nullptr;
+  data = nullptr;
+  length = 0;
 }
 
 #endif // RESOURCE_CACHE_H
\ No newline at end of file
@@ -0,0 +1,212 @@
+/*
+ * Resource Delta for VRAM System
+ * Rebuilds an updated resource from the cached version and a binary delta
+ * served as 226 IM Used, instead of downloading the whole payload again
+ */
+
+#ifndef RESOURCE_DELTA_H
+#define RESOURCE_DELTA_H
+
+#include <Arduino.h>
+#include "vram_log.h"
+#include <mbedtls/md.h>
+#include "memory_manager.h"
+#include "resource_cache.h"
+#include "fetch_worker.h"
+
+// Delta configuration
+#define DELTA_OP_COPY      1    // varint offset, varint length: bytes of the base
+#define DELTA_OP_INSERT    2    // varint length, then literal bytes
+#define DELTA_HEADER_SIZE  3    // 'V' 'D' and the format version
+
+static const ResourceId DELTA_TAG("delta");  // Allocation tag of patched buffers
+
+/*
+ * A delta is 'V' 'D' 1, the base and target lengths as LEB128 varints,
+ * then copy and insert operations (see DELTA_OP_*). The server encodes
+ * it against the version whose hash the client sent in If-None-Match,
+ * when the request names DELTA_ENCODING in A-IM.
+ *
+ * The target is built in a fresh buffer next to the cached base and
+ * replaces the entry through adopt(), so a view held on the old payload
+ * stays valid. The SHA-256 of the result must match X-Resource-Hash;
+ * anything else, including a base that changed while the request was
+ * in flight, is reported as a failure and the caller fetches in full.
+ */
+class ResourceDelta {
+private:
+  unsigned long applied;
+  unsigned long rejected;
+  unsigned long bytesReceived;    // Delta payloads
+  unsigned long bytesRebuilt;     // Resources they stood for
+  
+  static bool readVarint(const uint8_t*& cursor, const uint8_t* end, size_t& value);
+  
+public:
+  ResourceDelta();
+  
+  // Main task: patch the cached entry with a 226 result. Takes ownership
+  // of result.data; false means the entry is unchanged.
+  bool apply(ResourceCache& cache, FetchResult& result);
+  
+  // VRAM_MALLOC'd, NUL-terminated target, nullptr if the delta is malformed
+  // or was made against a base of another length
+  static uint8_t* decode(const uint8_t* base, size_t baseLength,
+                         const uint8_t* delta, size_t deltaLength, size_t& length);
+  
+  // Hex SHA-256 comparison, as the server computes X-Resource-Hash
+  static bool matchesHash(const uint8_t* data, size_t length, const char* hash);
+  
+  void printStats();
+};
+
+// Implementation
+ResourceDelta::ResourceDelta() {
+  applied = 0;
+  rejected = 0;
+  bytesReceived = 0;
+  bytesRebuilt = 0;
+}
+
+bool ResourceDelta::readVarint(const uint8_t*& cursor, const uint8_t* end, size_t& value) {
+  value = 0;
+  for (int shift = 0; shift < 32; shift += 7) {
+    if (cursor >= end) {
+      return false;
+    }
+    uint8_t byte = *cursor++;
+    value |= (size_t)(byte & 0x7F) << shift;
+    if ((byte & 0x80) == 0) {
+      return true;
+    }
+  }
+  return false;
+}
+
+uint8_t* ResourceDelta::decode(const uint8_t* base, size_t baseLength,
+                               const uint8_t* delta, size_t deltaLength, size_t& length) {
+  const uint8_t* cursor = delta;
+  const uint8_t* end = delta + deltaLength;
+  length = 0;
+  
+  size_t expectedBase, targetLength;
+  if (deltaLength < DELTA_HEADER_SIZE || cursor[0] != 'V' || cursor[1] != 'D' || cursor[2] != 1) {
+    VRAM_LOGW("Delta: unknown format");
+    return nullptr;
+  }
+  cursor += DELTA_HEADER_SIZE;
+  if (!readVarint(cursor, end, expectedBase) || !readVarint(cursor, end, targetLength)) {
+    VRAM_LOGW("Delta: truncated header");
+    return nullptr;
+  }
+  if (expectedBase != baseLength || targetLength > MAX_RESOURCE_SIZE) {
+    VRAM_LOGW("Delta: made for a %u byte base, cached %u", (unsigned)expectedBase, (unsigned)baseLength);
+    return nullptr;
+  }
+  
+  uint8_t* target = (uint8_t*)VRAM_MALLOC(targetLength + 1, DELTA_TAG);
+  if (target == nullptr) {
+    VRAM_LOGW("Delta: cannot reserve %u bytes", (unsigned)targetLength);
+    return nullptr;
+  }
+  
+  size_t written = 0;
+  while (cursor < end) {
+    uint8_t op = *cursor++;
+    size_t offset = 0, count = 0;
+    bool valid;
+    if (op == DELTA_OP_COPY) {
+      valid = readVarint(cursor, end, offset) && readVarint(cursor, end, count) &&
+              offset <= baseLength && count <= baseLength - offset;
+    } else if (op == DELTA_OP_INSERT) {
+      valid = readVarint(cursor, end, count) && count <= (size_t)(end - cursor);
+    } else {
+      valid = false;
+    }
+    
+    if (!valid || count > targetLength - written) {
+      VRAM_LOGW("Delta: bad operation at byte %d", (int)(cursor - delta));
+      VRAM_FREE(target);
+      return nullptr;
+    }
+    
+    if (op == DELTA_OP_COPY) {
+      memcpy(target + written, base + offset, count);
+    } else {
+      memcpy(target + written, cursor, count);
+      cursor += count;
+    }
+    written += count;
+  }
+  
+  if (written != targetLength) {
+    VRAM_LOGW("Delta: rebuilt %u of %u bytes", (unsigned)written, (unsigned)targetLength);
+    VRAM_FREE(target);
+    return nullptr;
+  }
+  
+  target[targetLength] = '\0';
+  length = targetLength;
+  return target;
+}
+
+bool ResourceDelta::matchesHash(const uint8_t* data, size_t length, const char* hash) {
+  uint8_t digest[32];
+  if (mbedtls_md(mbedtls_md_info_from_type(MBEDTLS_MD_SHA256), data, length, digest) != 0) {
+    return false;
+  }
+  
+  char hex[sizeof(digest) * 2 + 1];
+  for (size_t i = 0; i < sizeof(digest); i++) {
+    sprintf(hex + i * 2, "%02x", digest[i]);
+  }
+  return strcmp(hex, hash) == 0;
+}
+
+bool ResourceDelta::apply(ResourceCache& cache, FetchResult& result) {
+  const ResourceId& resourceId = result.resourceId;
+  uint8_t* target = nullptr;
+  size_t length = 0;
+  
+  {
+    // The base only has to outlive the decode
+    ResourceView base = cache.view(resourceId);
+    if (base.isValid() && result.data != nullptr) {
+      target = decode(base.getData(), base.getLength(), result.data, result.length, length);
+    }
+  }
+  
+  size_t deltaLength = result.length;
+  VRAM_FREE(result.data);
+  result.data = nullptr;
+  
+  if (target != nullptr && !matchesHash(target, length, result.hash)) {
+    VRAM_LOGW("Delta: %s does not match hash %.12s", resourceId.c_str(), result.hash);
+    VRAM_FREE(target);
+    target = nullptr;
+  }
+  
+  if (target == nullptr || !cache.adopt(resourceId, target, length, result.priority)) {
+    rejected++;
+    return false;
+  }
+  
+  cache.setVersion(resourceId, result.hash, result.version);
+  result.length = length;
+  applied++;
+  bytesReceived += deltaLength;
+  bytesRebuilt += length;
+  return true;
+}
+
+void ResourceDelta::printStats() {
+  Serial.println("\n=== Delta Updates ===");
+  Serial.printf("Applied: %lu, rejected: %lu\n", applied, rejected);
+  if (bytesRebuilt > 0) {
+    Serial.printf("Received %lu bytes for %lu (%.1f%% saved)\n", bytesReceived, bytesRebuilt,
+                  100.0 * ((long)bytesRebuilt - (long)bytesReceived) / bytesRebuilt);
+  }
+  Serial.println("=====================\n");
+}
+
+#endif // RESOURCE_DELTA_H
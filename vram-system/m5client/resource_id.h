@@ -0,0 +1,327 @@
+/*
+ * Resource Ids for VRAM System
+ * Interned resource names, passed around as reference-counted 16-bit handles
+ */
+
+#ifndef RESOURCE_ID_H
+#define RESOURCE_ID_H
+
+#include <Arduino.h>
+#include "vram_log.h"
+
+// Intern table configuration
+#define RESOURCE_ID_MAX_NAMES   256    // Names alive at once; a name is released with its last id
+#define RESOURCE_ID_SLOTS       512    // Lookup slots, power of two, above RESOURCE_ID_MAX_NAMES
+#define RESOURCE_ID_ARENA_SIZE  6144   // Bytes for the name text, terminators included
+#define RESOURCE_ID_CHUNK       16     // Arena allocation unit
+#define RESOURCE_ID_MAX_LENGTH  63     // Longest name; matches the batch part header field
+
+#define RESOURCE_ID_CHUNKS      (RESOURCE_ID_ARENA_SIZE / RESOURCE_ID_CHUNK)
+
+// Guards the table across cores; a spinlock needs no construction, so the
+// table stays usable during static initialisation
+static portMUX_TYPE resourceIdLock = portMUX_INITIALIZER_UNLOCKED;
+
+struct ResourceIdName {
+  uint32_t hash;      // FNV-1a of the name, stable across boots
+  uint32_t refs;      // Ids holding the handle; the name is released at 0
+  uint16_t offset;    // Start of the NUL-terminated text in the arena
+  uint8_t length;
+  uint8_t chunks;     // Arena chunks held, 0 while the handle is free
+};
+
+/*
+ * Every name is stored once, so ids compare and hash as integers and
+ * copying one never touches the heap. All storage is static and
+ * zero-initialised, so ids can be created during static construction.
+ *
+ * Each id holds a reference on its name. When the last one goes, the
+ * name leaves the lookup slots and its handle and arena chunks are
+ * reused, so the table bounds the names in use rather than every name
+ * seen since boot. A name never moves while referenced, so reading one
+ * needs no lock; references are counted with atomics, and only adding
+ * and releasing names take the lock.
+ */
+class ResourceIdTable {
+private:
+  ResourceIdName names[RESOURCE_ID_MAX_NAMES];  // Handle h lives at names[h - 1]
+  uint16_t slots[RESOURCE_ID_SLOTS];            // Handles, 0 marks an empty slot
+  char arena[RESOURCE_ID_ARENA_SIZE];
+  uint32_t arenaMap[(RESOURCE_ID_CHUNKS + 31) / 32];  // Set bits are chunks in use
+  uint16_t freeHandles[RESOURCE_ID_MAX_NAMES];  // Released handles, reused first
+  uint16_t freeCount;
+  uint16_t handleCount;   // Handles ever issued
+  uint16_t nameCount;     // Names alive
+  uint16_t arenaUsed;
+  unsigned long overflows;
+  unsigned long released;
+  
+  bool matches(uint16_t handle, const char* name, size_t length, uint32_t hash);
+  uint16_t lookup(const char* name, size_t length, uint32_t hash, size_t& slot);  // Caller holds the lock
+  int allocateChunks(int count);  // Caller holds the lock; -1 if no run is free
+  void reclaim(uint16_t handle);
+  
+public:
+  // Handle for the name, adding it if new; 0 if too long or the table is full.
+  // Both return a reference the caller owns.
+  uint16_t intern(const char* name, size_t length);
+  
+  // Handle for a known name without adding it; 0 if unknown
+  uint16_t find(const char* name, size_t length);
+  
+  void retain(uint16_t handle) {
+    if (handle) __atomic_fetch_add(&names[handle - 1].refs, 1, __ATOMIC_RELAXED);
+  }
+  void release(uint16_t handle) {
+    if (handle && __atomic_sub_fetch(&names[handle - 1].refs, 1, __ATOMIC_ACQ_REL) == 0) {
+      reclaim(handle);
+    }
+  }
+  
+  const char* getName(uint16_t handle) { return handle ? arena + names[handle - 1].offset : ""; }
+  size_t getLength(uint16_t handle) { return handle ? names[handle - 1].length : 0; }
+  uint32_t getHash(uint16_t handle) { return handle ? names[handle - 1].hash : 0; }
+  
+  int getCount() { return nameCount; }
+  size_t getArenaUsed() { return arenaUsed; }
+  unsigned long getOverflows() { return overflows; }
+  unsigned long getReleased() { return released; }
+  
+  static uint32_t hashName(const char* name, size_t length);
+  void printStats();
+};
+
+// Global intern table
+extern ResourceIdTable resourceIds;
+
+/*
+ * Ids are copied by value everywhere; each copy holds a reference. Structs
+ * that cross a FreeRTOS queue are copied bytewise, so the sender calls
+ * detach() on its ids once the item is queued, and the receiver takes the
+ * item into freshly constructed storage.
+ */
+class ResourceId {
+private:
+  uint16_t handle;
+  
+  explicit ResourceId(uint16_t ownedHandle) : handle(ownedHandle) {}  // Takes over a reference
+  
+public:
+  ResourceId() : handle(0) {}
+  ResourceId(const char* name) : handle(name ? resourceIds.intern(name, strlen(name)) : 0) {}
+  ResourceId(const char* name, size_t length) : handle(resourceIds.intern(name, length)) {}
+  ResourceId(const String& name) : handle(resourceIds.intern(name.c_str(), name.length())) {}
+  
+  ResourceId(const ResourceId& other) : handle(other.handle) { resourceIds.retain(handle); }
+  ResourceId(ResourceId&& other) : handle(other.handle) { other.handle = 0; }
+  ~ResourceId() { resourceIds.release(handle); }
+  
+  ResourceId& operator=(const ResourceId& other) {
+    if (handle != other.handle) {
+      resourceIds.retain(other.handle);
+      resourceIds.release(handle);
+      handle = other.handle;
+    }
+    return *this;
+  }
+  ResourceId& operator=(ResourceId&& other) {
+    if (this != &other) {
+      resourceIds.release(handle);
+      handle = other.handle;
+      other.handle = 0;
+    }
+    return *this;
+  }
+  
+  // Existing id only; use for lookups of names that may never have been seen,
+  // so they take no room in the table
+  static ResourceId find(const char* name) { return find(name, name ? strlen(name) : 0); }
+  static ResourceId find(const char* name, size_t length) { return ResourceId(resourceIds.find(name, length)); }
+  static ResourceId find(const String& name) { return find(name.c_str(), name.length()); }
+  
+  // A bytewise copy now owns the reference; this id becomes empty
+  void detach() { handle = 0; }
+  
+  // False for the empty id and for names that could not be interned
+  bool isValid() const { return handle != 0; }
+  uint16_t getHandle() const { return handle; }
+  
+  const char* c_str() const { return resourceIds.getName(handle); }
+  size_t length() const { return resourceIds.getLength(handle); }
+  uint32_t hash() const { return resourceIds.getHash(handle); }
+  String toString() const { return String(c_str()); }
+  
+  bool operator==(const ResourceId& other) const { return handle == other.handle; }
+  bool operator!=(const ResourceId& other) const { return handle != other.handle; }
+  bool operator<(const ResourceId& other) const { return handle < other.handle; }
+};
+
+// Implementation
+uint32_t ResourceIdTable::hashName(const char* name, size_t length) {
+  uint32_t hash = 2166136261u;
+  for (size_t i = 0; i < length; i++) {
+    hash = (hash ^ (uint8_t)name[i]) * 16777619u;
+  }
+  return hash;
+}
+
+bool ResourceIdTable::matches(uint16_t handle, const char* name, size_t length, uint32_t hash) {
+  const ResourceIdName& entry = names[handle - 1];
+  return entry.hash == hash && entry.length == length &&
+         memcmp(arena + entry.offset, name, length) == 0;
+}
+
+uint16_t ResourceIdTable::lookup(const char* name, size_t length, uint32_t hash, size_t& slot) {
+  slot = hash & (RESOURCE_ID_SLOTS - 1);
+  while (slots[slot] != 0) {
+    if (matches(slots[slot], name, length, hash)) {
+      return slots[slot];
+    }
+    slot = (slot + 1) & (RESOURCE_ID_SLOTS - 1);
+  }
+  return 0;
+}
+
+int ResourceIdTable::allocateChunks(int count) {
+  // First fit; names are short, so runs are a few chunks
+  int run = 0;
+  for (int chunk = 0; chunk < RESOURCE_ID_CHUNKS; chunk++) {
+    if (arenaMap[chunk / 32] & (1u << (chunk % 32))) {
+      run = 0;
+      continue;
+    }
+    if (++run == count) {
+      int first = chunk - count + 1;
+      for (int i = first; i <= chunk; i++) {
+        arenaMap[i / 32] |= 1u << (i % 32);
+      }
+      return first;
+    }
+  }
+  return -1;
+}
+
+uint16_t ResourceIdTable::find(const char* name, size_t length) {
+  if (name == nullptr || length == 0 || length > RESOURCE_ID_MAX_LENGTH) {
+    return 0;
+  }
+  
+  uint32_t hash = hashName(name, length);
+  size_t slot;
+  
+  // Referenced under the lock, so a concurrent release cannot reclaim it
+  portENTER_CRITICAL(&resourceIdLock);
+  uint16_t handle = lookup(name, length, hash, slot);
+  retain(handle);
+  portEXIT_CRITICAL(&resourceIdLock);
+  return handle;
+}
+
+uint16_t ResourceIdTable::intern(const char* name, size_t length) {
+  if (length == 0) {
+    return 0;
+  }
+  if (length > RESOURCE_ID_MAX_LENGTH) {
+    portENTER_CRITICAL(&resourceIdLock);
+    overflows++;
+    portEXIT_CRITICAL(&resourceIdLock);
+    VRAM_LOGW("Resource id too long (%u chars, max %d)", (unsigned)length, RESOURCE_ID_MAX_LENGTH);
+    return 0;
+  }
+  
+  uint32_t hash = hashName(name, length);
+  size_t slot;
+  int chunks = (length + RESOURCE_ID_CHUNK) / RESOURCE_ID_CHUNK;  // Text and terminator
+  
+  portENTER_CRITICAL(&resourceIdLock);
+  uint16_t handle = lookup(name, length, hash, slot);
+  bool full = false;
+  
+  if (handle != 0) {
+    retain(handle);
+  } else {
+    // New name; the empty slot ends its probe chain
+    int first = -1;
+    if (freeCount > 0 || handleCount < RESOURCE_ID_MAX_NAMES) {
+      first = allocateChunks(chunks);
+    }
+    
+    if (first < 0) {
+      overflows++;
+      full = true;
+    } else {
+      handle = freeCount > 0 ? freeHandles[--freeCount] : ++handleCount;
+      ResourceIdName& entry = names[handle - 1];
+      entry.hash = hash;
+      entry.refs = 1;
+      entry.offset = first * RESOURCE_ID_CHUNK;
+      entry.length = length;
+      entry.chunks = chunks;
+      memcpy(arena + entry.offset, name, length);
+      arena[entry.offset + length] = '\0';
+      arenaUsed += chunks * RESOURCE_ID_CHUNK;
+      nameCount++;
+      
+      // Publish only once the name is complete
+      slots[slot] = handle;
+    }
+  }
+  portEXIT_CRITICAL(&resourceIdLock);
+  
+  if (full) {
+    VRAM_LOGW("Resource id table full, cannot add %.*s", (int)length, name);
+  }
+  return handle;
+}
+
+void ResourceIdTable::reclaim(uint16_t handle) {
+  portENTER_CRITICAL(&resourceIdLock);
+  ResourceIdName& entry = names[handle - 1];
+  
+  // intern() may have found the name again before we got the lock
+  if (entry.chunks == 0 || __atomic_load_n(&entry.refs, __ATOMIC_ACQUIRE) != 0) {
+    portEXIT_CRITICAL(&resourceIdLock);
+    return;
+  }
+  
+  // Backward-shift deletion, as in the cache index
+  size_t mask = RESOURCE_ID_SLOTS - 1;
+  size_t hole = entry.hash & mask;
+  while (slots[hole] != handle) {
+    hole = (hole + 1) & mask;
+  }
+  size_t slot = hole;
+  while (true) {
+    slot = (slot + 1) & mask;
+    if (slots[slot] == 0) break;
+    
+    size_t home = names[slots[slot] - 1].hash & mask;
+    if (((slot - home) & mask) >= ((slot - hole) & mask)) {
+      slots[hole] = slots[slot];
+      hole = slot;
+    }
+  }
+  slots[hole] = 0;
+  
+  int first = entry.offset / RESOURCE_ID_CHUNK;
+  for (int i = first; i < first + entry.chunks; i++) {
+    arenaMap[i / 32] &= ~(1u << (i % 32));
+  }
+  arenaUsed -= entry.chunks * RESOURCE_ID_CHUNK;
+  entry.chunks = 0;
+  freeHandles[freeCount++] = handle;
+  nameCount--;
+  released++;
+  portEXIT_CRITICAL(&resourceIdLock);
+}
+
+void ResourceIdTable::printStats() {
+  Serial.println("\n=== Resource Ids ===");
+  Serial.printf("Names: %d / %d\n", nameCount, RESOURCE_ID_MAX_NAMES);
+  Serial.printf("Arena: %d / %d bytes\n", arenaUsed, RESOURCE_ID_ARENA_SIZE);
+  Serial.printf("Released: %lu\n", released);
+  Serial.printf("Rejected: %lu\n", overflows);
+  Serial.println("====================\n");
+}
+
+#endif // RESOURCE_ID_H
@@ -0,0 +1,225 @@
+/*
+ * Resource Pager for VRAM System
+ * Reads resources larger than MAX_RESOURCE_SIZE through the cache one
+ * page at a time, fetching only the pages a read touches
+ */
+
+#ifndef RESOURCE_PAGER_H
+#define RESOURCE_PAGER_H
+
+#include <Arduino.h>
+#include "vram_log.h"
+#include "resource_id.h"
+#include "resource_cache.h"
+#include "fetch_worker.h"
+
+// Pager configuration
+#define PAGER_TRACKED_RESOURCES  8      // Paged resources whose size and hash are known
+#define PAGER_FAULT_TIMEOUT      FETCH_TIMEOUT
+#define PAGER_PRIORITY           PRIORITY_NORMAL
+
+/*
+ * Pages are fetched with HTTP Range requests on the raw endpoint, up to
+ * FETCH_PAGES_MAX missing pages per request, and cached as ordinary
+ * entries keyed by (id, page). Each page is evicted on its own, so the
+ * working set of a large table or font pack is all that stays in heap.
+ *
+ * Every page response carries the content hash. A page whose hash
+ * differs from the one recorded for the resource means it changed on
+ * the server, and the pages cached so far are dropped. Pages are only
+ * trusted while their resource is tracked; a resource that loses its
+ * slot loses its pages the next time it is read.
+ *
+ * read() waits for the worker like a page fault, so it belongs on the
+ * main task, which is the one that polls the worker.
+ */
+class ResourcePager {
+private:
+  struct PagedResource {
+    ResourceId resourceId;
+    size_t length;              // 0 until a page response reports it
+    char hash[FETCH_HASH_SIZE];
+  };
+  
+  ResourceCache* cache;
+  FetchWorker* worker;
+  PagedResource tracked[PAGER_TRACKED_RESOURCES];
+  int nextSlot;                 // Round-robin replacement
+  unsigned long faults;
+  unsigned long pagesFetched;
+  unsigned long pagesDropped;
+  
+  PagedResource* find(const ResourceId& resourceId);
+  PagedResource* track(const ResourceId& resourceId);
+  bool fault(const ResourceId& resourceId, uint16_t page, uint16_t lastPage, int priority);
+  
+public:
+  ResourcePager();
+  
+  void begin(ResourceCache& resourceCache, FetchWorker& fetchWorker);
+  
+  // Copy up to length bytes from offset; returns the bytes copied, which
+  // is short at the end of the resource or when a page cannot be fetched
+  size_t read(const ResourceId& resourceId, size_t offset, uint8_t* buffer, size_t length,
+              int priority = PAGER_PRIORITY);
+  
+  // Size of a resource read before, 0 if unknown
+  size_t getLength(const ResourceId& resourceId);
+  
+  // Fetch delivery for page results; takes ownership of the data
+  bool deliver(FetchResult& result);
+  
+  void printStats();
+};
+
+// Implementation
+ResourcePager::ResourcePager() {
+  cache = nullptr;
+  worker = nullptr;
+  nextSlot = 0;
+  faults = 0;
+  pagesFetched = 0;
+  pagesDropped = 0;
+  for (int i = 0; i < PAGER_TRACKED_RESOURCES; i++) {
+    tracked[i].length = 0;
+    tracked[i].hash[0] = '\0';
+  }
+}
+
+void ResourcePager::begin(ResourceCache& resourceCache, FetchWorker& fetchWorker) {
+  cache = &resourceCache;
+  worker = &fetchWorker;
+}
+
+ResourcePager::PagedResource* ResourcePager::find(const ResourceId& resourceId) {
+  for (int i = 0; i < PAGER_TRACKED_RESOURCES; i++) {
+    if (tracked[i].resourceId == resourceId) {
+      return &tracked[i];
+    }
+  }
+  return nullptr;
+}
+
+ResourcePager::PagedResource* ResourcePager::track(const ResourceId& resourceId) {
+  PagedResource* resource = find(resourceId);
+  if (resource != nullptr) {
+    return resource;
+  }
+  
+  // Pages cached before it was tracked are of no known version
+  pagesDropped += cache->removePages(resourceId);
+  
+  resource = &tracked[nextSlot];
+  nextSlot = (nextSlot + 1) % PAGER_TRACKED_RESOURCES;
+  resource->resourceId = resourceId;
+  resource->length = 0;
+  resource->hash[0] = '\0';
+  return resource;
+}
+
+bool ResourcePager::fault(const ResourceId& resourceId, uint16_t page, uint16_t lastPage, int priority) {
+  // Extend the request over the missing pages that follow
+  int count = 1;
+  while (count < FETCH_PAGES_MAX && page + count <= lastPage &&
+         !cache->containsPage(resourceId, page + count)) {
+    count++;
+  }
+  
+  faults++;
+  FetchHandle handle = worker->fetchPages(resourceId, page, count, priority);
+  if (!handle.isValid()) {
+    return false;
+  }
+  
+  return worker->wait(handle, PAGER_FAULT_TIMEOUT) == FETCH_DONE;
+}
+
+size_t ResourcePager::read(const ResourceId& resourceId, size_t offset, uint8_t* buffer, size_t length, int priority) {
+  if (cache == nullptr || !resourceId.isValid() || length == 0) {
+    return 0;
+  }
+  
+  PagedResource* resource = track(resourceId);
+  if (resource->length > 0) {
+    if (offset >= resource->length) {
+      return 0;
+    }
+    length = min(length, resource->length - offset);
+  }
+  
+  uint16_t lastPage = (offset + length - 1) / RESOURCE_PAGE_SIZE;
+  size_t copied = 0;
+  while (copied < length) {
+    size_t position = offset + copied;
+    uint16_t page = position / RESOURCE_PAGE_SIZE;
+    
+    ResourceView view = cache->viewPage(resourceId, page);
+    if (!view.isValid()) {
+      if (!fault(resourceId, page, lastPage, priority)) {
+        VRAM_LOGW("Pager: cannot fetch %s page %d", resourceId.c_str(), page);
+        break;
+      }
+      view = cache->viewPage(resourceId, page);
+      if (!view.isValid()) {
+        break;  // Evicted again at once; the cache is too small for this read
+      }
+    }
+    
+    size_t pageOffset = position - (size_t)page * RESOURCE_PAGE_SIZE;
+    if (pageOffset >= view.getLength()) {
+      break;  // Past the end of a short final page
+    }
+    
+    size_t chunk = min(length - copied, view.getLength() - pageOffset);
+    memcpy(buffer + copied, view.getData() + pageOffset, chunk);
+    copied += chunk;
+  }
+  
+  return copied;
+}
+
+size_t ResourcePager::getLength(const ResourceId& resourceId) {
+  PagedResource* resource = find(resourceId);
+  return resource ? resource->length : 0;
+}
+
+bool ResourcePager::deliver(FetchResult& result) {
+  if (result.data == nullptr) {
+    return false;
+  }
+  
+  PagedResource* resource = track(result.resourceId);
+  if (result.totalLength > 0) {
+    resource->length = result.totalLength;
+  }
+  
+  // A new hash means the resource changed between page fetches
+  if (strcmp(resource->hash, result.hash) != 0) {
+    if (resource->hash[0] != '\0') {
+      VRAM_LOGI("Pager: %s changed on the server, dropping its pages", result.resourceId.c_str());
+      pagesDropped += cache->removePages(result.resourceId);
+    }
+    strcpy(resource->hash, result.hash);
+  }
+  
+  if (!cache->adoptPage(result.resourceId, result.page, result.data, result.length, result.priority)) {
+    return false;
+  }
+  
+  pagesFetched++;
+  return true;
+}
+
+void ResourcePager::printStats() {
+  Serial.println("\n=== Resource Pager ===");
+  Serial.printf("Page faults: %lu, pages fetched: %lu, dropped: %lu\n", faults, pagesFetched, pagesDropped);
+  Serial.printf("Cached pages: %d\n", cache ? cache->getPageCount() : 0);
+  for (int i = 0; i < PAGER_TRACKED_RESOURCES; i++) {
+    if (tracked[i].resourceId.isValid()) {
+      Serial.printf("  %s: %u bytes\n", tracked[i].resourceId.c_str(), (unsigned)tracked[i].length);
+    }
+  }
+  Serial.println("======================\n");
+}
+
+#endif // RESOURCE_PAGER_H
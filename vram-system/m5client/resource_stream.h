@@ -0,0 +1,779 @@
+/*
+ * Resource Stream for VRAM System
+ * Reads resource responses from the HTTP stream in fixed-size chunks
+ */
+
+#ifndef RESOURCE_STREAM_H
+#define RESOURCE_STREAM_H
+
+#include <Arduino.h>
+#include "vram_log.h"
+#include <HTTPClient.h>
+#include "memory_manager.h"
+#include "resource_id.h"
+#include "inflate.h"
+
+// Stream configuration
+#define STREAM_CHUNK_SIZE     512    // Bytes read from the socket per iteration
+#define STREAM_READ_TIMEOUT   10000  // Abort if no bytes arrive for this long
+#define ENVELOPE_KEY_SIZE     24     // Longest envelope key we need to recognise
+#define ENVELOPE_SCALAR_SIZE  24     // Longest scalar value we need to keep
+#define BATCH_LINE_SIZE       176    // Longest batch part header line
+#define BATCH_END_MARKER      "END"  // Line that closes a batch body
+
+// Response headers describing a binary resource body
+#define HEADER_RESOURCE_SIZE      "X-Resource-Size"
+#define HEADER_RESOURCE_HASH      "X-Resource-Hash"
+#define HEADER_RESOURCE_VERSION   "X-Resource-Version"
+#define HEADER_RESOURCE_ENCODING  "X-Resource-Encoding"
+#define HEADER_RESOURCE_HINTS     "X-Resource-Hints"     // Ids often requested next, comma separated
+#define HEADER_RESOURCE_TTL       "X-Resource-TTL"       // Seconds a copy stays current, 0 for no limit
+#define HEADER_CONTENT_RANGE      "Content-Range"        // bytes <first>-<last>/<total> on a 206
+#define HEADER_ACCEPT_IM          "A-IM"                 // Request: deltas the client can apply (RFC 3229)
+#define DELTA_ENCODING            "vram-delta"           // The one it can; see resource_delta.h
+
+// Allocation tags for buffers that belong to no cached resource yet;
+// interned once rather than on every allocation
+static const ResourceId STREAM_TAG("stream");
+static const ResourceId INFLATE_TAG("inflate");
+
+// Read up to maxLength bytes from the response stream.
+// Returns the byte count, 0 if the connection closed, -1 on timeout.
+int readStreamChunk(HTTPClient& http, uint8_t* dest, size_t maxLength, unsigned long timeout) {
+  WiFiClient* stream = http.getStreamPtr();
+  unsigned long start = millis();
+  
+  while (http.connected() || stream->available()) {
+    size_t available = stream->available();
+    if (available > 0) {
+      return stream->readBytes(dest, min(available, maxLength));
+    }
+    if (millis() - start > timeout) {
+      VRAM_LOGW("Stream: read timeout");
+      return -1;
+    }
+    delay(1);
+  }
+  
+  return 0;
+}
+
+// Read and drop length bytes. Returns false if the stream ended first.
+bool skipStreamBytes(HTTPClient& http, size_t length, unsigned long timeout) {
+  uint8_t scratch[64];
+  
+  while (length > 0) {
+    int bytesRead = readStreamChunk(http, scratch, min(length, sizeof(scratch)), timeout);
+    if (bytesRead <= 0) {
+      return false;
+    }
+    length -= bytesRead;
+  }
+  
+  return true;
+}
+
+// Read one '\n'-terminated line into a NUL-terminated buffer, without the '\n'.
+// Returns the line length, or -1 if the stream ended or the line is too long.
+int readStreamLine(HTTPClient& http, char* line, size_t maxLength, unsigned long timeout) {
+  size_t length = 0;
+  
+  while (true) {
+    uint8_t c;
+    if (readStreamChunk(http, &c, 1, timeout) <= 0) {
+      return -1;
+    }
+    if (c == '\n') {
+      break;
+    }
+    if (length + 1 >= maxLength) {
+      return -1;
+    }
+    line[length++] = (char)c;
+  }
+  
+  line[length] = '\0';
+  return length;
+}
+
+// Decode hex digits in place; each byte replaces the two digits it was read from
+size_t hexDecodeInPlace(uint8_t* data, size_t length) {
+  size_t decoded = length / 2;
+  
+  for (size_t i = 0; i < decoded; i++) {
+    char byteString[3] = { (char)data[i * 2], (char)data[i * 2 + 1], '\0' };
+    data[i] = (uint8_t)strtol(byteString, NULL, 16);
+  }
+  
+  return decoded;
+}
+
+// Compressed bytes pulled from the response stream one chunk at a time
+class StreamInflateSource : public InflateSource {
+private:
+  HTTPClient& http;
+  size_t remaining;
+  unsigned long timeout;
+  uint8_t chunk[STREAM_CHUNK_SIZE];
+  size_t chunkLength;
+  size_t position;
+  
+public:
+  StreamInflateSource(HTTPClient& http, size_t length, unsigned long timeout)
+    : http(http), remaining(length), timeout(timeout), chunkLength(0), position(0) {}
+  
+  int readByte() override {
+    if (position == chunkLength) {
+      if (remaining == 0) return -1;
+      
+      int bytesRead = readStreamChunk(http, chunk, min(remaining, sizeof(chunk)), timeout);
+      if (bytesRead <= 0) {
+        remaining = 0;
+        return -1;
+      }
+      
+      remaining -= bytesRead;
+      chunkLength = bytesRead;
+      position = 0;
+    }
+    return chunk[position++];
+  }
+  
+  // Drop whatever the inflater did not consume, keeping the stream framed
+  bool drain() {
+    size_t length = remaining;
+    remaining = 0;
+    chunkLength = position = 0;
+    return skipStreamBytes(http, length, timeout);
+  }
+};
+
+// Inflate a gzip member into a new buffer of exactly expectedSize bytes
+uint8_t* inflateToBuffer(InflateSource& source, size_t expectedSize) {
+  uint8_t* output = (uint8_t*)VRAM_MALLOC(expectedSize + 1, INFLATE_TAG);
+  if (output == nullptr) {
+    VRAM_LOGW("Inflate: cannot reserve %u bytes", (unsigned)expectedSize);
+    return nullptr;
+  }
+  
+  Inflater inflater(&source, output, expectedSize);
+  InflateResult result = inflater.inflateGzip();
+  
+  if (result != INFLATE_OK || inflater.getOutputLength() != expectedSize) {
+    VRAM_LOGW("Inflate failed: %s (%u of %u bytes)", Inflater::resultString(result),
+                  (unsigned)inflater.getOutputLength(), (unsigned)expectedSize);
+    VRAM_FREE(output);
+    return nullptr;
+  }
+  
+  output[expectedSize] = '\0';
+  return output;
+}
+
+/*
+ * Incremental parser for the flat JSON envelope served by
+ * /api/resources/<id>. Only the scalar envelope fields are kept; the
+ * "data" string is unescaped on the fly into a buffer sized up front
+ * from the declared Content-Length, so the payload exists exactly once
+ * in the heap while it is being received.
+ */
+class ResourceEnvelopeReader {
+private:
+  enum ParseState {
+    EXPECT_KEY,
+    IN_KEY,
+    EXPECT_COLON,
+    EXPECT_VALUE,
+    IN_STRING,
+    IN_ESCAPE,
+    IN_UNICODE,
+    IN_SCALAR,
+    PARSE_DONE,
+    PARSE_ERROR
+  };
+
+  ParseState state;
+  bool inDataField;
+  char key[ENVELOPE_KEY_SIZE];
+  size_t keyLength;
+  char scalar[ENVELOPE_SCALAR_SIZE];
+  size_t scalarLength;
+  uint16_t unicodeValue;
+  uint16_t highSurrogate;
+  int unicodeDigits;
+
+  uint8_t* data;
+  size_t length;
+  size_t capacity;
+  size_t maxDataSize;
+
+  // Envelope fields
+  bool compressed;
+  size_t size;
+  size_t originalSize;
+  size_t compressedSize;
+
+  void feed(const uint8_t* bytes, size_t length);
+  void feedChar(char c);
+  void emit(char c);
+  void emitCodepoint(uint32_t codepoint);
+  void finishScalar();
+  bool keyIs(const char* name) { return strcmp(key, name) == 0; }
+
+public:
+  ResourceEnvelopeReader(size_t maxDataSize);
+  ~ResourceEnvelopeReader();
+
+  // Stream the response body of an HTTP request that returned 200
+  bool read(HTTPClient& http, unsigned long timeout = STREAM_READ_TIMEOUT);
+
+  // Parsed envelope; takeData() hands the NUL-terminated buffer to the caller
+  uint8_t* takeData();
+  size_t getLength() { return length; }
+  bool isCompressed() { return compressed; }
+  size_t getSize() { return size; }
+  size_t getOriginalSize() { return originalSize; }
+  size_t getCompressedSize() { return compressedSize; }
+};
+
+// Implementation
+ResourceEnvelopeReader::ResourceEnvelopeReader(size_t maxSize) {
+  state = EXPECT_KEY;
+  inDataField = false;
+  keyLength = 0;
+  scalarLength = 0;
+  unicodeValue = 0;
+  highSurrogate = 0;
+  unicodeDigits = 0;
+  data = nullptr;
+  length = 0;
+  capacity = 0;
+  maxDataSize = maxSize;
+  compressed = false;
+  size = 0;
+  originalSize = 0;
+  compressedSize = 0;
+  key[0] = '\0';
+  scalar[0] = '\0';
+}
+
+ResourceEnvelopeReader::~ResourceEnvelopeReader() {
+  VRAM_FREE(data);
+}
+
+bool ResourceEnvelopeReader::read(HTTPClient& http, unsigned long timeout) {
+  int contentLength = http.getSize();
+  if (contentLength <= 0) {
+    VRAM_LOGW("Stream: response has no declared length");
+    return false;
+  }
+  
+  // The decoded payload is never longer than the envelope carrying it
+  capacity = min((size_t)contentLength, maxDataSize);
+  data = (uint8_t*)VRAM_MALLOC(capacity + 1, STREAM_TAG);
+  if (data == nullptr) {
+    VRAM_LOGW("Stream: cannot reserve %u bytes for payload", (unsigned)capacity);
+    return false;
+  }
+  
+  uint8_t chunk[STREAM_CHUNK_SIZE];
+  int remaining = contentLength;
+  
+  while (remaining > 0 && state != PARSE_DONE && state != PARSE_ERROR) {
+    int bytesRead = readStreamChunk(http, chunk, min((size_t)remaining, sizeof(chunk)), timeout);
+    if (bytesRead <= 0) break;
+    
+    feed(chunk, bytesRead);
+    remaining -= bytesRead;
+  }
+  
+  if (state != PARSE_DONE) {
+    VRAM_LOGW("Stream: %s", state == PARSE_ERROR ? "malformed envelope" : "connection closed early");
+    return false;
+  }
+  
+  if (compressed) {
+    // original_size sizes the output buffer, so bound it like the payload
+    if (originalSize > maxDataSize) {
+      VRAM_LOGW("Stream: payload exceeds %u bytes", (unsigned)maxDataSize);
+      return false;
+    }
+    
+    // Hex digits -> gzip member -> payload of original_size bytes
+    size_t compressedLength = hexDecodeInPlace(data, length);
+    MemoryInflateSource source(data, compressedLength);
+    uint8_t* output = inflateToBuffer(source, originalSize);
+    
+    VRAM_FREE(data);
+    data = output;
+    if (data == nullptr) {
+      return false;
+    }
+    length = capacity = originalSize;
+  }
+  
+  data[length] = '\0';
+  return true;
+}
+
+uint8_t* ResourceEnvelopeReader::takeData() {
+  uint8_t* result = data;
+  
+  // Give back the envelope overhead we reserved
+  if (result != nullptr && length < capacity) {
+    result = (uint8_t*)VRAM_REALLOC(data, length + 1, STREAM_TAG);
+    if (result == nullptr) {
+      result = data;
+    }
+  }
+  
+  data = nullptr;
+  return result;
+}
+
+void ResourceEnvelopeReader::feed(const uint8_t* bytes, size_t length) {
+  for (size_t i = 0; i < length && state != PARSE_DONE && state != PARSE_ERROR; i++) {
+    feedChar((char)bytes[i]);
+  }
+}
+
+void ResourceEnvelopeReader::feedChar(char c) {
+  switch (state) {
+    case EXPECT_KEY:
+      if (c == '"') {
+        keyLength = 0;
+        state = IN_KEY;
+      } else if (c == '}') {
+        state = PARSE_DONE;
+      }
+      // Skip '{', ',' and whitespace
+      break;
+
+    case IN_KEY:
+      if (c == '"') {
+        key[keyLength] = '\0';
+        state = EXPECT_COLON;
+      } else if (keyLength < ENVELOPE_KEY_SIZE - 1) {
+        key[keyLength++] = c;
+      }
+      break;
+
+    case EXPECT_COLON:
+      if (c == ':') {
+        state = EXPECT_VALUE;
+      }
+      break;
+
+    case EXPECT_VALUE:
+      if (c == ' ' || c == '\t' || c == '\r' || c == '\n') {
+        break;
+      }
+      scalarLength = 0;
+      if (c == '"') {
+        inDataField = keyIs("data");
+        state = IN_STRING;
+      } else if (c == '{' || c == '[') {
+        state = PARSE_ERROR;  // The envelope is flat
+      } else {
+        scalar[scalarLength++] = c;
+        state = IN_SCALAR;
+      }
+      break;
+
+    case IN_STRING:
+      if (c == '\\') {
+        state = IN_ESCAPE;
+      } else if (c == '"') {
+        inDataField = false;
+        state = EXPECT_KEY;
+      } else {
+        emit(c);
+      }
+      break;
+
+    case IN_ESCAPE:
+      state = IN_STRING;
+      switch (c) {
+        case 'n': emit('\n'); break;
+        case 't': emit('\t'); break;
+        case 'r': emit('\r'); break;
+        case 'b': emit('\b'); break;
+        case 'f': emit('\f'); break;
+        case 'u':
+          unicodeValue = 0;
+          unicodeDigits = 0;
+          state = IN_UNICODE;
+          break;
+        default: emit(c); break;  // '"', '\\' and '/'
+      }
+      break;
+
+    case IN_UNICODE: {
+      int nibble;
+      if (c >= '0' && c <= '9') nibble = c - '0';
+      else if (c >= 'a' && c <= 'f') nibble = c - 'a' + 10;
+      else if (c >= 'A' && c <= 'F') nibble = c - 'A' + 10;
+      else { state = PARSE_ERROR; break; }
+
+      unicodeValue = (unicodeValue << 4) | nibble;
+      if (++unicodeDigits < 4) break;
+
+      state = IN_STRING;
+      if (unicodeValue >= 0xD800 && unicodeValue <= 0xDBFF) {
+        highSurrogate = unicodeValue;  // Wait for the low half
+      } else if (unicodeValue >= 0xDC00 && unicodeValue <= 0xDFFF && highSurrogate) {
+        emitCodepoint(0x10000 + ((uint32_t)(highSurrogate - 0xD800) << 10) + (unicodeValue - 0xDC00));
+        highSurrogate = 0;
+      } else {
+        emitCodepoint(unicodeValue);
+        highSurrogate = 0;
+      }
+      break;
+    }
+
+    case IN_SCALAR:
+      if (c == ',' || c == '}' || c == ' ' || c == '\r' || c == '\n') {
+        finishScalar();
+        state = (c == '}') ? PARSE_DONE : EXPECT_KEY;
+      } else if (scalarLength < ENVELOPE_SCALAR_SIZE - 1) {
+        scalar[scalarLength++] = c;
+      }
+      break;
+
+    default:
+      break;
+  }
+}
+
+void ResourceEnvelopeReader::emit(char c) {
+  if (!inDataField) return;  // Other string fields are not needed
+
+  if (length >= capacity) {
+    VRAM_LOGW("Stream: payload exceeds %u bytes", (unsigned)capacity);
+    state = PARSE_ERROR;
+    return;
+  }
+
+  data[length++] = (uint8_t)c;
+}
+
+void ResourceEnvelopeReader::emitCodepoint(uint32_t codepoint) {
+  // Re-encode \uXXXX escapes as UTF-8
+  if (codepoint < 0x80) {
+    emit((char)codepoint);
+  } else if (codepoint < 0x800) {
+    emit((char)(0xC0 | (codepoint >> 6)));
+    emit((char)(0x80 | (codepoint & 0x3F)));
+  } else if (codepoint < 0x10000) {
+    emit((char)(0xE0 | (codepoint >> 12)));
+    emit((char)(0x80 | ((codepoint >> 6) & 0x3F)));
+    emit((char)(0x80 | (codepoint & 0x3F)));
+  } else {
+    emit((char)(0xF0 | (codepoint >> 18)));
+    emit((char)(0x80 | ((codepoint >> 12) & 0x3F)));
+    emit((char)(0x80 | ((codepoint >> 6) & 0x3F)));
+    emit((char)(0x80 | (codepoint & 0x3F)));
+  }
+}
+
+void ResourceEnvelopeReader::finishScalar() {
+  scalar[scalarLength] = '\0';
+
+  if (keyIs("compressed")) {
+    compressed = strcmp(scalar, "true") == 0;
+  } else if (keyIs("size")) {
+    size = strtoul(scalar, NULL, 10);
+  } else if (keyIs("original_size")) {
+    originalSize = strtoul(scalar, NULL, 10);
+  } else if (keyIs("compressed_size")) {
+    compressedSize = strtoul(scalar, NULL, 10);
+  }
+}
+
+/*
+ * Reader for the application/octet-stream body served by
+ * /api/resources/<id>/raw. The payload is read straight from the socket
+ * into a buffer sized from Content-Length, with no envelope to decode.
+ */
+class ResourceBodyReader {
+private:
+  uint8_t* data;
+  size_t length;
+  size_t maxDataSize;
+  bool consumed;
+  
+  // Header metadata
+  String hash;
+  int version;
+  bool compressed;
+  size_t originalSize;
+  
+  bool fits(size_t wireLength);
+  
+public:
+  ResourceBodyReader(size_t maxDataSize);
+  ~ResourceBodyReader();
+  
+  // Must be called before GET() so HTTPClient keeps the metadata headers
+  static void collectHeaders(HTTPClient& http);
+  
+  bool read(HTTPClient& http, unsigned long timeout = STREAM_READ_TIMEOUT);
+  
+  // For payloads framed inside a larger body: metadata comes from the frame,
+  // and exactly wireLength bytes are consumed even when the payload is refused
+  void setMetadata(const String& hash, int version, bool compressed, size_t originalSize);
+  bool readPayload(HTTPClient& http, size_t wireLength, unsigned long timeout = STREAM_READ_TIMEOUT);
+  bool streamConsumed() { return consumed; }
+  
+  // takeData() hands the NUL-terminated buffer to the caller
+  uint8_t* takeData();
+  size_t getLength() { return length; }
+  const String& getHash() { return hash; }
+  int getVersion() { return version; }
+  bool isCompressed() { return compressed; }
+  size_t getOriginalSize() { return originalSize; }
+};
+
+ResourceBodyReader::ResourceBodyReader(size_t maxSize) {
+  data = nullptr;
+  length = 0;
+  maxDataSize = maxSize;
+  consumed = false;
+  version = 0;
+  compressed = false;
+  originalSize = 0;
+}
+
+ResourceBodyReader::~ResourceBodyReader() {
+  VRAM_FREE(data);
+}
+
+void ResourceBodyReader::collectHeaders(HTTPClient& http) {
+  static const char* headers[] = {
+    HEADER_RESOURCE_SIZE,
+    HEADER_RESOURCE_HASH,
+    HEADER_RESOURCE_VERSION,
+    HEADER_RESOURCE_ENCODING,
+    HEADER_RESOURCE_HINTS,
+    HEADER_RESOURCE_TTL,
+    HEADER_CONTENT_RANGE
+  };
+  http.collectHeaders(headers, sizeof(headers) / sizeof(headers[0]));
+}
+
+bool ResourceBodyReader::read(HTTPClient& http, unsigned long timeout) {
+  setMetadata(http.header(HEADER_RESOURCE_HASH),
+              http.header(HEADER_RESOURCE_VERSION).toInt(),
+              http.header(HEADER_RESOURCE_ENCODING) == "gzip",
+              http.header(HEADER_RESOURCE_SIZE).toInt());
+  
+  // Content-Length is the size on the wire, which differs when compressed
+  int contentLength = http.getSize();
+  if (contentLength < 0) {
+    VRAM_LOGW("Stream: response has no declared length");
+    return false;
+  }
+  
+  // Refuse before reading; the caller drops the connection
+  if (!fits(contentLength)) {
+    return false;
+  }
+  
+  return readPayload(http, contentLength, timeout);
+}
+
+void ResourceBodyReader::setMetadata(const String& newHash, int newVersion, bool isCompressed, size_t newOriginalSize) {
+  hash = newHash;
+  version = newVersion;
+  compressed = isCompressed;
+  originalSize = newOriginalSize;
+}
+
+bool ResourceBodyReader::fits(size_t wireLength) {
+  size_t payloadSize = compressed ? originalSize : wireLength;
+  if (wireLength > maxDataSize || payloadSize > maxDataSize) {
+    VRAM_LOGW("Stream: payload exceeds %u bytes", (unsigned)maxDataSize);
+    return false;
+  }
+  return true;
+}
+
+bool ResourceBodyReader::readPayload(HTTPClient& http, size_t wireLength, unsigned long timeout) {
+  consumed = false;
+  
+  if (!fits(wireLength)) {
+    consumed = skipStreamBytes(http, wireLength, timeout);
+    return false;
+  }
+  
+  if (compressed) {
+    // Inflate while the body is still arriving
+    StreamInflateSource source(http, wireLength, timeout);
+    data = inflateToBuffer(source, originalSize);
+    consumed = source.drain();
+    if (data == nullptr) {
+      return false;
+    }
+    length = originalSize;
+    return true;
+  }
+  
+  data = (uint8_t*)VRAM_MALLOC(wireLength + 1, STREAM_TAG);
+  if (data == nullptr) {
+    VRAM_LOGW("Stream: cannot reserve %u bytes for payload", (unsigned)wireLength);
+    consumed = skipStreamBytes(http, wireLength, timeout);
+    return false;
+  }
+  
+  while (length < wireLength) {
+    size_t wanted = min(wireLength - length, (size_t)STREAM_CHUNK_SIZE);
+    int bytesRead = readStreamChunk(http, data + length, wanted, timeout);
+    if (bytesRead <= 0) {
+      VRAM_LOGW("Stream: connection closed early");
+      return false;
+    }
+    length += bytesRead;
+  }
+  
+  data[length] = '\0';
+  consumed = true;
+  return true;
+}
+
+uint8_t* ResourceBodyReader::takeData() {
+  uint8_t* result = data;
+  data = nullptr;
+  return result;
+}
+
+// One entry of a batch request
+struct ResourceRequest {
+  ResourceId resourceId;
+  int priority;
+};
+
+/*
+ * Reader for the framed body served by POST /api/resources/batch.
+ * Each part is a header line followed by its payload bytes:
+ *   <id> <status> <priority> <encoding> <size> <length> <hash> <version> [<ttl>]\n
+ * and the body ends with an END line. Parts are consumed in order, each
+ * straight into its own buffer through ResourceBodyReader.
+ */
+class ResourceBatchReader {
+private:
+  HTTPClient& http;
+  unsigned long timeout;
+  bool finished;
+  bool failed;
+  bool payloadPending;
+  
+  // Current part
+  ResourceId resourceId;
+  int status;
+  int priority;
+  bool compressed;
+  size_t originalSize;
+  size_t wireLength;
+  String hash;
+  int version;
+  unsigned long ttl;
+  
+public:
+  ResourceBatchReader(HTTPClient& http, unsigned long timeout = STREAM_READ_TIMEOUT);
+  
+  // Advance to the next part, skipping an unread payload.
+  // Returns false at the END line or on a framing error.
+  bool nextPart();
+  
+  // Read the current part's payload; only valid when getStatus() is 200
+  bool readPart(ResourceBodyReader& reader);
+  
+  const ResourceId& getResourceId() { return resourceId; }
+  int getStatus() { return status; }
+  int getPriority() { return priority; }
+  unsigned long getTtl() { return ttl; }  // Seconds, 0 when the server sent none
+  
+  // True once the END line was read, so the response was consumed exactly
+  bool isFinished() { return finished; }
+};
+
+ResourceBatchReader::ResourceBatchReader(HTTPClient& httpClient, unsigned long readTimeout)
+  : http(httpClient), timeout(readTimeout) {
+  finished = false;
+  failed = false;
+  payloadPending = false;
+  status = 0;
+  priority = 0;
+  compressed = false;
+  originalSize = 0;
+  wireLength = 0;
+  version = 0;
+  ttl = 0;
+}
+
+bool ResourceBatchReader::nextPart() {
+  if (finished || failed) {
+    return false;
+  }
+  
+  if (payloadPending) {
+    payloadPending = false;
+    if (!skipStreamBytes(http, wireLength, timeout)) {
+      failed = true;
+      return false;
+    }
+  }
+  
+  char line[BATCH_LINE_SIZE];
+  if (readStreamLine(http, line, sizeof(line), timeout) < 0) {
+    VRAM_LOGW("Batch: part header missing or too long");
+    failed = true;
+    return false;
+  }
+  
+  if (strcmp(line, BATCH_END_MARKER) == 0) {
+    finished = true;
+    return false;
+  }
+  
+  char id[64];
+  char encoding[16];
+  char digest[72];
+  unsigned long size = 0;
+  unsigned long length = 0;
+  ttl = 0;
+  
+  // Field widths match the buffers above; servers before TTLs send 8 fields
+  int fields = sscanf(line, "%63s %d %d %15s %lu %lu %71s %d %lu",
+                      id, &status, &priority, encoding, &size, &length, digest, &version, &ttl);
+  if (fields != 8 && fields != 9) {
+    VRAM_LOGW("Batch: malformed part header: %s", line);
+    failed = true;
+    return false;
+  }
+  
+  resourceId = ResourceId(id);
+  compressed = strcmp(encoding, "gzip") == 0;
+  originalSize = size;
+  wireLength = length;
+  hash = digest;
+  payloadPending = wireLength > 0;
+  return true;
+}
+
+bool ResourceBatchReader::readPart(ResourceBodyReader& reader) {
+  if (!payloadPending) {
+    return false;
+  }
+  payloadPending = false;
+  
+  reader.setMetadata(hash, version, compressed, originalSize);
+  bool success = reader.readPayload(http, wireLength, timeout);
+  
+  if (!reader.streamConsumed()) {
+    failed = true;
+  }
+  return success;
+}
+
+#endif // RESOURCE_STREAM_H
@@ -0,0 +1,318 @@
+/*
+ * Telemetry for VRAM System
+ * Fixed-bucket histograms of fetch phases, cache operation times and heap
+ * samples, reported over Serial and pushed to the server's /api/telemetry
+ */
+
+#ifndef TELEMETRY_H
+#define TELEMETRY_H
+
+#include <Arduino.h>
+#include "vram_log.h"
+#include <ArduinoJson.h>
+#include "vram_lock.h"
+#include "memory_manager.h"
+
+// Telemetry configuration
+#define TELEMETRY_BUCKETS         20       // 0, 1, 2-3, 4-7, ... and 2^18 up
+#define TELEMETRY_PRIORITIES      4        // Eviction counts for priorities 1-4
+#define TELEMETRY_PUSH_INTERVAL   60000    // Histograms are pushed and reset this often
+#define TELEMETRY_JSON_SIZE       4096
+#define TELEMETRY_PATH            "/api/telemetry"
+
+enum TelemetryMetric {
+  METRIC_FETCH_DNS,       // ms, new sockets only
+  METRIC_FETCH_CONNECT,   // ms, new sockets only
+  METRIC_FETCH_TTFB,      // ms from sending the request to the parsed response headers
+  METRIC_FETCH_BODY,      // ms reading, and inflating, the body
+  METRIC_FETCH_PARSE,     // us on the main task storing the result
+  METRIC_FETCH_TOTAL,     // ms from the job starting to its result
+  METRIC_CACHE_GET,       // us
+  METRIC_CACHE_STORE,     // us
+  METRIC_HEAP_FREE,       // KB
+  METRIC_HEAP_BLOCK,      // KB, largest free block
+  METRIC_HEAP_FRAGMENTATION,  // percent
+  METRIC_COUNT
+};
+
+/*
+ * Bucket 0 counts zeros and bucket b counts values in [2^(b-1), 2^b),
+ * so recording is a count-leading-zeros and the table needs no
+ * configuration. Percentiles are the upper bound of the bucket they fall
+ * in, capped at the largest value seen: at most 2x high, which is close
+ * enough to see a tail. The server merges pushed buckets the same way.
+ */
+class Histogram {
+private:
+  uint32_t counts[TELEMETRY_BUCKETS];
+  uint32_t count;
+  uint64_t sum;
+  uint32_t maxValue;
+  
+public:
+  Histogram() { reset(); }
+  
+  void record(uint32_t value);
+  void reset();
+  
+  uint32_t getCount() const { return count; }
+  uint32_t getMax() const { return maxValue; }
+  uint64_t getSum() const { return sum; }
+  uint32_t getMean() const { return count ? sum / count : 0; }
+  uint32_t getBucket(int bucket) const { return counts[bucket]; }
+  uint32_t percentile(int percent) const;  // 0 while empty
+  
+  static int bucketOf(uint32_t value);
+  static uint32_t bucketLimit(int bucket);  // Largest value the bucket holds
+};
+
+// Records the microseconds from construction to destruction, if telemetry is set
+class Telemetry;
+class TelemetryTimer {
+private:
+  Telemetry* telemetry;
+  TelemetryMetric metric;
+  unsigned long start;
+  
+public:
+  TelemetryTimer(Telemetry* target, TelemetryMetric timed)
+    : telemetry(target), metric(timed), start(target ? micros() : 0) {}
+  ~TelemetryTimer();
+  
+  TelemetryTimer(const TelemetryTimer&) = delete;
+  TelemetryTimer& operator=(const TelemetryTimer&) = delete;
+};
+
+/*
+ * Written from both cores: the fetch worker records the network phases
+ * and the main task the rest, so every update takes the lock. Each push
+ * carries the samples since the previous successful one, which lets the
+ * server add up a fleet without tracking each device's running totals.
+ */
+class Telemetry {
+private:
+  VramMutex lock;
+  Histogram histograms[METRIC_COUNT];
+  uint32_t evictions[TELEMETRY_PRIORITIES];
+  unsigned long intervalStart;  // When the histograms were last reset
+  unsigned long lastPush;       // Last attempt, successful or not
+  unsigned long pushes;
+  unsigned long pushFailures;
+  
+public:
+  Telemetry();
+  
+  void record(TelemetryMetric metric, uint32_t value);
+  void recordEviction(int priority);
+  void sampleHeap(const MemoryInfo& info);
+  
+  // Copy of one histogram, consistent while the other core records
+  Histogram getHistogram(TelemetryMetric metric);
+  
+  // Push scheduling; serialize() fills the report, then the caller posts
+  // it and reports the outcome so a failed push keeps its samples
+  bool isDue(unsigned long now) { return now - lastPush >= TELEMETRY_PUSH_INTERVAL; }
+  void serialize(JsonObject report);
+  void pushFinished(bool success);
+  
+  void reset();
+  void printStats();
+  
+  static const char* getName(TelemetryMetric metric);
+  static const char* getUnit(TelemetryMetric metric);
+};
+
+// Implementation
+void Histogram::record(uint32_t value) {
+  counts[bucketOf(value)]++;
+  count++;
+  sum += value;
+  if (value > maxValue) {
+    maxValue = value;
+  }
+}
+
+void Histogram::reset() {
+  memset(counts, 0, sizeof(counts));
+  count = 0;
+  sum = 0;
+  maxValue = 0;
+}
+
+int Histogram::bucketOf(uint32_t value) {
+  if (value == 0) {
+    return 0;
+  }
+  int bucket = 32 - __builtin_clz(value);
+  return bucket < TELEMETRY_BUCKETS ? bucket : TELEMETRY_BUCKETS - 1;
+}
+
+uint32_t Histogram::bucketLimit(int bucket) {
+  if (bucket <= 0) {
+    return 0;
+  }
+  if (bucket >= TELEMETRY_BUCKETS - 1) {
+    return UINT32_MAX;  // Open-ended; percentile() caps it at the maximum
+  }
+  return (1UL << bucket) - 1;
+}
+
+uint32_t Histogram::percentile(int percent) const {
+  if (count == 0) {
+    return 0;
+  }
+  
+  // Rank of the sample at this percentile, counted from 1
+  uint64_t rank = ((uint64_t)count * percent + 99) / 100;
+  if (rank == 0) {
+    rank = 1;
+  }
+  
+  uint64_t seen = 0;
+  for (int bucket = 0; bucket < TELEMETRY_BUCKETS; bucket++) {
+    seen += counts[bucket];
+    if (seen >= rank) {
+      return min(bucketLimit(bucket), maxValue);
+    }
+  }
+  return maxValue;
+}
+
+TelemetryTimer::~TelemetryTimer() {
+  if (telemetry) {
+    telemetry->record(metric, micros() - start);
+  }
+}
+
+Telemetry::Telemetry() {
+  memset(evictions, 0, sizeof(evictions));
+  intervalStart = 0;
+  lastPush = 0;
+  pushes = 0;
+  pushFailures = 0;
+}
+
+const char* Telemetry::getName(TelemetryMetric metric) {
+  static const char* const names[METRIC_COUNT] = {
+    "fetch_dns", "fetch_connect", "fetch_ttfb", "fetch_body", "fetch_parse", "fetch_total",
+    "cache_get", "cache_store", "heap_free", "heap_block", "heap_fragmentation"
+  };
+  return names[metric];
+}
+
+const char* Telemetry::getUnit(TelemetryMetric metric) {
+  static const char* const units[METRIC_COUNT] = {
+    "ms", "ms", "ms", "ms", "us", "ms", "us", "us", "kb", "kb", "pct"
+  };
+  return units[metric];
+}
+
+void Telemetry::record(TelemetryMetric metric, uint32_t value) {
+  VramLock guard(lock);
+  histograms[metric].record(value);
+}
+
+void Telemetry::recordEviction(int priority) {
+  if (priority < 1 || priority > TELEMETRY_PRIORITIES) {
+    return;
+  }
+  VramLock guard(lock);
+  evictions[priority - 1]++;
+}
+
+void Telemetry::sampleHeap(const MemoryInfo& info) {
+  VramLock guard(lock);
+  histograms[METRIC_HEAP_FREE].record(info.freeHeap / 1024);
+  histograms[METRIC_HEAP_BLOCK].record(info.largestFreeBlock / 1024);
+  histograms[METRIC_HEAP_FRAGMENTATION].record(info.fragmentation);
+}
+
+Histogram Telemetry::getHistogram(TelemetryMetric metric) {
+  VramLock guard(lock);
+  return histograms[metric];
+}
+
+void Telemetry::serialize(JsonObject report) {
+  VramLock guard(lock);
+  report["interval"] = millis() - intervalStart;
+  
+  JsonArray evicted = report.createNestedArray("evictions");
+  for (int i = 0; i < TELEMETRY_PRIORITIES; i++) {
+    evicted.add(evictions[i]);
+  }
+  
+  // Empty histograms are left out and trailing empty buckets trimmed
+  JsonObject metrics = report.createNestedObject("histograms");
+  for (int metric = 0; metric < METRIC_COUNT; metric++) {
+    const Histogram& histogram = histograms[metric];
+    if (histogram.getCount() == 0) {
+      continue;
+    }
+    
+    JsonObject entry = metrics.createNestedObject(getName((TelemetryMetric)metric));
+    entry["unit"] = getUnit((TelemetryMetric)metric);
+    entry["count"] = histogram.getCount();
+    entry["sum"] = histogram.getSum();
+    entry["max"] = histogram.getMax();
+    
+    int used = TELEMETRY_BUCKETS;
+    while (used > 0 && histogram.getBucket(used - 1) == 0) {
+      used--;
+    }
+    JsonArray buckets = entry.createNestedArray("buckets");
+    for (int bucket = 0; bucket < used; bucket++) {
+      buckets.add(histogram.getBucket(bucket));
+    }
+  }
+}
+
+void Telemetry::pushFinished(bool success) {
+  VramLock guard(lock);
+  lastPush = millis();
+  if (!success) {
+    pushFailures++;
+    return;
+  }
+  
+  // Samples recorded while the report was in flight go with it; a few
+  // may be lost this way, but none is ever counted twice
+  pushes++;
+  for (int metric = 0; metric < METRIC_COUNT; metric++) {
+    histograms[metric].reset();
+  }
+  memset(evictions, 0, sizeof(evictions));
+  intervalStart = lastPush;
+}
+
+void Telemetry::reset() {
+  VramLock guard(lock);
+  for (int metric = 0; metric < METRIC_COUNT; metric++) {
+    histograms[metric].reset();
+  }
+  memset(evictions, 0, sizeof(evictions));
+  intervalStart = millis();
+}
+
+void Telemetry::printStats() {
+  VramLock guard(lock);
+  Serial.println("\n=== Telemetry ===");
+  Serial.printf("Interval: %lus, pushes: %lu (failed: %lu)\n",
+                (millis() - intervalStart) / 1000, pushes, pushFailures);
+  for (int metric = 0; metric < METRIC_COUNT; metric++) {
+    const Histogram& histogram = histograms[metric];
+    if (histogram.getCount() == 0) {
+      continue;
+    }
+    Serial.printf("%-18s n=%lu mean=%lu p50=%lu p90=%lu p99=%lu max=%lu %s\n",
+                  getName((TelemetryMetric)metric), (unsigned long)histogram.getCount(),
+                  (unsigned long)histogram.getMean(), (unsigned long)histogram.percentile(50),
+                  (unsigned long)histogram.percentile(90), (unsigned long)histogram.percentile(99),
+                  (unsigned long)histogram.getMax(), getUnit((TelemetryMetric)metric));
+  }
+  Serial.printf("Evictions by priority: %lu/%lu/%lu/%lu\n",
+                (unsigned long)evictions[0], (unsigned long)evictions[1],
+                (unsigned long)evictions[2], (unsigned long)evictions[3]);
+  Serial.println("=================\n");
+}
+
+#endif // TELEMETRY_H
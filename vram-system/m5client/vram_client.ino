@@ -13,17 +13,52 @@
 #include "memory_manager.h"
 #include "resource_cache.h"
 #include "wifi_manager.h"
+#include "resource_stream.h"
+#include "cache_snapshot.h"
+#include "flash_tier.h"
+#include "eviction_policy.h"
+#include "prefetcher.h"
+#include "fetch_worker.h"
+#include "resource_pager.h"
+#include "resource_delta.h"
+#include "telemetry.h"
+#include "display_ui.h"
 
 // Configuration
 #define MEMORY_THRESHOLD_PERCENT 90
-#define CLEANUP_PERCENTAGE 30
 #define SERVER_CHECK_INTERVAL 30000  // 30 seconds
-#define MEMORY_CHECK_INTERVAL 5000   // 5 seconds
+#define MEMORY_CHECK_INTERVAL 500    // Cache budget steps, each evicting at most BUDGET_STEP
+#define RESOURCE_TRANSFER_BINARY 1   // Fetch raw bytes instead of JSON envelopes
+#define REVALIDATE_INTERVAL 300000   // Recheck cached entries against the server every 5 minutes
+#define REVALIDATE_PER_CHECK 2       // Entries revalidated per server check
+#define STATUS_HOLD_TIME 2000        // How long a status overlay stays on screen
+#define STATS_HOLD_TIME 3000         // Memory and system stats overlays
+#define DISPLAY_REFRESH_INTERVAL 250 // Dashboard values are sampled this often; only changes are drawn
+#define DEMO_RESOURCE "data_sample"  // Fetched by button A
 
 // Global objects
+ResourceIdTable resourceIds;
 MemoryManager memoryManager;
 ResourceCache resourceCache;
 WiFiManager wifiManager;
+CacheSnapshot cacheSnapshot;
+FlashTier flashTier;
+TinyLfuPolicy evictionPolicy;  // Keeps the hot set through data_* scans; LruPolicy and LfuPolicy also available
+Prefetcher prefetcher;
+FetchWorker fetchWorker;  // Network requests run on the other core
+ResourcePager resourcePager;  // Page-at-a-time reads of resources over MAX_RESOURCE_SIZE
+ResourceDelta resourceDelta;  // Patches revalidated entries from 226 deltas
+Telemetry telemetry;  // Latency and heap histograms, pushed to /api/telemetry
+DisplayUi ui;  // Dashboard fields redrawn on change, status screens as overlays
+
+// Dashboard fields, in the order setupDashboard() adds them
+enum DashboardField {
+  FIELD_TITLE,
+  FIELD_MEMORY,
+  FIELD_SERVER,
+  FIELD_RESOURCES,
+  FIELD_HINTS
+};
 
 // System state
 struct SystemState {
@@ -32,7 +67,7 @@ struct SystemState {
   unsigned long lastMemoryCheck = 0;
   int totalRequests = 0;
   int failedRequests = 0;
-  float avgResponseTime = 0.0;
+  FetchHandle buttonLoad;          // Button A fetch in flight
 } systemState;
 
 void setup() {
@@ -48,7 +83,9 @@ void setup() {
   Serial.begin(115200);
   delay(1000);
   
-  // Initialize display
+  // Initialize display; the canvas is allocated before the heap is measured
+  ui.begin();
+  setupDashboard();
   displayBootScreen();
   
   // Initialize memory manager
@@ -56,45 +93,89 @@ void setup() {
   
   // Initialize resource cache
   resourceCache.begin();
+  resourceCache.setEvictionPolicy(&evictionPolicy);
+  resourceCache.setTelemetry(&telemetry);
+  
+  // Evicted entries are demoted to flash instead of being dropped
+  if (flashTier.begin()) {
+    resourceCache.setSecondTier(&flashTier);
+  }
+  
+  // Warm start from the flash snapshot
+  if (cacheSnapshot.begin()) {
+    cacheSnapshot.restore(resourceCache);
+  }
+  
+  // Started before WiFi so requests can queue while offline
+  fetchWorker.begin(wifiManager, deliverFetchResult);
+  fetchWorker.setTelemetry(&telemetry);
+  resourcePager.begin(resourceCache, fetchWorker);
   
   // Initialize WiFi
-  displayStatus("Connecting WiFi...");
-  if (!wifiManager.connect()) {
-    displayError("WiFi Failed!");
-    ESP.restart();
+  displayStatus("Connecting WiFi...", 0);
+  wifiManager.connect();
+  if (!wifiManager.waitForConnection()) {
+    if (cacheSnapshot.getRestoredCount() == 0) {
+      displayError("WiFi Failed!", 0);
+      ESP.restart();
+    }
+    
+    // Run from the snapshot; the WiFi manager keeps retrying in the background
+    displayStatus("Offline Mode", STATUS_HOLD_TIME);
+    return;
   }
   
-  displayStatus("WiFi Connected");
-  delay(1000);
+  displayStatus("WiFi Connected", 0);
   
   // Test server connection
-  displayStatus("Testing Server...");
+  displayStatus("Testing Server...", 0);
   testServerConnection();
   
   // Load initial resources
   loadInitialResources();
   
-  displayStatus("System Ready!");
-  delay(2000);
+  displayStatus("System Ready!", STATUS_HOLD_TIME);
 }
 
 void loop() {
   M5.update();
+  wifiManager.update();
+  
+  // Store whatever the fetch worker finished since the last pass
+  fetchWorker.poll();
+  checkButtonLoad();
   
   unsigned long currentTime = millis();
   
-  // Check memory usage periodically
+  // Drop the few entries whose TTL ran out; never a scan of the cache
+  resourceCache.expireDue(currentTime);
+  
+  // Fit the cache budget to the heap, a small step at a time
   if (currentTime - systemState.lastMemoryCheck > MEMORY_CHECK_INTERVAL) {
     checkMemoryUsage();
     systemState.lastMemoryCheck = currentTime;
   }
   
-  // Check server connection periodically
-  if (currentTime - systemState.lastServerCheck > SERVER_CHECK_INTERVAL) {
+  // Check server connection periodically; a busy worker would make the
+  // health check wait for the session, and shows the server is reachable
+  if (currentTime - systemState.lastServerCheck > SERVER_CHECK_INTERVAL && !fetchWorker.isBusy()) {
     checkServerConnection();
     systemState.lastServerCheck = currentTime;
   }
   
+  // Push the histograms while the worker is idle, like the health check
+  if (telemetry.isDue(currentTime) && systemState.serverConnected && !fetchWorker.isBusy()) {
+    pushTelemetry();
+  }
+  
+  // Load hinted resources while idle
+  if (prefetcher.isDue(currentTime) && !fetchWorker.isBusy()) {
+    runPrefetch(currentTime);
+  }
+  
+  // Persist critical and important entries when they change
+  cacheSnapshot.update(resourceCache);
+  
   // Handle button presses
   if (M5.BtnA.wasPressed()) {
     handleButtonA();
@@ -114,37 +195,76 @@ void loop() {
   delay(100);
 }
 
+void setupDashboard() {
+  ui.addField(20, 2, 40);
+  ui.addField(50);
+  ui.addField(70);
+  ui.addField(90);
+  ui.addField(110, 0.5, 12);
+  
+  ui.setField(FIELD_TITLE, GREEN, "VRAM");
+  ui.setField(FIELD_HINTS, GREEN, "A:Load B:Mem PWR:Stats");
+}
+
+// Screens are overlays over the dashboard and are pushed at once, so
+// setup() can show progress; hold is in ms, 0 until the next screen
 void displayBootScreen() {
-  M5.Display.clear();
-  M5.Display.setTextSize(2);
-  M5.Display.drawString("VRAM System", M5.Display.width() / 2, 30);
-  M5.Display.setTextSize(1);
-  M5.Display.drawString("M5StickC Plus2", M5.Display.width() / 2, 60);
-  M5.Display.drawString("Initializing...", M5.Display.width() / 2, 90);
+  ui.showOverlay(0);
+  ui.addOverlayLine(30, GREEN, 2, "VRAM System");
+  ui.addOverlayLine(60, GREEN, 1, "M5StickC Plus2");
+  ui.addOverlayLine(90, GREEN, 1, "Initializing...");
+  ui.update();
 }
 
-void displayStatus(const char* message) {
-  M5.Display.clear();
-  M5.Display.drawString("VRAM System", M5.Display.width() / 2, 20);
-  M5.Display.setTextColor(YELLOW);
-  M5.Display.drawString(message, M5.Display.width() / 2, 60);
-  M5.Display.setTextColor(GREEN);
+void displayStatus(const char* message, unsigned long hold) {
+  ui.showOverlay(hold);
+  ui.addOverlayLine(20, GREEN, 1, "VRAM System");
+  ui.addOverlayLine(60, YELLOW, 1, "%s", message);
+  ui.update();
 }
 
-void displayError(const char* message) {
-  M5.Display.clear();
-  M5.Display.setTextColor(RED);
-  M5.Display.drawString("ERROR", M5.Display.width() / 2, 20);
-  M5.Display.drawString(message, M5.Display.width() / 2, 60);
-  M5.Display.setTextColor(GREEN);
+void displayError(const char* message, unsigned long hold) {
+  ui.showOverlay(hold);
+  ui.addOverlayLine(20, RED, 1, "ERROR");
+  ui.addOverlayLine(60, RED, 1, "%s", message);
+  ui.update();
 }
 
-void testServerConnection() {
-  HTTPClient http;
-  http.begin(wifiManager.getServerURL() + "/api/health");
-  http.setTimeout(5000);
+// Conditional GET with the cached hash, run on the fetch worker:
+// 304 keeps the entry, 226 patches it, 200 replaces it. Returns an
+// invalid handle if the entry has no hash to send.
+FetchHandle revalidate(const ResourceId& resourceId) {
+  const CacheEntry* entry = resourceCache.peek(resourceId);
+  if (entry == nullptr || entry->hash.isEmpty()) {
+    return FetchHandle();
+  }
+  
+  return fetchWorker.revalidate(resourceId, entry->priority, entry->hash);
+}
+
+void revalidateStaleResources() {
+  std::vector<ResourceId> stale = resourceCache.getStaleResources(REVALIDATE_INTERVAL, REVALIDATE_PER_CHECK);
+  for (const ResourceId& resourceId : stale) {
+    revalidate(resourceId);
+  }
+}
+
+int requestHealth() {
+  if (!wifiManager.beginRequest("/api/health", 5000)) {
+    return HTTPC_ERROR_NOT_CONNECTED;
+  }
+  
+  int httpCode = wifiManager.sendRequest("GET");
+  if (httpCode > 0) {
+    wifiManager.getHTTPClient().getString();  // Drain the body so the socket stays usable
+  }
   
-  int httpCode = http.GET();
+  wifiManager.endRequest();
+  return httpCode;
+}
+
+void testServerConnection() {
+  int httpCode = requestHealth();
   if (httpCode == HTTP_CODE_OK) {
     systemState.serverConnected = true;
     Serial.println("Server connection successful");
@@ -152,140 +272,207 @@ void testServerConnection() {
     systemState.serverConnected = false;
     Serial.printf("Server connection failed: %d\n", httpCode);
   }
-  
-  http.end();
 }
 
 void loadInitialResources() {
-  displayStatus("Loading Resources...");
-  
-  // Load critical configuration first
-  requestResource("config_main", PRIORITY_CRITICAL);
-  delay(500);
+  displayStatus("Loading Resources...", 0);
+  
+  // Critical configuration, libraries and UI strings in one round trip
+  const ResourceRequest bootResources[] = {
+    { "config_main", PRIORITY_CRITICAL },
+    { "lib_sensor", PRIORITY_IMPORTANT },
+    { "ui_strings", PRIORITY_IMPORTANT }
+  };
+  
+  // Entries restored from flash only need a conditional request
+  std::vector<ResourceRequest> bootSet;
+  for (const ResourceRequest& request : bootResources) {
+    FetchHandle handle = revalidate(request.resourceId);
+    if (!handle.isValid() || fetchWorker.wait(handle) != FETCH_DONE) {
+      bootSet.push_back(request);
+    }
+  }
   
-  // Load important libraries
-  requestResource("lib_sensor", PRIORITY_IMPORTANT);
-  delay(500);
+  if (bootSet.empty()) {
+    Serial.println("Initial resources restored from snapshot");
+    return;
+  }
   
-  // Load UI resources
-  requestResource("ui_strings", PRIORITY_IMPORTANT);
-  delay(500);
+  FetchHandle batch = requestResources(bootSet, false);
+  if (!batch.isValid() || fetchWorker.wait(batch) != FETCH_DONE) {
+    // Server without the batch endpoint: fetch one at a time
+    for (const ResourceRequest& request : bootSet) {
+      fetchWorker.wait(requestResource(request.resourceId, request.priority));
+    }
+  }
   
   Serial.println("Initial resources loaded");
 }
 
-bool requestResource(const String& resourceId, int priority) {
+// Queue a fetch on the worker; the result is stored by deliverFetchResult()
+FetchHandle requestResource(const ResourceId& resourceId, int priority) {
   if (!systemState.serverConnected) {
     Serial.println("Server not connected");
-    return false;
+    return FetchHandle();
   }
   
-  unsigned long startTime = millis();
-  systemState.totalRequests++;
-  
-  HTTPClient http;
-  String url = wifiManager.getServerURL() + "/api/resources/" + resourceId;
+  FetchHandle handle = fetchWorker.fetch(resourceId, priority, RESOURCE_TRANSFER_BINARY);
+  if (!handle.isValid()) {
+    systemState.failedRequests++;
+  }
+  return handle;
+}
+
+// Fetch several resources with one POST to /api/resources/batch.
+// Prefetch batches are kept out of the server's access log and their
+// entries are flagged so the cache can count whether they get used.
+FetchHandle requestResources(const std::vector<ResourceRequest>& requests, bool prefetch) {
+  if (!systemState.serverConnected) {
+    Serial.println("Server not connected");
+    return FetchHandle();
+  }
   
-  // Add compression parameter for large resources
-  if (priority <= PRIORITY_NORMAL) {
-    url += "?compress=true";
+  return fetchWorker.fetchBatch(requests, prefetch);
+}
+
+// Called from fetchWorker.poll() on the main task, the only one that
+// touches the cache. Takes ownership of result.data.
+bool deliverFetchResult(FetchResult& result) {
+  // Pages of one range response; the pager keeps them consistent
+  if (result.page != CACHE_NO_PAGE) {
+    return resourcePager.deliver(result);
   }
   
-  http.begin(url);
-  http.setTimeout(10000);
+  const ResourceId& resourceId = result.resourceId;
+  if (!result.revalidation) {
+    systemState.totalRequests++;
+    recordResponseTime(result.elapsed);
+  }
   
-  int httpCode = http.GET();
-  bool success = false;
+  // The server's TTL restarts with every load and validation
+  if (result.httpCode == HTTP_CODE_NOT_MODIFIED) {
+    resourceCache.markValidated(resourceId);
+    resourceCache.setTtl(resourceId, result.ttl * 1000);
+    return true;
+  }
   
-  if (httpCode == HTTP_CODE_OK) {
-    String payload = http.getString();
-    
-    // Parse JSON response
-    DynamicJsonDocument doc(8192);
-    DeserializationError error = deserializeJson(doc, payload);
-    
-    if (!error) {
-      String data = doc["data"];
-      bool compressed = doc["compressed"] | false;
-      int size = doc["size"] | 0;
-      
-      // Decompress if necessary
-      if (compressed) {
-        // Handle compressed data (hex decode + gzip decompress)
-        data = decompressHexData(data);
-      }
-      
-      // Store in cache
-      success = resourceCache.store(resourceId, data, priority, size);
-      
-      if (success) {
-        Serial.printf("Resource %s loaded (%d bytes)\n", resourceId.c_str(), size);
-      }
-    } else {
-      Serial.printf("JSON parse error: %s\n", error.c_str());
+  // Delta against the cached version; a mismatch costs one full fetch
+  if (result.httpCode == HTTP_CODE_IM_USED) {
+    if (!resourceDelta.apply(resourceCache, result)) {
+      Serial.printf("Delta for %s rejected, fetching it in full\n", resourceId.c_str());
+      requestResource(resourceId, result.priority);
+      return false;
     }
-  } else {
-    Serial.printf("HTTP error for resource %s: %d\n", resourceId.c_str(), httpCode);
+    resourceCache.setTtl(resourceId, result.ttl * 1000);
+    if (result.hints[0] != '\0') {
+      prefetcher.addHints(result.hints, resourceCache);
+    }
+    Serial.printf("Resource %s patched to v%d (%u bytes)\n", resourceId.c_str(), result.version, (unsigned)result.length);
+    return true;
+  }
+  
+  if (result.httpCode == HTTP_CODE_NOT_FOUND && result.revalidation) {
+    Serial.printf("Resource %s no longer on server\n", resourceId.c_str());
+    resourceCache.remove(resourceId);
+    return false;
+  }
+  
+  if (result.httpCode != HTTP_CODE_OK) {
+    Serial.printf("HTTP error for resource %s: %d\n", resourceId.c_str(), result.httpCode);
+    systemState.failedRequests++;
+    return false;
+  }
+  
+  if (result.data == nullptr) {
+    Serial.printf("Stream error for resource %s\n", resourceId.c_str());
     systemState.failedRequests++;
+    return false;
+  }
+  
+  // Hand the buffer over to the cache without copying it
+  if (!resourceCache.adopt(resourceId, result.data, result.length, result.priority)) {
+    return false;
   }
   
-  // Update response time statistics
-  unsigned long responseTime = millis() - startTime;
-  systemState.avgResponseTime = (systemState.avgResponseTime * (systemState.totalRequests - 1) + responseTime) / systemState.totalRequests;
+  resourceCache.setVersion(resourceId, result.hash, result.version);
+  resourceCache.setTtl(resourceId, result.ttl * 1000);
+  if (result.prefetch) {
+    resourceCache.markPrefetched(resourceId);
+  } else if (result.hints[0] != '\0') {
+    prefetcher.addHints(result.hints, resourceCache);
+  }
   
-  http.end();
-  return success;
+  if (result.revalidation) {
+    Serial.printf("Resource %s updated to v%d (%u bytes)\n", resourceId.c_str(), result.version, (unsigned)result.length);
+  } else {
+    Serial.printf("Resource %s loaded (%u bytes)\n", resourceId.c_str(), (unsigned)result.length);
+  }
+  return true;
 }
 
-String decompressHexData(const String& hexData) {
-  // Convert hex string to bytes
-  int len = hexData.length() / 2;
-  uint8_t* bytes = (uint8_t*)malloc(len);
+void runPrefetch(unsigned long now) {
+  // Speculative loads never compete with cleanup for memory
+  if (!systemState.serverConnected || memoryManager.isMemoryLow()) {
+    return;
+  }
   
-  for (int i = 0; i < len; i++) {
-    String byteString = hexData.substring(i * 2, i * 2 + 2);
-    bytes[i] = (uint8_t)strtol(byteString.c_str(), NULL, 16);
+  std::vector<ResourceRequest> requests;
+  if (prefetcher.takeBatch(requests, resourceCache, now) > 0) {
+    requestResources(requests, true);
   }
+}
+
+void recordResponseTime(unsigned long responseTime) {
+  telemetry.record(METRIC_FETCH_TOTAL, responseTime);
+}
+
+// Samples since the last successful push; the server adds up the fleet
+void pushTelemetry() {
+  DynamicJsonDocument doc(TELEMETRY_JSON_SIZE);
+  JsonObject report = doc.to<JsonObject>();
+  report["device"] = wifiManager.getMACAddress();
+  report["uptime"] = millis();
+  report["hits"] = resourceCache.getCacheHits();
+  report["misses"] = resourceCache.getCacheMisses();
+  report["failed"] = systemState.failedRequests;
+  telemetry.serialize(report);
+  
+  String body;
+  serializeJson(doc, body);
   
-  // For simplicity, we'll just return the hex decoded data
-  // In a full implementation, you'd use a gzip library here
-  String result = String((char*)bytes);
-  free(bytes);
+  bool success = false;
+  if (wifiManager.beginRequest(TELEMETRY_PATH, 5000)) {
+    wifiManager.addHeader("Content-Type", "application/json");
+    int httpCode = wifiManager.sendRequest("POST", body);
+    if (httpCode > 0) {
+      wifiManager.getHTTPClient().getString();  // Drain the body so the socket stays usable
+    }
+    wifiManager.endRequest();
+    success = httpCode == HTTP_CODE_OK;
+  }
   
-  return result;
+  if (!success) {
+    VRAM_LOGW("Telemetry push failed, keeping the samples");
+  }
+  telemetry.pushFinished(success);
 }
 
+// The cache shrinks its budget under heap pressure and grows it back
+// once the heap recovers; each call evicts a few entries at most, so
+// pressure is relieved over several loops instead of in one bulk drop
 void checkMemoryUsage() {
   MemoryInfo memInfo = memoryManager.getMemoryInfo();
+  telemetry.sampleHeap(memInfo);
   
-  // Check if memory usage is too high
-  if (memInfo.usagePercent >= MEMORY_THRESHOLD_PERCENT) {
-    Serial.println("Memory threshold exceeded, triggering cleanup");
-    displayStatus("Cleaning Memory...");
-    
-    // Calculate how much to free (30% of total memory)
-    size_t targetFreeBytes = (memInfo.totalHeap * CLEANUP_PERCENTAGE) / 100;
-    
-    // Use LRU algorithm to free memory
-    int freedResources = resourceCache.freeMemory(targetFreeBytes);
-    
-    Serial.printf("Freed %d resources\n", freedResources);
-    
-    // Force garbage collection
-    memoryManager.forceGarbageCollection();
-    
-    // Update memory info
-    memInfo = memoryManager.getMemoryInfo();
-    Serial.printf("Memory after cleanup: %d%% used\n", memInfo.usagePercent);
+  int freedResources = resourceCache.adaptBudget(memInfo);
+  if (freedResources > 0) {
+    Serial.printf("Heap pressure: %u KB free, budget %u KB, evicted %d resources\n",
+                  (unsigned)(memInfo.freeHeap / 1024), (unsigned)(resourceCache.getMaxCacheSize() / 1024), freedResources);
   }
 }
 
 void checkServerConnection() {
-  HTTPClient http;
-  http.begin(wifiManager.getServerURL() + "/api/health");
-  http.setTimeout(5000);
-  
-  int httpCode = http.GET();
+  int httpCode = requestHealth();
   bool wasConnected = systemState.serverConnected;
   systemState.serverConnected = (httpCode == HTTP_CODE_OK);
   
@@ -295,21 +482,56 @@ void checkServerConnection() {
     Serial.println("Server connection lost");
   }
   
-  http.end();
+  // Refresh a few stale entries for the cost of a header exchange each
+  if (systemState.serverConnected) {
+    revalidateStaleResources();
+  }
 }
 
 void handleButtonA() {
   // Button A: Request a demo resource
   Serial.println("Button A: Requesting demo resource");
-  displayStatus("Loading Resource...");
   
-  if (requestResource("data_sample", PRIORITY_NORMAL)) {
-    displayStatus("Resource Loaded!");
+  // A prefetched copy saves the round trip
+  ResourceId resourceId(DEMO_RESOURCE);
+  ResourceView cached = resourceCache.view(resourceId);
+  if (cached.isValid()) {
+    displayStatus("Resource Cached!", STATUS_HOLD_TIME);
+    return;
+  }
+  
+  // The worker fetches it; checkButtonLoad() reports the outcome
+  systemState.buttonLoad = requestResource(resourceId, PRIORITY_NORMAL);
+  if (systemState.buttonLoad.isValid()) {
+    displayStatus("Loading Resource...", STATUS_HOLD_TIME);
   } else {
-    displayError("Load Failed!");
+    displayError("Load Failed!", STATUS_HOLD_TIME);
+  }
+}
+
+void checkButtonLoad() {
+  if (!systemState.buttonLoad.isValid()) {
+    return;
+  }
+  
+  FetchState state = fetchWorker.getState(systemState.buttonLoad);
+  if (state == FETCH_PENDING) {
+    return;
+  }
+  
+  // An outcome no longer tracked says nothing about the load; the cache does
+  if (state == FETCH_UNKNOWN) {
+    state = resourceCache.contains(ResourceId::find(DEMO_RESOURCE)) ? FETCH_DONE : FETCH_UNKNOWN;
   }
   
-  delay(2000);
+  if (state == FETCH_DONE) {
+    displayStatus("Resource Loaded!", STATUS_HOLD_TIME);
+  } else if (state == FETCH_FAILED) {
+    displayError("Load Failed!", STATUS_HOLD_TIME);
+  } else {
+    displayStatus("Load Status Unavailable", STATUS_HOLD_TIME);
+  }
+  systemState.buttonLoad = FetchHandle();
 }
 
 void handleButtonB() {
@@ -317,88 +539,56 @@ void handleButtonB() {
   Serial.println("Button B: Showing memory status");
   MemoryInfo memInfo = memoryManager.getMemoryInfo();
   
-  M5.Display.clear();
-  M5.Display.setTextSize(1);
-  M5.Display.drawString("Memory Status", M5.Display.width() / 2, 20);
-  
-  char buffer[64];
-  sprintf(buffer, "Used: %d%%", memInfo.usagePercent);
-  M5.Display.drawString(buffer, M5.Display.width() / 2, 40);
-  
-  sprintf(buffer, "Free: %d KB", memInfo.freeHeap / 1024);
-  M5.Display.drawString(buffer, M5.Display.width() / 2, 60);
-  
-  sprintf(buffer, "Cached: %d", resourceCache.getResourceCount());
-  M5.Display.drawString(buffer, M5.Display.width() / 2, 80);
-  
-  delay(3000);
+  // A snapshot held on screen while the loop carries on
+  ui.showOverlay(STATS_HOLD_TIME);
+  ui.addOverlayLine(20, GREEN, 1, "Memory Status");
+  ui.addOverlayLine(40, GREEN, 1, "Used: %d%%", memInfo.usagePercent);
+  ui.addOverlayLine(60, GREEN, 1, "Free: %u KB", (unsigned)(memInfo.freeHeap / 1024));
+  ui.addOverlayLine(80, GREEN, 1, "Cached: %d", resourceCache.getResourceCount());
 }
 
 void handlePowerButton() {
   // Power button: Show system statistics
   Serial.println("Power button: Showing system stats");
   
-  M5.Display.clear();
-  M5.Display.setTextSize(1);
-  M5.Display.drawString("System Stats", M5.Display.width() / 2, 15);
-  
-  char buffer[64];
-  sprintf(buffer, "Requests: %d", systemState.totalRequests);
-  M5.Display.drawString(buffer, M5.Display.width() / 2, 35);
-  
-  sprintf(buffer, "Failed: %d", systemState.failedRequests);
-  M5.Display.drawString(buffer, M5.Display.width() / 2, 50);
-  
-  sprintf(buffer, "Avg RT: %.1fms", systemState.avgResponseTime);
-  M5.Display.drawString(buffer, M5.Display.width() / 2, 65);
-  
-  sprintf(buffer, "Server: %s", systemState.serverConnected ? "OK" : "FAIL");
-  M5.Display.setTextColor(systemState.serverConnected ? GREEN : RED);
-  M5.Display.drawString(buffer, M5.Display.width() / 2, 80);
-  M5.Display.setTextColor(GREEN);
-  
-  delay(3000);
+  // Median and tail in ms; a mean would hide the slow requests
+  Histogram responseTimes = telemetry.getHistogram(METRIC_FETCH_TOTAL);
+  
+  // Lines are a field height apart, so no strip overlaps the next
+  ui.showOverlay(STATS_HOLD_TIME);
+  ui.addOverlayLine(15, GREEN, 1, "System Stats");
+  ui.addOverlayLine(37, GREEN, 1, "Requests: %d", systemState.totalRequests);
+  ui.addOverlayLine(59, GREEN, 1, "Failed: %d", systemState.failedRequests);
+  ui.addOverlayLine(81, GREEN, 1, "p50/p99: %lu/%lu", (unsigned long)responseTimes.percentile(50),
+                    (unsigned long)responseTimes.percentile(99));
+  ui.addOverlayLine(103, systemState.serverConnected ? GREEN : RED, 1, "Server: %s",
+                    systemState.serverConnected ? "OK" : "FAIL");
+  
+  // Full histograms and buffered debug events go to Serial
+  telemetry.printStats();
+  vramLogDump();
 }
 
+// Samples the dashboard values; ui.update() pushes only the fields whose
+// text or color changed, or the overlay while one is up
 void updateDisplay() {
   static unsigned long lastUpdate = 0;
   
-  if (millis() - lastUpdate < 1000) return;  // Update every second
-  lastUpdate = millis();
-  
-  M5.Display.clear();
-  
-  // Title
-  M5.Display.setTextSize(2);
-  M5.Display.drawString("VRAM", M5.Display.width() / 2, 20);
-  
-  // Status indicators
-  M5.Display.setTextSize(1);
-  
-  // Memory usage
-  MemoryInfo memInfo = memoryManager.getMemoryInfo();
-  char buffer[64];
-  sprintf(buffer, "Mem: %d%%", memInfo.usagePercent);
-  
-  if (memInfo.usagePercent >= MEMORY_THRESHOLD_PERCENT) {
-    M5.Display.setTextColor(RED);
-  } else if (memInfo.usagePercent >= 70) {
-    M5.Display.setTextColor(YELLOW);
-  } else {
-    M5.Display.setTextColor(GREEN);
+  if (millis() - lastUpdate >= DISPLAY_REFRESH_INTERVAL) {
+    lastUpdate = millis();
+    
+    MemoryInfo memInfo = memoryManager.getMemoryInfo();
+    uint16_t memoryColor = GREEN;
+    if (memInfo.usagePercent >= MEMORY_THRESHOLD_PERCENT) {
+      memoryColor = RED;
+    } else if (memInfo.usagePercent >= 70) {
+      memoryColor = YELLOW;
+    }
+    ui.setField(FIELD_MEMORY, memoryColor, "Mem: %d%%", memInfo.usagePercent);
+    ui.setField(FIELD_SERVER, systemState.serverConnected ? GREEN : RED,
+                systemState.serverConnected ? "Server: OK" : "Server: FAIL");
+    ui.setField(FIELD_RESOURCES, GREEN, "Resources: %d", resourceCache.getResourceCount());
   }
-  M5.Display.drawString(buffer, M5.Display.width() / 2, 50);
-  
-  // Server connection status
-  M5.Display.setTextColor(systemState.serverConnected ? GREEN : RED);
-  M5.Display.drawString(systemState.serverConnected ? "Server: OK" : "Server: FAIL", M5.Display.width() / 2, 70);
-  
-  // Resource count
-  M5.Display.setTextColor(GREEN);
-  sprintf(buffer, "Resources: %d", resourceCache.getResourceCount());
-  M5.Display.drawString(buffer, M5.Display.width() / 2, 90);
   
-  // Button hints
-  M5.Display.setTextSize(0.5);
-  M5.Display.drawString("A:Load B:Mem PWR:Stats", M5.Display.width() / 2, 110);
+  ui.update();
 }
\ No newline at end of file
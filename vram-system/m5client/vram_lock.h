@@ -0,0 +1,42 @@
+/*
+ * Locking for VRAM System
+ * FreeRTOS mutex with a scoped guard, for state shared between the main
+ * loop and the fetch worker on the other core
+ */
+
+#ifndef VRAM_LOCK_H
+#define VRAM_LOCK_H
+
+#include <Arduino.h>
+
+// Recursive, so a locked method may call another locked method of its owner
+class VramMutex {
+private:
+  SemaphoreHandle_t handle;
+  
+public:
+  VramMutex() { handle = xSemaphoreCreateRecursiveMutex(); }
+  ~VramMutex() { vSemaphoreDelete(handle); }
+  
+  VramMutex(const VramMutex&) = delete;
+  VramMutex& operator=(const VramMutex&) = delete;
+  
+  void lock() { xSemaphoreTakeRecursive(handle, portMAX_DELAY); }
+  bool tryLock(unsigned long timeoutMs) { return xSemaphoreTakeRecursive(handle, pdMS_TO_TICKS(timeoutMs)) == pdTRUE; }
+  void unlock() { xSemaphoreGiveRecursive(handle); }
+};
+
+// Holds the mutex for the enclosing scope
+class VramLock {
+private:
+  VramMutex& mutex;
+  
+public:
+  explicit VramLock(VramMutex& m) : mutex(m) { mutex.lock(); }
+  ~VramLock() { mutex.unlock(); }
+  
+  VramLock(const VramLock&) = delete;
+  VramLock& operator=(const VramLock&) = delete;
+};
+
+#endif // VRAM_LOCK_H
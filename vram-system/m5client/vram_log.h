@@ -0,0 +1,122 @@
+/*
+ * Logging for VRAM System
+ * Leveled logging filtered at compile time, with an optional event ring
+ */
+
+#ifndef VRAM_LOG_H
+#define VRAM_LOG_H
+
+#include <Arduino.h>
+#include <stdarg.h>
+
+// Log levels
+#define VRAM_LOG_LEVEL_NONE   0
+#define VRAM_LOG_LEVEL_ERROR  1
+#define VRAM_LOG_LEVEL_WARN   2
+#define VRAM_LOG_LEVEL_INFO   3
+#define VRAM_LOG_LEVEL_DEBUG  4   // Per-allocation and per-entry events
+
+// Define before including any VRAM header to change what gets compiled in.
+// Messages above this level generate no code at all.
+#ifndef VRAM_LOG_LEVEL
+#define VRAM_LOG_LEVEL VRAM_LOG_LEVEL_INFO
+#endif
+
+// Debug messages go to an in-memory ring instead of Serial when this is
+// non-zero, so hot paths never block on the UART. Dump with vramLogDump().
+#ifndef VRAM_LOG_RING_SIZE
+#define VRAM_LOG_RING_SIZE 0
+#endif
+
+#define VRAM_LOG_LINE_SIZE 128   // Longer messages are truncated
+
+#if VRAM_LOG_RING_SIZE > 0
+struct VramLogEvent {
+  unsigned long timestamp;
+  char message[VRAM_LOG_LINE_SIZE];
+};
+
+static VramLogEvent vramLogRing[VRAM_LOG_RING_SIZE];
+static size_t vramLogRingHead = 0;    // Next slot to write
+static size_t vramLogRingCount = 0;
+static portMUX_TYPE vramLogRingLock = portMUX_INITIALIZER_UNLOCKED;  // Both cores log
+#endif
+
+void vramLogWrite(int level, const char* format, ...) __attribute__((format(printf, 2, 3)));
+
+void vramLogWrite(int level, const char* format, ...) {
+  char message[VRAM_LOG_LINE_SIZE];
+
+  va_list args;
+  va_start(args, format);
+  vsnprintf(message, sizeof(message), format, args);
+  va_end(args);
+
+#if VRAM_LOG_RING_SIZE > 0
+  if (level >= VRAM_LOG_LEVEL_DEBUG) {
+    unsigned long timestamp = millis();
+    portENTER_CRITICAL(&vramLogRingLock);
+    VramLogEvent& event = vramLogRing[vramLogRingHead];
+    event.timestamp = timestamp;
+    memcpy(event.message, message, sizeof(message));
+
+    vramLogRingHead = (vramLogRingHead + 1) % VRAM_LOG_RING_SIZE;
+    if (vramLogRingCount < VRAM_LOG_RING_SIZE) {
+      vramLogRingCount++;
+    }
+    portEXIT_CRITICAL(&vramLogRingLock);
+    return;
+  }
+#endif
+
+  Serial.println(message);
+}
+
+// Print buffered events oldest first and empty the ring
+void vramLogDump() {
+#if VRAM_LOG_RING_SIZE > 0
+  Serial.printf("\n=== Recent Events (%d) ===\n", vramLogRingCount);
+
+  // Take one event at a time; Serial must not run inside the critical section
+  VramLogEvent event;
+  while (true) {
+    portENTER_CRITICAL(&vramLogRingLock);
+    bool pending = vramLogRingCount > 0;
+    if (pending) {
+      event = vramLogRing[(vramLogRingHead + VRAM_LOG_RING_SIZE - vramLogRingCount) % VRAM_LOG_RING_SIZE];
+      vramLogRingCount--;
+    }
+    portEXIT_CRITICAL(&vramLogRingLock);
+
+    if (!pending) break;
+    Serial.printf("[%lu] %s\n", event.timestamp, event.message);
+  }
+  Serial.println("========================\n");
+#endif
+}
+
+#if VRAM_LOG_LEVEL >= VRAM_LOG_LEVEL_ERROR
+#define VRAM_LOGE(...) vramLogWrite(VRAM_LOG_LEVEL_ERROR, __VA_ARGS__)
+#else
+#define VRAM_LOGE(...) do {} while (0)
+#endif
+
+#if VRAM_LOG_LEVEL >= VRAM_LOG_LEVEL_WARN
+#define VRAM_LOGW(...) vramLogWrite(VRAM_LOG_LEVEL_WARN, __VA_ARGS__)
+#else
+#define VRAM_LOGW(...) do {} while (0)
+#endif
+
+#if VRAM_LOG_LEVEL >= VRAM_LOG_LEVEL_INFO
+#define VRAM_LOGI(...) vramLogWrite(VRAM_LOG_LEVEL_INFO, __VA_ARGS__)
+#else
+#define VRAM_LOGI(...) do {} while (0)
+#endif
+
+#if VRAM_LOG_LEVEL >= VRAM_LOG_LEVEL_DEBUG
+#define VRAM_LOGD(...) vramLogWrite(VRAM_LOG_LEVEL_DEBUG, __VA_ARGS__)
+#else
+#define VRAM_LOGD(...) do {} while (0)
+#endif
+
+#endif // VRAM_LOG_H
@@ -7,16 +7,23 @@
 #define WIFI_MANAGER_H
 
 #include <Arduino.h>
+#include "vram_log.h"
 #include <WiFi.h>
 #include <HTTPClient.h>
+#include <vector>
+#include "vram_lock.h"
 
 // Default configuration
 #define DEFAULT_WIFI_SSID "VRAM_Network"
 #define DEFAULT_WIFI_PASSWORD "vram123456"
 #define DEFAULT_SERVER_URL "http://192.168.1.100:5000"
 #define WIFI_CONNECT_TIMEOUT 15000
-#define WIFI_RECONNECT_INTERVAL 30000
+#define WIFI_RECONNECT_INTERVAL 30000    // Longest backoff between reconnect attempts
+#define WIFI_BACKOFF_INITIAL 1000        // First reconnect delay, doubled per failed attempt
+#define WIFI_BACKOFF_JITTER_PERCENT 25   // Random spread so a fleet doesn't retry in lockstep
 #define CONNECTION_CHECK_INTERVAL 60000
+#define HTTP_REQUEST_TIMEOUT 10000
+#define WIFI_RADIO_ACTIVE_WINDOW 1000    // After a request the radio stays awake about this long
 
 // WiFi status
 enum WiFiStatus {
@@ -36,6 +43,17 @@ struct ConnectionStats {
   unsigned long totalUptime;
   int signalStrength;
   String lastError;
+  unsigned long httpRequests;
+  unsigned long httpReused;      // Requests sent on an already open socket
+  unsigned long httpRetries;     // Stale keep-alive sockets reopened
+};
+
+// Phases of the last request in ms; dns and connect only count when opened
+struct RequestTiming {
+  bool opened;                   // A new socket was connected for it
+  unsigned long dns;
+  unsigned long connect;
+  unsigned long firstByte;       // Request sent to response headers parsed
 };
 
 class WiFiManager {
@@ -45,15 +63,48 @@ private:
   String serverURL;
   WiFiStatus status;
   ConnectionStats stats;
-  unsigned long lastReconnectAttempt;
+  unsigned long attemptStartTime;
+  unsigned long nextAttemptTime;
   unsigned long lastConnectionCheck;
+  bool retryScheduled;
+  bool userDisconnected;
   bool autoReconnect;
   int maxReconnectAttempts;
   int reconnectAttempts;
   
+  // Set from the WiFi event task, consumed by update() on the main loop
+  bool eventsRegistered;
+  volatile bool gotIPEvent;
+  volatile bool disconnectedEvent;
+  volatile uint8_t disconnectReason;
+  
+  // Keep-alive session to serverURL, shared by all requests. The lock is
+  // held from beginRequest() to endRequest(), so the main loop and the
+  // fetch worker take turns on the socket.
+  VramMutex sessionLock;
+  volatile bool sessionStale;  // Close requested while another task had the socket
+  WiFiClient httpSocket;
+  HTTPClient httpClient;
+  String requestPath;
+  uint16_t requestTimeout;
+  std::vector<std::pair<String, String>> requestHeaders;
+  bool requestActive;
+  RequestTiming lastTiming;
+  volatile unsigned long lastRequestTime;  // 0 before the first request
+  bool powerSave;
+  
+  void registerEvents();
   void updateConnectionStats();
   void handleConnectionFailure(const String& error);
-  bool performConnection();
+  void performConnection();
+  void handleConnected();
+  void handleDisconnected(uint8_t reason);
+  void handleAttemptFailed(const String& error);
+  void scheduleReconnect();
+  unsigned long backoffDelay();
+  void openRequest();
+  bool openSocket();
+  void closeSession();
   
 public:
   WiFiManager();
@@ -64,9 +115,15 @@ public:
   void setAutoReconnect(bool enable);
   void setMaxReconnectAttempts(int attempts);
   
-  // Connection management
+  // Modem sleep between beacons when idle (WIFI_PS_MAX_MODEM): much less
+  // radio time for devices that talk rarely, at the cost of added latency
+  // on the first packet after a quiet spell. Off by default.
+  void setPowerSave(bool enable);
+  
+  // Connection management; attempts progress in update() and never block
   bool connect();
   bool connect(const String& ssid, const String& password);
+  bool waitForConnection(unsigned long timeout = WIFI_CONNECT_TIMEOUT);  // For setup() only
   void disconnect();
   bool isConnected();
   bool reconnect();
@@ -89,6 +146,23 @@ public:
   bool checkConnection();
   void handleReconnection();
   
+  // Server requests over the shared keep-alive connection, one at a time:
+  // beginRequest(), optional addHeader(), sendRequest(), read the response
+  // from getHTTPClient(), then endRequest(). beginRequest() waits up to
+  // timeout for a request in progress on another task, and fails if it
+  // is still running.
+  bool beginRequest(const String& path, uint16_t timeout = HTTP_REQUEST_TIMEOUT);
+  void addHeader(const String& name, const String& value);
+  int sendRequest(const char* method = "GET", const String& payload = String());
+  int sendRequest(const char* method, const uint8_t* payload, size_t size);
+  HTTPClient& getHTTPClient() { return httpClient; }
+  void endRequest(bool responseConsumed = true);
+  RequestTiming getLastTiming() { return lastTiming; }  // Of the caller's own request, before endRequest()
+  
+  // A request went out within window ms, so the radio is still awake and
+  // more traffic now costs little extra power
+  bool isRadioActive(unsigned long window = WIFI_RADIO_ACTIVE_WINDOW);
+  
   // Network utilities
   bool ping(const String& host, int timeout = 5000);
   bool testServerConnection();
@@ -101,11 +175,24 @@ WiFiManager::WiFiManager() {
   password = DEFAULT_WIFI_PASSWORD;
   serverURL = DEFAULT_SERVER_URL;
   status = WIFI_DISCONNECTED;
-  lastReconnectAttempt = 0;
+  attemptStartTime = 0;
+  nextAttemptTime = 0;
   lastConnectionCheck = 0;
+  retryScheduled = false;
+  userDisconnected = false;
   autoReconnect = true;
   maxReconnectAttempts = 5;
   reconnectAttempts = 0;
+  eventsRegistered = false;
+  gotIPEvent = false;
+  disconnectedEvent = false;
+  disconnectReason = 0;
+  requestTimeout = HTTP_REQUEST_TIMEOUT;
+  requestActive = false;
+  lastTiming = RequestTiming();
+  lastRequestTime = 0;
+  powerSave = false;
+  sessionStale = false;
   
   // Initialize stats
   memset(&stats, 0, sizeof(stats));
@@ -114,17 +201,25 @@ WiFiManager::WiFiManager() {
 void WiFiManager::setCredentials(const String& newSSID, const String& newPassword) {
   ssid = newSSID;
   password = newPassword;
-  Serial.printf("WiFi credentials set: %s\n", ssid.c_str());
+  VRAM_LOGI("WiFi credentials set: %s", ssid.c_str());
 }
 
 void WiFiManager::setServerURL(const String& url) {
+  closeSession();  // The open socket belongs to the old server
   serverURL = url;
-  Serial.printf("Server URL set: %s\n", serverURL.c_str());
+  VRAM_LOGI("Server URL set: %s", serverURL.c_str());
+}
+
+void WiFiManager::setPowerSave(bool enable) {
+  powerSave = enable;
+  if (isConnected()) {
+    WiFi.setSleep(powerSave ? WIFI_PS_MAX_MODEM : WIFI_PS_MIN_MODEM);
+  }
 }
 
 void WiFiManager::setAutoReconnect(bool enable) {
   autoReconnect = enable;
-  Serial.printf("Auto-reconnect: %s\n", enable ? "enabled" : "disabled");
+  VRAM_LOGI("Auto-reconnect: %s", enable ? "enabled" : "disabled");
 }
 
 void WiFiManager::setMaxReconnectAttempts(int attempts) {
@@ -136,41 +231,138 @@ bool WiFiManager::connect() {
 }
 
 bool WiFiManager::connect(const String& connectSSID, const String& connectPassword) {
-  Serial.printf("Connecting to WiFi: %s\n", connectSSID.c_str());
+  ssid = connectSSID;
+  password = connectPassword;
   
-  status = WIFI_CONNECTING;
-  stats.totalConnections++;
+  registerEvents();
+  userDisconnected = false;
+  retryScheduled = false;
+  reconnectAttempts = 0;
   
   WiFi.mode(WIFI_STA);
-  WiFi.begin(connectSSID.c_str(), connectPassword.c_str());
+  WiFi.setAutoReconnect(false);  // Reconnects are scheduled by update()
   
+  status = WIFI_CONNECTING;
+  performConnection();
+  return true;
+}
+
+bool WiFiManager::waitForConnection(unsigned long timeout) {
   unsigned long startTime = millis();
-  while (WiFi.status() != WL_CONNECTED && millis() - startTime < WIFI_CONNECT_TIMEOUT) {
-    delay(100);
-    Serial.print(".");
+  
+  while (millis() - startTime < timeout) {
+    update();
+    if (status == WIFI_CONNECTED) {
+      return true;
+    }
+    if (status == WIFI_FAILED && !retryScheduled) {
+      return false;  // Out of attempts
+    }
+    delay(10);
   }
-  Serial.println();
   
-  if (WiFi.status() == WL_CONNECTED) {
-    status = WIFI_CONNECTED;
-    updateConnectionStats();
-    reconnectAttempts = 0;
-    
-    Serial.printf("WiFi connected successfully!\n");
-    Serial.printf("IP Address: %s\n", WiFi.localIP().toString().c_str());
-    Serial.printf("Signal Strength: %d dBm\n", WiFi.RSSI());
-    
-    return true;
-  } else {
-    status = WIFI_FAILED;
-    stats.failedConnections++;
-    handleConnectionFailure("Connection timeout");
-    return false;
+  return isConnected();
+}
+
+void WiFiManager::registerEvents() {
+  if (eventsRegistered) return;
+  
+  // Runs on the WiFi event task: only record what happened
+  WiFi.onEvent([this](arduino_event_id_t event, arduino_event_info_t info) {
+    if (event == ARDUINO_EVENT_WIFI_STA_GOT_IP) {
+      gotIPEvent = true;
+    } else if (event == ARDUINO_EVENT_WIFI_STA_DISCONNECTED) {
+      disconnectReason = info.wifi_sta_disconnected.reason;
+      disconnectedEvent = true;
+    }
+  });
+  
+  eventsRegistered = true;
+}
+
+void WiFiManager::performConnection() {
+  VRAM_LOGI("Connecting to WiFi: %s", ssid.c_str());
+  stats.totalConnections++;
+  
+  gotIPEvent = false;
+  disconnectedEvent = false;
+  attemptStartTime = millis();
+  
+  WiFi.begin(ssid.c_str(), password.c_str());
+}
+
+void WiFiManager::handleConnected() {
+  status = WIFI_CONNECTED;
+  retryScheduled = false;
+  reconnectAttempts = 0;
+  updateConnectionStats();
+  
+  // The sleep mode is per association
+  WiFi.setSleep(powerSave ? WIFI_PS_MAX_MODEM : WIFI_PS_MIN_MODEM);
+  
+  VRAM_LOGI("WiFi connected in %lums", millis() - attemptStartTime);
+  VRAM_LOGI("IP Address: %s", WiFi.localIP().toString().c_str());
+  VRAM_LOGI("Signal Strength: %d dBm", stats.signalStrength);
+}
+
+void WiFiManager::handleDisconnected(uint8_t reason) {
+  if (status == WIFI_CONNECTED) {
+    stats.totalUptime += millis() - stats.lastConnectTime;
+    status = WIFI_DISCONNECTED;
+    closeSession();
+    handleConnectionFailure("Connection lost (reason " + String(reason) + ")");
+    scheduleReconnect();
+  } else if (status == WIFI_CONNECTING || status == WIFI_RECONNECTING) {
+    handleAttemptFailed("Disconnected while connecting (reason " + String(reason) + ")");
+  }
+}
+
+void WiFiManager::handleAttemptFailed(const String& error) {
+  status = WIFI_FAILED;
+  stats.failedConnections++;
+  handleConnectionFailure(error);
+  
+  WiFi.disconnect();
+  scheduleReconnect();
+}
+
+void WiFiManager::scheduleReconnect() {
+  retryScheduled = false;
+  
+  if (!autoReconnect || userDisconnected) {
+    return;
   }
+  
+  if (reconnectAttempts >= maxReconnectAttempts) {
+    VRAM_LOGW("Max reconnect attempts (%d) reached", maxReconnectAttempts);
+    return;
+  }
+  
+  unsigned long delayMs = backoffDelay();
+  nextAttemptTime = millis() + delayMs;
+  retryScheduled = true;
+  VRAM_LOGI("Reconnecting in %lums", delayMs);
+}
+
+unsigned long WiFiManager::backoffDelay() {
+  // Exponential backoff capped at WIFI_RECONNECT_INTERVAL, with jitter
+  unsigned long delayMs = (unsigned long)WIFI_BACKOFF_INITIAL << min(reconnectAttempts, 5);
+  delayMs = min(delayMs, (unsigned long)WIFI_RECONNECT_INTERVAL);
+  
+  long jitter = delayMs * WIFI_BACKOFF_JITTER_PERCENT / 100;
+  return delayMs + random(-jitter, jitter + 1);
 }
 
 void WiFiManager::disconnect() {
-  Serial.println("Disconnecting WiFi...");
+  VRAM_LOGI("Disconnecting WiFi...");
+  
+  if (status == WIFI_CONNECTED) {
+    stats.totalUptime += millis() - stats.lastConnectTime;
+  }
+  
+  userDisconnected = true;
+  retryScheduled = false;
+  closeSession();
   WiFi.disconnect();
   status = WIFI_DISCONNECTED;
 }
@@ -181,24 +373,19 @@ bool WiFiManager::isConnected() {
 
 bool WiFiManager::reconnect() {
   if (reconnectAttempts >= maxReconnectAttempts) {
-    Serial.printf("Max reconnect attempts (%d) reached\n", maxReconnectAttempts);
+    VRAM_LOGW("Max reconnect attempts (%d) reached", maxReconnectAttempts);
     return false;
   }
   
-  Serial.printf("Reconnection attempt %d/%d\n", reconnectAttempts + 1, maxReconnectAttempts);
+  VRAM_LOGI("Reconnection attempt %d/%d", reconnectAttempts + 1, maxReconnectAttempts);
   status = WIFI_RECONNECTING;
   stats.reconnections++;
   reconnectAttempts++;
   
-  WiFi.disconnect();
-  delay(1000);
-  
-  bool success = connect();
-  if (success) {
-    reconnectAttempts = 0;
-  }
-  
-  return success;
+  userDisconnected = false;
+  retryScheduled = false;
+  performConnection();
+  return true;
 }
 
 String WiFiManager::getStatusString() {
@@ -231,17 +418,14 @@ String WiFiManager::getMACAddress() {
 }
 
 void WiFiManager::updateConnectionStats() {
+  // Uptime is accumulated when the connection ends
   stats.lastConnectTime = millis();
   stats.signalStrength = WiFi.RSSI();
-  
-  if (status == WIFI_CONNECTED) {
-    stats.totalUptime += millis() - stats.lastConnectTime;
-  }
 }
 
 void WiFiManager::handleConnectionFailure(const String& error) {
   stats.lastError = error;
-  Serial.printf("WiFi connection failed: %s\n", error.c_str());
+  VRAM_LOGW("WiFi connection failed: %s", error.c_str());
 }
 
 void WiFiManager::printConnectionInfo() {
@@ -258,6 +442,8 @@ void WiFiManager::printConnectionInfo() {
   Serial.printf("Failed Connections: %lu\n", stats.failedConnections);
   Serial.printf("Reconnections: %lu\n", stats.reconnections);
   Serial.printf("Total Uptime: %lu ms\n", stats.totalUptime);
+  Serial.printf("HTTP Requests: %lu (%lu on a reused socket, %lu retried)\n",
+                stats.httpRequests, stats.httpReused, stats.httpRetries);
   if (!stats.lastError.isEmpty()) {
     Serial.printf("Last Error: %s\n", stats.lastError.c_str());
   }
@@ -267,12 +453,31 @@ void WiFiManager::printConnectionInfo() {
 void WiFiManager::resetStats() {
   memset(&stats, 0, sizeof(stats));
   stats.lastConnectTime = millis();
-  Serial.println("WiFi statistics reset");
+  VRAM_LOGI("WiFi statistics reset");
 }
 
 void WiFiManager::update() {
   unsigned long currentTime = millis();
   
+  // Consume events recorded by the WiFi task
+  if (gotIPEvent) {
+    gotIPEvent = false;
+    if (status != WIFI_CONNECTED) {
+      handleConnected();
+    }
+  }
+  
+  if (disconnectedEvent) {
+    disconnectedEvent = false;
+    handleDisconnected(disconnectReason);
+  }
+  
+  // Give up on an attempt that never produced an event
+  if ((status == WIFI_CONNECTING || status == WIFI_RECONNECTING) &&
+      currentTime - attemptStartTime > WIFI_CONNECT_TIMEOUT) {
+    handleAttemptFailed("Connection timeout");
+  }
+  
   // Check connection status periodically
   if (currentTime - lastConnectionCheck > CONNECTION_CHECK_INTERVAL) {
     checkConnection();
@@ -280,26 +485,20 @@ void WiFiManager::update() {
   }
   
   // Handle auto-reconnection
-  if (autoReconnect && !isConnected() && 
-      currentTime - lastReconnectAttempt > WIFI_RECONNECT_INTERVAL) {
-    handleReconnection();
-    lastReconnectAttempt = currentTime;
-  }
+  handleReconnection();
 }
 
 bool WiFiManager::checkConnection() {
-  bool wasConnected = isConnected();
+  // Polling fallback in case an event was missed
   bool isStillConnected = (WiFi.status() == WL_CONNECTED);
   
-  if (wasConnected && !isStillConnected) {
-    Serial.println("WiFi connection lost!");
-    status = WIFI_DISCONNECTED;
-    handleConnectionFailure("Connection lost");
+  if (status == WIFI_CONNECTED && !isStillConnected) {
+    VRAM_LOGW("WiFi connection lost!");
+    handleDisconnected(0);
     return false;
-  } else if (!wasConnected && isStillConnected) {
-    Serial.println("WiFi connection restored!");
-    status = WIFI_CONNECTED;
-    updateConnectionStats();
+  } else if (status != WIFI_CONNECTED && isStillConnected) {
+    VRAM_LOGI("WiFi connection restored!");
+    handleConnected();
     return true;
   }
   
@@ -307,17 +506,184 @@ bool WiFiManager::checkConnection() {
 }
 
 void WiFiManager::handleReconnection() {
-  if (status == WIFI_DISCONNECTED || status == WIFI_FAILED) {
-    Serial.println("Attempting auto-reconnection...");
+  if (retryScheduled && (long)(millis() - nextAttemptTime) >= 0) {
     reconnect();
   }
 }
 
+bool WiFiManager::beginRequest(const String& path, uint16_t timeout) {
+  if (!isConnected()) {
+    return false;
+  }
+  
+  if (!sessionLock.tryLock(timeout)) {
+    VRAM_LOGD("Session busy, %s not sent", path.c_str());
+    return false;
+  }
+  
+  // Only reachable by the task that left it open; the lock is recursive
+  if (requestActive) {
+    VRAM_LOGW("Previous request not ended: %s", requestPath.c_str());
+    endRequest(false);
+  }
+  
+  requestPath = path;
+  requestTimeout = timeout;
+  requestHeaders.clear();
+  requestActive = true;
+  
+  openRequest();
+  return true;
+}
+
+void WiFiManager::openRequest() {
+  // Reuses the socket when it is still connected to the server
+  httpClient.setReuse(true);
+  httpClient.begin(httpSocket, serverURL + requestPath);
+  httpClient.setTimeout(requestTimeout);
+  
+  for (const auto& header : requestHeaders) {
+    httpClient.addHeader(header.first, header.second);
+  }
+}
+
+void WiFiManager::addHeader(const String& name, const String& value) {
+  requestHeaders.push_back(std::make_pair(name, value));
+  httpClient.addHeader(name, value);
+}
+
+int WiFiManager::sendRequest(const char* method, const String& payload) {
+  return sendRequest(method, (const uint8_t*)payload.c_str(), payload.length());
+}
+
+int WiFiManager::sendRequest(const char* method, const uint8_t* payload, size_t size) {
+  if (!requestActive) {
+    return HTTPC_ERROR_NOT_CONNECTED;
+  }
+  
+  bool reused = httpSocket.connected();
+  stats.httpRequests++;
+  if (reused) {
+    stats.httpReused++;
+  }
+  
+  lastTiming = RequestTiming();
+  if (!reused && !openSocket()) {
+    return HTTPC_ERROR_CONNECTION_REFUSED;
+  }
+  
+  unsigned long sent = millis();
+  lastRequestTime = sent;
+  int httpCode = httpClient.sendRequest(method, (uint8_t*)payload, size);
+  
+  // The server may have closed an idle keep-alive socket; retry once on a fresh one
+  if (httpCode < 0 && reused) {
+    VRAM_LOGD("Keep-alive socket lost (%d), reconnecting", httpCode);
+    stats.httpRetries++;
+    httpClient.end();
+    httpSocket.stop();
+    
+    openRequest();
+    if (!openSocket()) {
+      return HTTPC_ERROR_CONNECTION_REFUSED;
+    }
+    sent = millis();
+    httpCode = httpClient.sendRequest(method, (uint8_t*)payload, size);
+  }
+  
+  lastTiming.firstByte = millis() - sent;
+  lastRequestTime = millis();
+  return httpCode;
+}
+
+bool WiFiManager::isRadioActive(unsigned long window) {
+  unsigned long last = lastRequestTime;
+  return last != 0 && millis() - last < window && isConnected();
+}
+
+bool WiFiManager::openSocket() {
+  // Resolved and connected here rather than inside HTTPClient, which
+  // reuses the open socket, so the two phases can be timed apart
+  int hostStart = serverURL.indexOf("://");
+  hostStart = hostStart >= 0 ? hostStart + 3 : 0;
+  int hostEnd = serverURL.indexOf('/', hostStart);
+  String host = hostEnd >= 0 ? serverURL.substring(hostStart, hostEnd) : serverURL.substring(hostStart);
+  uint16_t port = 80;
+  int colon = host.indexOf(':');
+  if (colon >= 0) {
+    port = host.substring(colon + 1).toInt();
+    host = host.substring(0, colon);
+  }
+  
+  unsigned long start = millis();
+  IPAddress address;
+  bool resolved = WiFi.hostByName(host.c_str(), address);
+  lastTiming.dns = millis() - start;
+  if (!resolved) {
+    VRAM_LOGW("Cannot resolve %s", host.c_str());
+    return false;
+  }
+  
+  start = millis();
+  lastTiming.opened = true;
+  bool connected = httpSocket.connect(address, port, requestTimeout);
+  lastTiming.connect = millis() - start;
+  if (!connected) {
+    VRAM_LOGD("Cannot connect to %s:%d", host.c_str(), port);
+  }
+  return connected;
+}
+
+void WiFiManager::endRequest(bool responseConsumed) {
+  if (!requestActive) {
+    return;
+  }
+  
+  // A partly read body would corrupt the next response on this socket
+  httpClient.end();
+  if (!responseConsumed || sessionStale) {
+    httpSocket.stop();
+    sessionStale = false;
+  }
+  
+  requestActive = false;
+  sessionLock.unlock();
+}
+
+void WiFiManager::closeSession() {
+  // Never wait on a transfer; its owner drops the socket when it ends
+  if (!sessionLock.tryLock(0)) {
+    sessionStale = true;
+    return;
+  }
+  
+  if (requestActive) {
+    httpClient.end();
+    requestActive = false;
+    sessionLock.unlock();  // Release the abandoned request's hold
+  }
+  httpSocket.stop();
+  sessionLock.unlock();
+}
+
 bool WiFiManager::ping(const String& host, int timeout) {
   if (!isConnected()) {
     return false;
   }
   
+  // Our own server goes over the open connection
+  if (host.startsWith(serverURL)) {
+    if (!beginRequest(host.substring(serverURL.length()), timeout)) {
+      return false;
+    }
+    int httpCode = sendRequest("GET");
+    if (httpCode > 0) {
+      httpClient.getString();  // Drain the body so the socket stays usable
+    }
+    endRequest();
+    return httpCode > 0;
+  }
+  
   HTTPClient http;
   http.begin(host);
   http.setTimeout(timeout);
@@ -329,24 +695,24 @@ bool WiFiManager::ping(const String& host, int timeout) {
 }
 
 bool WiFiManager::testServerConnection() {
-  Serial.printf("Testing server connection: %s\n", serverURL.c_str());
+  VRAM_LOGI("Testing server connection: %s", serverURL.c_str());
   
-  HTTPClient http;
-  String testURL = serverURL + "/api/health";
-  http.begin(testURL);
-  http.setTimeout(5000);
+  if (!beginRequest("/api/health", 5000)) {
+    VRAM_LOGW("Server test skipped: WiFi not connected");
+    return false;
+  }
   
-  int httpCode = http.GET();
+  int httpCode = sendRequest("GET");
   bool success = (httpCode == HTTP_CODE_OK);
   
   if (success) {
-    String response = http.getString();
-    Serial.printf("Server test successful: %s\n", response.c_str());
+    String response = httpClient.getString();
+    VRAM_LOGI("Server test successful: %s", response.c_str());
   } else {
-    Serial.printf("Server test failed with code: %d\n", httpCode);
+    VRAM_LOGW("Server test failed with code: %d", httpCode);
   }
   
-  http.end();
+  endRequest();
   return success;
 }
 
@@ -355,7 +721,7 @@ String WiFiManager::scanNetworks() {
     return "WiFi not connected";
   }
   
-  Serial.println("Scanning for networks...");
+  VRAM_LOGI("Scanning for networks...");
   int networks = WiFi.scanNetworks();
   
   String result = "Found " + String(networks) + " networks:\n";
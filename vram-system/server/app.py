@@ -4,15 +4,17 @@ VRAM System - Flask Server
 Provides resource management API for M5StickC Plus2 dynamic memory system
 """
 
-from flask import Flask, request, jsonify, send_file
+from flask import Flask, request, jsonify, send_file, Response
 import os
 import json
 import logging
 import hashlib
-import gzip
 from datetime import datetime
 import time
 from resource_manager import ResourceManager
+from telemetry import TelemetryStore
+from sensor_store import SensorStore, SensorFormatError
+from werkzeug.serving import WSGIRequestHandler
 
 # Configure logging
 logging.basicConfig(
@@ -25,13 +27,26 @@ logging.basicConfig(
 )
 
 app = Flask(__name__)
+MAX_BATCH_RESOURCES = 32  # Resources per batch request
+MAX_RESOURCE_ID_LENGTH = 63  # Longest id the client can intern
+PREFETCH_HINT_LIMIT = 3      # Likely-next resources advertised per response
+DELTA_ENCODING = 'vram-delta'  # Instance manipulation named in A-IM and IM (RFC 3229)
+SENSOR_CONTENT_TYPE = 'application/x-vram-samples'  # Packed batches from SensorRing::pack()
+SENSOR_MAX_UPLOAD = 64 * 1024  # Bytes per sensor upload
+SENSOR_SAMPLE_LIMIT = 256      # Default samples returned per device
 resource_manager = ResourceManager('resources/')
+telemetry_store = TelemetryStore()
+sensor_store = SensorStore()
 
 # Performance tracking
 request_stats = {
     'total_requests': 0,
     'avg_response_time': 0,
-    'failed_requests': 0
+    'failed_requests': 0,
+    'not_modified': 0,
+    'range_requests': 0,
+    'delta_responses': 0,
+    'delta_bytes_saved': 0
 }
 
 def track_performance(func):
@@ -55,6 +70,62 @@ def track_performance(func):
     wrapper.__name__ = func.__name__
     return wrapper
 
+def not_modified_response(resource_id):
+    """
+    Return a 304 response if the client's If-None-Match holds the current hash
+    Revalidation then costs a header exchange instead of the payload
+    """
+    version_info = resource_manager.get_version_info(resource_id)
+    if not version_info or not version_info.get('hash'):
+        return None
+    
+    if not request.if_none_match.contains(version_info['hash']):
+        return None
+    
+    request_stats['not_modified'] += 1
+    response = Response(status=304)
+    response.set_etag(version_info['hash'])
+    response.headers['X-Resource-Hash'] = version_info['hash']
+    response.headers['X-Resource-Version'] = str(version_info['version'])
+    response.headers['X-Resource-TTL'] = str(version_info['ttl'])
+    return response
+
+def delta_response(resource_id):
+    """
+    Return a 226 IM Used response carrying a binary delta, if the client
+    accepts vram-delta in A-IM and its If-None-Match holds a recent version
+    The client patches its cached copy and checks the result against the hash
+    """
+    accepted = [token.split(';')[0].strip().lower() for token in request.headers.get('A-IM', '').split(',')]
+    if DELTA_ENCODING not in accepted or request.range is not None:
+        return None
+    
+    for base_hash in request.if_none_match.as_set():
+        delta = resource_manager.get_delta(resource_id, base_hash)
+        if delta is None:
+            continue
+        
+        resource_manager.log_access(resource_id, request.remote_addr)
+        version_info = resource_manager.get_version_info(resource_id)
+        request_stats['delta_responses'] += 1
+        request_stats['delta_bytes_saved'] += version_info['size'] - len(delta)
+        
+        response = Response(delta, status=226, mimetype='application/octet-stream', headers={
+            'X-Resource-Id': resource_id,
+            'X-Resource-Size': str(len(delta)),
+            'X-Resource-Hash': version_info['hash'],
+            'X-Resource-Version': str(version_info['version']),
+            'X-Resource-Encoding': 'identity',
+            'X-Resource-TTL': str(version_info['ttl']),
+            'IM': DELTA_ENCODING,
+            'Delta-Base': f'"{base_hash}"'
+        })
+        response.set_etag(version_info['hash'])
+        add_hints_header(response, resource_id)
+        return response
+    
+    return None
+
 @app.route('/api/health', methods=['GET'])
 @track_performance
 def health_check():
@@ -65,25 +136,39 @@ def health_check():
         'stats': request_stats
     })
 
+def add_hints_header(response, resource_id):
+    """
+    Advertise the resources most often fetched after this one
+    Clients prefetch them while idle without an extra round trip
+    """
+    hints = resource_manager.get_prefetch_hints(resource_id, limit=PREFETCH_HINT_LIMIT)
+    if hints:
+        response.headers['X-Resource-Hints'] = ','.join(hint['id'] for hint in hints)
+
 @app.route('/api/resources/<resource_id>', methods=['GET'])
 @track_performance
 def get_resource(resource_id):
     """
     Get a specific resource by ID
-    Supports compression if requested
+    Supports compression if requested, and If-None-Match against the hash
     """
     try:
         compress = request.args.get('compress', 'false').lower() == 'true'
         
+        not_modified = not_modified_response(resource_id)
+        if not_modified is not None:
+            return not_modified
+        
         resource_data = resource_manager.get_resource(resource_id)
         if not resource_data:
             return jsonify({'error': 'Resource not found'}), 404
         
         # Log access
         resource_manager.log_access(resource_id, request.remote_addr)
+        version_info = resource_manager.get_version_info(resource_id)
         
         if compress and len(resource_data) > 512:  # Compress if > 512 bytes
-            compressed_data = gzip.compress(resource_data)
+            compressed_data = resource_manager.get_compressed(resource_id)
             response = jsonify({
                 'resource_id': resource_id,
                 'data': compressed_data.hex(),  # Send as hex for JSON compatibility
@@ -101,12 +186,152 @@ def get_resource(resource_id):
                 'timestamp': datetime.now().isoformat()
             })
         
+        response.set_etag(version_info['hash'])
+        add_hints_header(response, resource_id)
         return response
         
     except Exception as e:
         logging.error(f"Error getting resource {resource_id}: {str(e)}")
         return jsonify({'error': 'Internal server error'}), 500
 
+@app.route('/api/resources/<resource_id>/raw', methods=['GET'])
+@track_performance
+def get_resource_raw(resource_id):
+    """
+    Get a specific resource as raw bytes
+    Metadata is sent in X-Resource-* headers instead of a JSON envelope
+    A single-range Range header returns 206 with that slice of the stored
+    bytes, uncompressed, so clients can page through large resources
+    A revalidation from an older version may get a 226 delta instead
+    """
+    try:
+        compress = request.args.get('compress', 'false').lower() == 'true'
+        
+        not_modified = not_modified_response(resource_id)
+        if not_modified is not None:
+            return not_modified
+        
+        delta = delta_response(resource_id)
+        if delta is not None:
+            return delta
+        
+        resource_data = resource_manager.get_resource(resource_id)
+        if not resource_data:
+            return jsonify({'error': 'Resource not found'}), 404
+        
+        byte_range = None
+        if request.range is not None:
+            byte_range = request.range.range_for_length(len(resource_data))
+            if byte_range is None:
+                response = Response(status=416)
+                response.headers['Content-Range'] = f'bytes */{len(resource_data)}'
+                return response
+            request_stats['range_requests'] += 1
+        
+        # Log access; the later pages of a paged read are the same access
+        if byte_range is None or byte_range[0] == 0:
+            resource_manager.log_access(resource_id, request.remote_addr)
+        
+        version_info = resource_manager.get_version_info(resource_id)
+        headers = {
+            'X-Resource-Id': resource_id,
+            'X-Resource-Size': str(len(resource_data)),
+            'X-Resource-Hash': version_info['hash'],
+            'X-Resource-Version': str(version_info['version']),
+            'X-Resource-Encoding': 'identity',
+            'X-Resource-TTL': str(version_info['ttl']),
+            'Accept-Ranges': 'bytes'
+        }
+        
+        status = 200
+        body = resource_data
+        if byte_range is not None:
+            start, stop = byte_range
+            body = resource_data[start:stop]
+            status = 206
+            headers['X-Resource-Size'] = str(len(body))
+            headers['Content-Range'] = f'bytes {start}-{stop - 1}/{len(resource_data)}'
+        elif compress and len(resource_data) > 512:  # Compress if > 512 bytes
+            body = resource_manager.get_compressed(resource_id)
+            headers['X-Resource-Encoding'] = 'gzip'
+        
+        response = Response(body, status=status, mimetype='application/octet-stream', headers=headers)
+        response.set_etag(version_info['hash'])
+        add_hints_header(response, resource_id)
+        return response
+        
+    except Exception as e:
+        logging.error(f"Error getting raw resource {resource_id}: {str(e)}")
+        return jsonify({'error': 'Internal server error'}), 500
+
+@app.route('/api/resources/batch', methods=['POST'])
+@track_performance
+def get_resources_batch():
+    """
+    Get several resources in one framed response
+    Body: {"resources": [{"id": ..., "priority": ..., "compress": ...}], "compress": false, "prefetch": false}
+    Prefetch batches are speculative and are left out of the access log
+    Each part is a header line followed by its bytes, most urgent priority first:
+      <id> <status> <priority> <encoding> <size> <length> <hash> <version> <ttl>\n
+    The body ends with "END\n"
+    """
+    try:
+        data = request.get_json(silent=True)
+        if not data or not isinstance(data.get('resources'), list):
+            return jsonify({'error': 'Missing required field: resources'}), 400
+        
+        items = data['resources']
+        if len(items) > MAX_BATCH_RESOURCES:
+            return jsonify({'error': f'At most {MAX_BATCH_RESOURCES} resources per batch'}), 400
+        
+        compress_default = bool(data.get('compress', False))
+        prefetch = bool(data.get('prefetch', False))
+        
+        requested = []
+        for item in items:
+            if isinstance(item, str):
+                item = {'id': item}
+            if not isinstance(item, dict) or not item.get('id'):
+                return jsonify({'error': 'Each resource needs an id'}), 400
+            requested.append(item)
+        
+        # Stable sort keeps the caller's order within a priority
+        requested.sort(key=lambda item: int(item.get('priority', 3)))
+        
+        parts = []
+        for item in requested:
+            resource_id = str(item['id'])
+            priority = int(item.get('priority', 3))
+            
+            resource_data = resource_manager.get_resource(resource_id)
+            if not resource_data:
+                parts.append(f"{resource_id} 404 {priority} identity 0 0 - 0 0\n".encode())
+                continue
+            
+            if not prefetch:
+                resource_manager.log_access(resource_id, request.remote_addr)
+            version_info = resource_manager.get_version_info(resource_id)
+            
+            body = resource_data
+            encoding = 'identity'
+            if item.get('compress', compress_default) and len(resource_data) > 512:
+                body = resource_manager.get_compressed(resource_id)
+                encoding = 'gzip'
+            
+            header = (f"{resource_id} 200 {priority} {encoding} {len(resource_data)} "
+                      f"{len(body)} {version_info['hash']} {version_info['version']} {version_info['ttl']}\n")
+            parts.append(header.encode())
+            parts.append(body)
+        
+        parts.append(b"END\n")
+        
+        return Response(b''.join(parts), mimetype='application/x-vram-batch',
+                        headers={'X-Batch-Count': str(len(requested))})
+        
+    except Exception as e:
+        logging.error(f"Error getting resource batch: {str(e)}")
+        return jsonify({'error': 'Internal server error'}), 500
+
 @app.route('/api/resources', methods=['GET'])
 @track_performance
 def list_resources():
@@ -140,6 +365,26 @@ def list_resources():
         logging.error(f"Error listing resources: {str(e)}")
         return jsonify({'error': 'Internal server error'}), 500
 
+@app.route('/api/resources/<resource_id>/hints', methods=['GET'])
+@track_performance
+def get_hints(resource_id):
+    """
+    Get the resources most often requested after this one, mined from the access log
+    """
+    try:
+        limit = min(request.args.get('limit', PREFETCH_HINT_LIMIT, type=int), MAX_BATCH_RESOURCES)
+        min_count = request.args.get('min_count', 2, type=int)
+        
+        return jsonify({
+            'resource_id': resource_id,
+            'hints': resource_manager.get_prefetch_hints(resource_id, limit=limit, min_count=min_count),
+            'timestamp': datetime.now().isoformat()
+        })
+        
+    except Exception as e:
+        logging.error(f"Error getting hints for {resource_id}: {str(e)}")
+        return jsonify({'error': 'Internal server error'}), 500
+
 @app.route('/api/resources/<resource_id>/version', methods=['GET'])
 @track_performance
 def check_version(resource_id):
@@ -169,15 +414,23 @@ def upload_resource():
             return jsonify({'error': 'Missing required fields: resource_id, content'}), 400
         
         resource_id = data['resource_id']
+        if (not isinstance(resource_id, str) or not resource_id or
+                len(resource_id) > MAX_RESOURCE_ID_LENGTH or any(c.isspace() for c in resource_id)):
+            return jsonify({'error': f'resource_id must be 1-{MAX_RESOURCE_ID_LENGTH} characters without whitespace'}), 400
+        
         content = data['content']
         category = data.get('category', 'general')
         priority = data.get('priority', 1)
+        ttl = data.get('ttl', 0)
+        if not isinstance(ttl, int) or isinstance(ttl, bool) or ttl < 0:
+            return jsonify({'error': 'ttl must be a non-negative number of seconds'}), 400
         
         success = resource_manager.store_resource(
             resource_id=resource_id,
             content=content,
             category=category,
-            priority=priority
+            priority=priority,
+            ttl=ttl
         )
         
         if success:
@@ -233,6 +486,122 @@ def get_stats():
         logging.error(f"Error getting stats: {str(e)}")
         return jsonify({'error': 'Internal server error'}), 500
 
+@app.route('/api/telemetry', methods=['POST'])
+@track_performance
+def push_telemetry():
+    """
+    Accept a client's histograms since its last accepted push
+    Body: {"device": ..., "interval": ms, "hits": ..., "misses": ..., "evictions": [p1..p4],
+           "histograms": {name: {"unit", "count", "sum", "max", "buckets": [...]}}}
+    """
+    try:
+        report = request.get_json(silent=True)
+        error = TelemetryStore.validate(report)
+        if error:
+            return jsonify({'error': error}), 400
+        
+        device = str(report.get('device') or request.remote_addr)
+        telemetry_store.record(report, device)
+        return jsonify({'message': 'Telemetry recorded', 'device': device})
+        
+    except Exception as e:
+        logging.error(f"Error recording telemetry: {str(e)}")
+        return jsonify({'error': 'Internal server error'}), 500
+
+@app.route('/api/telemetry', methods=['GET'])
+@track_performance
+def get_telemetry():
+    """
+    Fleet-wide percentiles of every pushed histogram
+    """
+    try:
+        return jsonify({
+            'telemetry': telemetry_store.get_summary(),
+            'timestamp': datetime.now().isoformat()
+        })
+        
+    except Exception as e:
+        logging.error(f"Error getting telemetry: {str(e)}")
+        return jsonify({'error': 'Internal server error'}), 500
+
+@app.route('/api/telemetry/<device>', methods=['GET'])
+@track_performance
+def get_device_telemetry(device):
+    """
+    Latest report of one device, without its histograms
+    """
+    try:
+        entry = telemetry_store.get_device(device)
+        if entry is None:
+            return jsonify({'error': 'Device not found'}), 404
+        return jsonify(entry)
+        
+    except Exception as e:
+        logging.error(f"Error getting device telemetry: {str(e)}")
+        return jsonify({'error': 'Internal server error'}), 500
+
+@app.route('/api/sensors', methods=['POST'])
+@track_performance
+def upload_sensors():
+    """
+    Accept a packed batch of sensor samples
+    Headers: Content-Type: application/x-vram-samples, X-Device-Id, X-Boot-Id
+    Samples a retried upload repeats are counted as duplicates and not stored again;
+    a new X-Boot-Id restarts the node's sequence numbers
+    """
+    try:
+        if request.mimetype != SENSOR_CONTENT_TYPE:
+            return jsonify({'error': f'Content-Type must be {SENSOR_CONTENT_TYPE}'}), 415
+        if (request.content_length or 0) > SENSOR_MAX_UPLOAD:
+            return jsonify({'error': f'At most {SENSOR_MAX_UPLOAD} bytes per upload'}), 413
+        
+        device = request.headers.get('X-Device-Id') or request.remote_addr
+        try:
+            result = sensor_store.record(device, request.get_data(), request.headers.get('X-Boot-Id'))
+        except SensorFormatError as e:
+            return jsonify({'error': str(e)}), 400
+        
+        result['device'] = device
+        return jsonify(result)
+    
+    except Exception as e:
+        logging.error(f"Error recording sensor samples: {str(e)}")
+        return jsonify({'error': 'Internal server error'}), 500
+
+@app.route('/api/sensors', methods=['GET'])
+@track_performance
+def get_sensors():
+    """
+    Upload totals and the sensor nodes seen
+    """
+    try:
+        return jsonify({
+            'sensors': sensor_store.get_summary(),
+            'timestamp': datetime.now().isoformat()
+        })
+    
+    except Exception as e:
+        logging.error(f"Error getting sensors: {str(e)}")
+        return jsonify({'error': 'Internal server error'}), 500
+
+@app.route('/api/sensors/<device>', methods=['GET'])
+@track_performance
+def get_device_sensors(device):
+    """
+    Most recent samples of one sensor node, oldest first
+    Query: ?limit=N (0 for all kept)
+    """
+    try:
+        limit = request.args.get('limit', SENSOR_SAMPLE_LIMIT, type=int)
+        samples = sensor_store.get_samples(device, limit)
+        if samples is None:
+            return jsonify({'error': 'Device not found'}), 404
+        return jsonify({'device': device, 'count': len(samples), 'samples': samples})
+    
+    except Exception as e:
+        logging.error(f"Error getting device sensors: {str(e)}")
+        return jsonify({'error': 'Internal server error'}), 500
+
 @app.route('/api/optimize', methods=['POST'])
 @track_performance
 def optimize_resources():
@@ -271,6 +640,9 @@ if __name__ == '__main__':
     resource_manager.create_demo_resources()
     
     # Run the server
+    # HTTP/1.1 keeps client sockets open between requests
+    WSGIRequestHandler.protocol_version = "HTTP/1.1"
+    
     app.run(
         host='0.0.0.0',
         port=5000,
@@ -0,0 +1,31 @@
+"""
+VRAM System - Production Server Settings
+Used by start_server.sh --production: gunicorn -c gunicorn.conf.py app:app
+
+One worker process with a thread pool. ResourceManager keeps metadata,
+the hot cache and buffered access log lines in memory and rewrites
+metadata.json on flush, and request_stats and the telemetry store are
+per-process too, so several processes would split that state and
+overwrite each other's metadata.
+"""
+
+import os
+
+bind = os.environ.get('VRAM_BIND', '0.0.0.0:5000')
+workers = 1
+worker_class = 'gthread'
+threads = int(os.environ.get('VRAM_THREADS', '32'))
+
+# Idle client sockets wait in the worker's selector without holding a
+# thread; longer than the 30s health check so a device keeps its socket
+keepalive = 35
+worker_connections = int(os.environ.get('VRAM_MAX_CONNECTIONS', '1000'))
+
+timeout = 120           # REQUEST_TIMEOUT
+graceful_timeout = 10   # Time for the final flush on shutdown
+accesslog = None        # Accesses are logged by ResourceManager
+
+def post_worker_init(worker):
+    """The demo resources app.py creates when run directly"""
+    from app import resource_manager
+    resource_manager.create_demo_resources()
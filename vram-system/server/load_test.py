@@ -0,0 +1,413 @@
+#!/usr/bin/env python3
+"""
+VRAM System - Fleet Load Generator
+Simulates many M5StickC Plus2 clients against one server and reports
+throughput and latency percentiles per endpoint
+"""
+
+import argparse
+import http.client
+import json
+import random
+import sys
+import threading
+import time
+from collections import Counter
+from typing import Dict, List, Optional, Tuple
+from urllib.parse import urlsplit
+
+# Client protocol, as in vram_client.ino and fetch_worker.h
+BOOT_RESOURCES = (('config_main', 1), ('lib_sensor', 2), ('ui_strings', 2))  # loadInitialResources()
+HEALTH_INTERVAL = 30        # SERVER_CHECK_INTERVAL, seconds
+REVALIDATE_INTERVAL = 300   # REVALIDATE_INTERVAL: cached entries older than this are rechecked
+REVALIDATE_PER_CHECK = 2    # Entries revalidated per health check
+TELEMETRY_INTERVAL = 60     # TELEMETRY_PUSH_INTERVAL
+TELEMETRY_BUCKETS = 20
+COMPRESS_PRIORITY = 3       # Requests at this priority or more urgent ask for compression
+REQUEST_TIMEOUT = 10        # FETCH_TIMEOUT, seconds
+DELTA_ENCODING = 'vram-delta'
+
+PROGRESS_INTERVAL = 10      # Seconds between progress lines
+LISTING_PAGE_SIZE = 200
+PERCENTILES = (50, 90, 99)
+
+def percentile(samples: List[float], percent: int) -> float:
+    """Nearest-rank percentile of sorted samples"""
+    if not samples:
+        return 0.0
+    rank = max(1, -(-len(samples) * percent // 100))
+    return samples[rank - 1]
+
+def histogram_bucket(value: int) -> int:
+    """The client's Histogram bucket: 0, 1, 2-3, 4-7, ... with the last one open-ended"""
+    return min(max(value, 0).bit_length(), TELEMETRY_BUCKETS - 1)
+
+class LoadStats:
+    """Latency samples and status counts per endpoint, shared by every device"""
+    
+    def __init__(self):
+        self.lock = threading.Lock()
+        self.endpoints = {}   # name -> {'latencies', 'statuses', 'errors', 'bytes'}
+        self.started = time.time()
+    
+    def record(self, endpoint: str, latency_ms: float, status: int, size: int, ok: bool) -> None:
+        with self.lock:
+            entry = self.endpoints.setdefault(endpoint, {
+                'latencies': [], 'statuses': Counter(), 'errors': 0, 'bytes': 0
+            })
+            entry['latencies'].append(latency_ms)
+            entry['statuses'][status] += 1
+            entry['bytes'] += size
+            if not ok:
+                entry['errors'] += 1
+    
+    def totals(self) -> Tuple[int, int]:
+        with self.lock:
+            requests = sum(len(entry['latencies']) for entry in self.endpoints.values())
+            errors = sum(entry['errors'] for entry in self.endpoints.values())
+            return requests, errors
+    
+    def summary(self, elapsed: float) -> Dict[str, dict]:
+        """Per-endpoint throughput and latency percentiles, in ms"""
+        with self.lock:
+            result = {}
+            for name, entry in sorted(self.endpoints.items()):
+                latencies = sorted(entry['latencies'])
+                summary = {
+                    'requests': len(latencies),
+                    'errors': entry['errors'],
+                    'rps': round(len(latencies) / elapsed, 2) if elapsed > 0 else 0,
+                    'mean': round(sum(latencies) / len(latencies), 2) if latencies else 0,
+                    'max': round(latencies[-1], 2) if latencies else 0,
+                    'bytes': entry['bytes'],
+                    'statuses': {str(status): count for status, count in sorted(entry['statuses'].items())}
+                }
+                for percent in PERCENTILES:
+                    summary[f'p{percent}'] = round(percentile(latencies, percent), 2)
+                result[name] = summary
+            return result
+
+class VirtualDevice(threading.Thread):
+    """
+    One client on its own keep-alive connection: health check and batch
+    load of the boot set at start, a health check every HEALTH_INTERVAL
+    with revalidation of a few stale entries, random data_* fetches and a
+    telemetry push every TELEMETRY_INTERVAL
+    """
+    
+    def __init__(self, index: int, args, stats: LoadStats, data_resources: Dict[str, int], stop: threading.Event):
+        super().__init__(name=f'device-{index}', daemon=True)
+        self.index = index
+        self.args = args
+        self.stats = stats
+        self.data_resources = data_resources
+        self.data_ids = sorted(data_resources)
+        self.stop = stop
+        self.random = random.Random(args.seed * 7919 + index)
+        self.device = f'load-{index:04d}'
+        self.connection = None
+        self.cached = {}   # id -> [hash, priority, fetched at]
+        self.fetch_latencies = []   # Since the last telemetry push, in ms
+        self.hits = 0
+        self.misses = 0
+    
+    def _request(self, endpoint: str, method: str, path: str, body: Optional[bytes] = None,
+                 headers: Optional[dict] = None, expected: Tuple[int, ...] = (200,)):
+        """Send one request and read the whole body; returns (status, headers, body) or None"""
+        start = time.perf_counter()
+        try:
+            if self.connection is None:
+                self.connection = http.client.HTTPConnection(self.args.host, self.args.port,
+                                                             timeout=REQUEST_TIMEOUT)
+            self.connection.request(method, path, body=body, headers=headers or {})
+            response = self.connection.getresponse()
+            data = response.read()
+            latency = (time.perf_counter() - start) * 1000
+            if response.will_close:
+                self._close()
+            ok = response.status in expected
+            self.stats.record(endpoint, latency, response.status, len(data), ok)
+            return response.status, response, data
+        except (OSError, http.client.HTTPException):
+            # Refused, reset or timed out: a new connection on the next request
+            self._close()
+            self.stats.record(endpoint, (time.perf_counter() - start) * 1000, 0, 0, False)
+            return None
+    
+    def _close(self):
+        if self.connection is not None:
+            self.connection.close()
+            self.connection = None
+    
+    def health(self) -> bool:
+        result = self._request('GET /api/health', 'GET', '/api/health')
+        return result is not None and result[0] == 200
+    
+    def boot(self) -> None:
+        """testServerConnection() then loadInitialResources() in one batch"""
+        self.health()
+        items = [{'id': resource_id, 'priority': priority, 'compress': priority <= COMPRESS_PRIORITY}
+                 for resource_id, priority in BOOT_RESOURCES]
+        body = json.dumps({'resources': items, 'compress': False, 'prefetch': False}).encode()
+        result = self._request('POST /api/resources/batch', 'POST', '/api/resources/batch', body=body,
+                               headers={'Content-Type': 'application/json'})
+        if result is None or result[0] != 200:
+            return
+        
+        # Header lines: <id> <status> <priority> <encoding> <size> <length> <hash> <version> <ttl>
+        data = result[2]
+        position = 0
+        now = time.time()
+        while position < len(data):
+            end = data.find(b'\n', position)
+            if end < 0:
+                break
+            fields = data[position:end].decode(errors='replace').split()
+            position = end + 1
+            if not fields or fields[0] == 'END' or len(fields) < 8:
+                break
+            position += int(fields[5])
+            if fields[1] == '200':
+                self.cached[fields[0]] = [fields[6], int(fields[2]), now]
+    
+    def fetch_data(self) -> None:
+        """A data_* resource over the raw endpoint, compressed for a share of requests"""
+        resource_id = self.random.choice(self.data_ids)
+        compress = self.random.random() < self.args.compress_ratio
+        path = f'/api/resources/{resource_id}/raw' + ('?compress=true' if compress else '')
+        endpoint = 'GET /api/resources/<id>/raw' + ('?compress=true' if compress else '')
+        
+        # A cached copy saves the round trip, as handleButtonA() does
+        if resource_id in self.cached and not self.args.no_cache:
+            self.hits += 1
+            return
+        self.misses += 1
+        
+        start = time.perf_counter()
+        result = self._request(endpoint, 'GET', path)
+        self.fetch_latencies.append(int((time.perf_counter() - start) * 1000))
+        if result is not None and result[0] == 200:
+            self.cached[resource_id] = [result[1].getheader('X-Resource-Hash', ''),
+                                        self.data_resources[resource_id], time.time()]
+    
+    def revalidate_stale(self) -> None:
+        """revalidateStaleResources(): If-None-Match on the oldest entries"""
+        now = time.time()
+        stale = sorted((entry[2], resource_id) for resource_id, entry in self.cached.items()
+                       if now - entry[2] >= REVALIDATE_INTERVAL and entry[0])
+        for _, resource_id in stale[:REVALIDATE_PER_CHECK]:
+            entry = self.cached[resource_id]
+            headers = {'If-None-Match': f'"{entry[0]}"', 'A-IM': DELTA_ENCODING}
+            compress = '?compress=true' if entry[1] <= COMPRESS_PRIORITY else ''
+            result = self._request('GET /api/resources/<id>/raw (revalidate)', 'GET',
+                                   f'/api/resources/{resource_id}/raw{compress}', headers=headers,
+                                   expected=(200, 226, 304))
+            if result is None:
+                continue
+            if result[0] == 404:
+                del self.cached[resource_id]
+                continue
+            if result[0] in (200, 226):
+                entry[0] = result[1].getheader('X-Resource-Hash', entry[0])
+            entry[2] = now
+    
+    def push_telemetry(self) -> None:
+        """A report in the client's format, with the fetch latencies this device saw"""
+        buckets = [0] * TELEMETRY_BUCKETS
+        for latency in self.fetch_latencies:
+            buckets[histogram_bucket(latency)] += 1
+        while buckets and buckets[-1] == 0:
+            buckets.pop()
+        report = {
+            'device': self.device,
+            'uptime': int((time.time() - self.stats.started) * 1000),
+            'hits': self.hits,
+            'misses': self.misses,
+            'failed': 0,
+            'interval': TELEMETRY_INTERVAL * 1000,
+            'evictions': [0] * 4,
+            'histograms': {
+                'fetch_total': {
+                    'unit': 'ms',
+                    'count': len(self.fetch_latencies),
+                    'sum': sum(self.fetch_latencies),
+                    'max': max(self.fetch_latencies, default=0),
+                    'buckets': buckets
+                }
+            }
+        }
+        result = self._request('POST /api/telemetry', 'POST', '/api/telemetry', body=json.dumps(report).encode(),
+                               headers={'Content-Type': 'application/json'})
+        if result is not None and result[0] == 200:
+            self.fetch_latencies = []
+    
+    def run(self):
+        # Devices power up over the ramp instead of all at once
+        if self.stop.wait(self.random.uniform(0, self.args.ramp)):
+            return
+        self.boot()
+        
+        now = time.time()
+        next_health = now + HEALTH_INTERVAL
+        next_telemetry = now + self.random.uniform(0, TELEMETRY_INTERVAL)
+        next_fetch = now + self.random.expovariate(1.0 / self.args.fetch_interval)
+        
+        while not self.stop.is_set():
+            due = min(next_health, next_telemetry, next_fetch)
+            if self.stop.wait(max(0, due - time.time())):
+                break
+            
+            now = time.time()
+            if now >= next_health:
+                if self.health():
+                    self.revalidate_stale()
+                next_health = now + HEALTH_INTERVAL
+            if now >= next_fetch:
+                self.fetch_data()
+                next_fetch = now + self.random.expovariate(1.0 / self.args.fetch_interval)
+            if now >= next_telemetry:
+                self.push_telemetry()
+                next_telemetry = now + TELEMETRY_INTERVAL
+        
+        self._close()
+
+def api_request(args, method: str, path: str, body: Optional[dict] = None):
+    """One-off request outside the measured load; returns (status, parsed JSON or None)"""
+    connection = http.client.HTTPConnection(args.host, args.port, timeout=REQUEST_TIMEOUT)
+    try:
+        payload = json.dumps(body).encode() if body is not None else None
+        headers = {'Content-Type': 'application/json'} if body is not None else {}
+        connection.request(method, path, body=payload, headers=headers)
+        response = connection.getresponse()
+        data = response.read()
+        try:
+            return response.status, json.loads(data)
+        except ValueError:
+            return response.status, None
+    finally:
+        connection.close()
+
+def seed_data(args) -> None:
+    """Upload data_load_* resources so fetches spread over more than data_sample"""
+    generator = random.Random(args.seed)
+    for index in range(args.seed_data):
+        size = generator.randint(512, 8192)
+        content = ''.join(generator.choice('0123456789abcdef,\n') for _ in range(size))
+        status, _ = api_request(args, 'POST', '/api/resources', {
+            'resource_id': f'data_load_{index}', 'content': content, 'category': 'data', 'priority': 4
+        })
+        if status != 201:
+            raise RuntimeError(f'Upload of data_load_{index} failed with HTTP {status}')
+
+def list_data_resources(args) -> Dict[str, int]:
+    """Priority of every data_* resource, through all listing pages"""
+    resources = {}
+    page = 1
+    while True:
+        status, listing = api_request(args, 'GET', f'/api/resources?page={page}&per_page={LISTING_PAGE_SIZE}')
+        if status != 200 or listing is None:
+            raise RuntimeError(f'Listing resources failed with HTTP {status}')
+        for resource in listing.get('resources', []):
+            if resource.get('resource_id', '').startswith('data_'):
+                resources[resource['resource_id']] = int(resource.get('priority', 3))
+        if len(listing.get('resources', [])) < LISTING_PAGE_SIZE:
+            return resources
+        page += 1
+
+def print_report(summary: Dict[str, dict], elapsed: float, devices: int) -> None:
+    header = f"{'Endpoint':<46} {'Requests':>9} {'Errors':>7} {'RPS':>8} {'Mean':>8} "
+    header += ' '.join(f"{'p' + str(percent):>8}" for percent in PERCENTILES) + f" {'Max':>8}"
+    print(f"\n{devices} devices for {elapsed:.0f}s, latency in ms")
+    print(header)
+    print('-' * len(header))
+    
+    total_requests = total_errors = 0
+    for name, entry in summary.items():
+        total_requests += entry['requests']
+        total_errors += entry['errors']
+        line = f"{name:<46} {entry['requests']:>9} {entry['errors']:>7} {entry['rps']:>8.1f} {entry['mean']:>8.1f} "
+        line += ' '.join(f"{entry[f'p{percent}']:>8.1f}" for percent in PERCENTILES) + f" {entry['max']:>8.1f}"
+        print(line)
+        failures = {status: count for status, count in entry['statuses'].items()
+                    if status not in ('200', '226', '304')}
+        if failures:
+            print(f"{'':<4}statuses: " + ', '.join(f"{status}={count}" for status, count in failures.items())
+                  + "  (0 = connection error or timeout)")
+    
+    print('-' * len(header))
+    throughput = total_requests / elapsed if elapsed > 0 else 0
+    print(f"{'Total':<46} {total_requests:>9} {total_errors:>7} {throughput:>8.1f}")
+
+def main():
+    parser = argparse.ArgumentParser(description='Simulate a fleet of VRAM clients against one server')
+    parser.add_argument('--server', default='http://localhost:5000', help='Server base URL')
+    parser.add_argument('--devices', type=int, default=50, help='Virtual devices, one thread each')
+    parser.add_argument('--duration', type=float, default=60, help='Seconds of load after the ramp starts')
+    parser.add_argument('--ramp', type=float, default=10, help='Seconds over which devices boot')
+    parser.add_argument('--fetch-interval', type=float, default=5,
+                        help='Mean seconds between data_* fetches per device')
+    parser.add_argument('--compress-ratio', type=float, default=0.5,
+                        help='Share of data_* fetches sent with compress=true')
+    parser.add_argument('--no-cache', action='store_true',
+                        help='Fetch data_* resources even when the device already holds them')
+    parser.add_argument('--seed-data', type=int, default=0, metavar='N',
+                        help='Upload N data_load_* resources before starting')
+    parser.add_argument('--seed', type=int, default=1, help='Random seed for device behaviour')
+    parser.add_argument('--json', metavar='FILE', help='Also write the report as JSON')
+    args = parser.parse_args()
+    
+    url = urlsplit(args.server)
+    if url.scheme != 'http' or not url.hostname:
+        parser.error('--server must be an http:// URL')
+    args.host = url.hostname
+    args.port = url.port or 80
+    if args.devices < 1 or args.fetch_interval <= 0:
+        parser.error('--devices and --fetch-interval must be positive')
+    
+    try:
+        if args.seed_data:
+            seed_data(args)
+        data_resources = list_data_resources(args)
+    except (OSError, RuntimeError) as e:
+        print(f"Cannot prepare the server at {args.server}: {e}", file=sys.stderr)
+        return 1
+    
+    if not data_resources:
+        print(f"No data_* resources on {args.server}; try --seed-data", file=sys.stderr)
+        return 1
+    
+    print(f"Starting {args.devices} devices against {args.server} ({len(data_resources)} data resources)")
+    stats = LoadStats()
+    stop = threading.Event()
+    devices = [VirtualDevice(index, args, stats, data_resources, stop) for index in range(args.devices)]
+    for device in devices:
+        device.start()
+    
+    try:
+        deadline = stats.started + args.duration
+        while not stop.wait(min(PROGRESS_INTERVAL, max(0, deadline - time.time()))):
+            elapsed = time.time() - stats.started
+            requests, errors = stats.totals()
+            print(f"[{elapsed:5.0f}s] {requests} requests, {requests / elapsed:.1f}/s, {errors} errors", flush=True)
+            if time.time() >= deadline:
+                break
+    except KeyboardInterrupt:
+        pass
+    stop.set()
+    for device in devices:
+        device.join(REQUEST_TIMEOUT)
+    
+    elapsed = time.time() - stats.started
+    summary = stats.summary(elapsed)
+    print_report(summary, elapsed, args.devices)
+    
+    if args.json:
+        with open(args.json, 'w') as f:
+            json.dump({'server': args.server, 'devices': args.devices, 'duration': round(elapsed, 1),
+                       'endpoints': summary}, f, indent=2)
+    
+    requests, errors = stats.totals()
+    return 0 if requests and errors == 0 else 2
+
+if __name__ == '__main__':
+    sys.exit(main())
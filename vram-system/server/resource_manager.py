@@ -9,18 +9,45 @@ import json
 import hashlib
 import shutil
 import logging
+import threading
+import atexit
+from collections import deque, OrderedDict
 from datetime import datetime, timedelta
 from typing import Dict, List, Optional, Any
 import pickle
 import gzip
 
+CO_ACCESS_WINDOW = 300           # Seconds within which the next access counts as a follow-up
+CO_ACCESS_HISTORY_LINES = 10000  # Access log lines mined at startup
+DELTA_HISTORY = 4                # Previous versions kept per resource as delta bases
+DELTA_MAX_SIZE = 64 * 1024       # Largest version diffed; the client's MAX_RESOURCE_SIZE
+DELTA_MAX_RATIO = 0.5            # Send the whole resource unless the delta is this much smaller
+DELTA_BLOCK_SIZE = 16            # Bytes per indexed block; shorter matches go as literals
+DELTA_CACHE_ENTRIES = 64         # Encoded deltas kept for fleet-wide pushes
+HOT_CACHE_BYTES = 16 * 1024 * 1024  # Resource bytes and gzip variants kept in memory
+HOT_CACHE_MAX_ITEM = HOT_CACHE_BYTES // 8  # Larger resources are always read from disk
+FLUSH_INTERVAL = 5               # Seconds between writes of buffered access updates
+
+# Delta format, applied by the client's resource_delta.h:
+#   'V' 'D' 1, varint base length, varint target length, then operations
+#   1 varint offset varint length   copy bytes of the base version
+#   2 varint length bytes           insert literal bytes
+DELTA_MAGIC = b'VD\x01'
+DELTA_OP_COPY = 1
+DELTA_OP_INSERT = 2
+
 class ResourceManager:
     """
     Manages resources for the VRAM system including:
     - Resource storage and retrieval
-    - Version management
+    - Version management, with binary deltas against recent versions
     - Usage tracking and optimization
+    - Co-access mining for prefetch hints
     - LRU-based cleanup
+    - In-memory LRU of hot resource bytes and their gzip variants
+    
+    Access counts and access log lines are buffered and written every
+    FLUSH_INTERVAL seconds; uploads and deletes are saved at once.
     """
     
     def __init__(self, resource_dir: str):
@@ -33,6 +60,34 @@ class ResourceManager:
         
         # Load or create metadata
         self.metadata = self._load_metadata()
+        self.metadata_lock = threading.RLock()
+        self.metadata_dirty = False
+        
+        # Access log lines waiting for the next flush
+        self.pending_log = []
+        self.log_lock = threading.Lock()
+        
+        # Follow-up counts: resource id -> {next resource id: count}
+        self.transitions = {}
+        self.last_access = {}  # client ip -> (resource id, time)
+        self.co_access_lock = threading.Lock()
+        self._load_access_history()
+        
+        # (base hash, target hash) -> encoded delta, or None if not worth sending
+        self.delta_cache = OrderedDict()
+        self.delta_lock = threading.Lock()
+        
+        # Content hash -> [bytes, gzip bytes or None], least recently used first.
+        # Keyed by hash, so a new version never hits a stale entry.
+        self.hot_cache = OrderedDict()
+        self.hot_cache_bytes = 0
+        self.hot_hits = 0
+        self.hot_misses = 0
+        self.hot_lock = threading.Lock()
+        
+        self.flush_stop = threading.Event()
+        threading.Thread(target=self._flush_loop, name='resource-flush', daemon=True).start()
+        atexit.register(self.flush)
         
         logging.info(f"ResourceManager initialized with directory: {self.resource_dir}")
     
@@ -53,23 +108,110 @@ class ResourceManager:
         }
     
     def _save_metadata(self):
-        """Save metadata to file"""
+        """Save metadata to file, replacing it atomically"""
         try:
-            self.metadata['last_updated'] = datetime.now().isoformat()
-            with open(self.metadata_file, 'w') as f:
-                json.dump(self.metadata, f, indent=2)
+            with self.metadata_lock:
+                self.metadata['last_updated'] = datetime.now().isoformat()
+                content = json.dumps(self.metadata, indent=2)
+                self.metadata_dirty = False
+            
+            temp_file = self.metadata_file + '.tmp'
+            with open(temp_file, 'w') as f:
+                f.write(content)
+            os.replace(temp_file, self.metadata_file)
         except Exception as e:
             logging.error(f"Error saving metadata: {e}")
     
+    def flush(self):
+        """Write buffered access log lines and access counts"""
+        with self.log_lock:
+            lines, self.pending_log = self.pending_log, []
+        if lines:
+            try:
+                with open(self.access_log_file, 'a') as f:
+                    f.writelines(lines)
+            except Exception as e:
+                logging.error(f"Error writing access log: {e}")
+        
+        if self.metadata_dirty:
+            self._save_metadata()
+    
+    def _flush_loop(self):
+        """Background writer for buffered updates"""
+        while not self.flush_stop.wait(FLUSH_INTERVAL):
+            self.flush()
+    
+    def _hot_get(self, resource_hash: str) -> Optional[list]:
+        """Cached [bytes, gzip bytes or None] for a content hash"""
+        with self.hot_lock:
+            entry = self.hot_cache.get(resource_hash)
+            if entry is None:
+                self.hot_misses += 1
+                return None
+            self.hot_cache.move_to_end(resource_hash)
+            self.hot_hits += 1
+            return entry
+    
+    def _hot_put(self, resource_hash: str, data: bytes, compressed: Optional[bytes] = None):
+        """Cache bytes for a content hash, evicting least recently used entries"""
+        if len(data) > HOT_CACHE_MAX_ITEM:
+            return
+        
+        with self.hot_lock:
+            self._hot_remove(resource_hash)
+            self.hot_cache[resource_hash] = [data, compressed]
+            self.hot_cache_bytes += len(data) + len(compressed or b'')
+            while self.hot_cache_bytes > HOT_CACHE_BYTES:
+                _, (old_data, old_compressed) = self.hot_cache.popitem(last=False)
+                self.hot_cache_bytes -= len(old_data) + len(old_compressed or b'')
+    
+    def _hot_remove(self, resource_hash: Optional[str]):
+        """Drop a content hash from the cache; hot_lock must be held"""
+        entry = self.hot_cache.pop(resource_hash, None)
+        if entry is not None:
+            self.hot_cache_bytes -= len(entry[0]) + len(entry[1] or b'')
+    
+    def _hot_drop(self, resource_hash: Optional[str]):
+        """Invalidate the cached bytes of a replaced or deleted version"""
+        with self.hot_lock:
+            self._hot_remove(resource_hash)
+    
+    def _read_bytes(self, resource_id: str) -> Optional[bytes]:
+        """Current bytes of a resource, from memory if hot"""
+        resource_meta = self.metadata['resources'].get(resource_id)
+        if not resource_meta:
+            return None
+        
+        entry = self._hot_get(resource_meta.get('hash'))
+        if entry is not None:
+            return entry[0]
+        
+        file_path = self._get_file_path(resource_id)
+        if not os.path.exists(file_path):
+            return None
+        
+        with open(file_path, 'rb') as f:
+            data = f.read()
+        
+        # A file replaced behind our back is served but not cached
+        if self._calculate_hash(data) == resource_meta.get('hash'):
+            self._hot_put(resource_meta['hash'], data)
+        return data
+    
     def _get_file_path(self, resource_id: str) -> str:
         """Get the file path for a resource"""
         return os.path.join(self.resource_dir, f"{resource_id}.dat")
     
+    def _get_history_path(self, resource_id: str, resource_hash: str) -> str:
+        """Get the file path for a previous version of a resource"""
+        return os.path.join(self.resource_dir, 'history', f"{resource_id}.{resource_hash[:16]}.dat")
+    
     def _calculate_hash(self, data: bytes) -> str:
         """Calculate SHA256 hash of data"""
         return hashlib.sha256(data).hexdigest()
     
-    def store_resource(self, resource_id: str, content: Any, category: str = 'general', priority: int = 1) -> bool:
+    def store_resource(self, resource_id: str, content: Any, category: str = 'general', priority: int = 1,
+                       ttl: int = 0) -> bool:
         """
         Store a resource with metadata
         
@@ -78,6 +220,7 @@ class ResourceManager:
             content: Resource content (string, bytes, or object)
             category: Resource category for organization
             priority: Priority level (1=critical, 2=important, 3=normal, 4=low)
+            ttl: Seconds a client may keep its copy after loading or revalidating it, 0 for no limit
         
         Returns:
             bool: True if successful, False otherwise
@@ -92,22 +235,40 @@ class ResourceManager:
                 # Serialize objects
                 data = pickle.dumps(content)
             
-            # Store the file
+            data_hash = self._calculate_hash(data)
             file_path = self._get_file_path(resource_id)
+            previous = self.metadata['resources'].get(resource_id)
+            version = 1
+            history = []
+            
+            if previous:
+                version = previous.get('version', 1)
+                history = previous.get('history', [])
+                if previous.get('hash') != data_hash:
+                    version += 1
+                    history = self._keep_previous_version(resource_id, previous, history)
+            
+            # Store the file
             with open(file_path, 'wb') as f:
                 f.write(data)
             
+            if previous and previous.get('hash') != data_hash:
+                self._hot_drop(previous.get('hash'))
+            
             # Update metadata
-            self.metadata['resources'][resource_id] = {
-                'size': len(data),
-                'hash': self._calculate_hash(data),
-                'category': category,
-                'priority': priority,
-                'created': datetime.now().isoformat(),
-                'last_accessed': datetime.now().isoformat(),
-                'access_count': 0,
-                'version': 1
-            }
+            with self.metadata_lock:
+                self.metadata['resources'][resource_id] = {
+                    'size': len(data),
+                    'hash': data_hash,
+                    'category': category,
+                    'priority': priority,
+                    'created': datetime.now().isoformat(),
+                    'last_accessed': datetime.now().isoformat(),
+                    'access_count': 0,
+                    'version': version,
+                    'ttl': max(0, int(ttl)),
+                    'history': history
+                }
             
             self._save_metadata()
             logging.info(f"Stored resource {resource_id} ({len(data)} bytes)")
@@ -117,6 +278,47 @@ class ResourceManager:
             logging.error(f"Error storing resource {resource_id}: {e}")
             return False
     
+    def _keep_previous_version(self, resource_id: str, previous: Dict[str, Any],
+                               history: List[Dict[str, Any]]) -> List[Dict[str, Any]]:
+        """
+        Move the stored version into the history before it is overwritten
+        
+        Returns:
+            The history entries still kept, newest first
+        """
+        file_path = self._get_file_path(resource_id)
+        if not os.path.exists(file_path) or not previous.get('hash'):
+            return history
+        
+        if previous.get('size', 0) <= DELTA_MAX_SIZE:
+            history_path = self._get_history_path(resource_id, previous['hash'])
+            os.makedirs(os.path.dirname(history_path), exist_ok=True)
+            shutil.copyfile(file_path, history_path)
+            history = [{
+                'hash': previous['hash'],
+                'version': previous.get('version', 1),
+                'size': previous.get('size', 0)
+            }] + [entry for entry in history if entry['hash'] != previous['hash']]
+        
+        for entry in history[DELTA_HISTORY:]:
+            self._remove_history_file(resource_id, entry['hash'])
+        return history[:DELTA_HISTORY]
+    
+    def _remove_history_file(self, resource_id: str, resource_hash: str):
+        """Delete one previous version, if it is still on disk"""
+        history_path = self._get_history_path(resource_id, resource_hash)
+        if os.path.exists(history_path):
+            os.remove(history_path)
+    
+    def _record_access(self, resource_id: str):
+        """Update access information; written by the next flush"""
+        with self.metadata_lock:
+            resource_meta = self.metadata['resources'].get(resource_id)
+            if resource_meta:
+                resource_meta['last_accessed'] = datetime.now().isoformat()
+                resource_meta['access_count'] = resource_meta.get('access_count', 0) + 1
+                self.metadata_dirty = True
+    
     def get_resource(self, resource_id: str) -> Optional[bytes]:
         """
         Retrieve a resource by ID
@@ -131,27 +333,49 @@ class ResourceManager:
             if resource_id not in self.metadata['resources']:
                 return None
             
-            file_path = self._get_file_path(resource_id)
-            if not os.path.exists(file_path):
+            data = self._read_bytes(resource_id)
+            if data is None:
                 # Clean up orphaned metadata
-                del self.metadata['resources'][resource_id]
+                with self.metadata_lock:
+                    self.metadata['resources'].pop(resource_id, None)
                 self._save_metadata()
                 return None
             
-            with open(file_path, 'rb') as f:
-                data = f.read()
-            
-            # Update access information
-            self.metadata['resources'][resource_id]['last_accessed'] = datetime.now().isoformat()
-            self.metadata['resources'][resource_id]['access_count'] += 1
-            self._save_metadata()
-            
+            self._record_access(resource_id)
             return data
             
         except Exception as e:
             logging.error(f"Error retrieving resource {resource_id}: {e}")
             return None
     
+    def get_compressed(self, resource_id: str) -> Optional[bytes]:
+        """
+        Gzip variant of the current version, compressed once per version
+        Does not count as an access; pair it with get_resource()
+        
+        Args:
+            resource_id: The resource identifier
+            
+        Returns:
+            bytes: Gzip data or None if not found
+        """
+        resource_meta = self.metadata['resources'].get(resource_id)
+        if not resource_meta:
+            return None
+        
+        entry = self._hot_get(resource_meta.get('hash'))
+        if entry is not None and entry[1] is not None:
+            return entry[1]
+        
+        data = entry[0] if entry is not None else self._read_bytes(resource_id)
+        if data is None:
+            return None
+        
+        compressed = gzip.compress(data)
+        if self._calculate_hash(data) == resource_meta.get('hash'):
+            self._hot_put(resource_meta['hash'], data, compressed)
+        return compressed
+    
     def delete_resource(self, resource_id: str) -> bool:
         """
         Delete a resource
@@ -170,7 +394,13 @@ class ResourceManager:
             if os.path.exists(file_path):
                 os.remove(file_path)
             
-            del self.metadata['resources'][resource_id]
+            resource_meta = self.metadata['resources'][resource_id]
+            for entry in resource_meta.get('history', []):
+                self._remove_history_file(resource_id, entry['hash'])
+            self._hot_drop(resource_meta.get('hash'))
+            
+            with self.metadata_lock:
+                del self.metadata['resources'][resource_id]
             self._save_metadata()
             
             logging.info(f"Deleted resource {resource_id}")
@@ -248,20 +478,198 @@ class ResourceManager:
             'hash': resource_meta.get('hash'),
             'size': resource_meta.get('size', 0),
             'last_modified': resource_meta.get('created'),
-            'priority': resource_meta.get('priority', 3)
+            'priority': resource_meta.get('priority', 3),
+            'ttl': resource_meta.get('ttl', 0)
         }
     
+    def get_delta(self, resource_id: str, base_hash: str) -> Optional[bytes]:
+        """
+        Binary delta from a previous version to the current one
+        
+        Args:
+            resource_id: The resource identifier
+            base_hash: Hash of the version the client holds
+            
+        Returns:
+            bytes: Encoded delta, or None if the base is unknown or the
+            delta would not save enough over the whole resource
+        """
+        resource_meta = self.metadata['resources'].get(resource_id)
+        if not resource_meta or resource_meta.get('size', 0) > DELTA_MAX_SIZE:
+            return None
+        
+        if not any(entry['hash'] == base_hash for entry in resource_meta.get('history', [])):
+            return None
+        
+        target_hash = resource_meta['hash']
+        key = (base_hash, target_hash)
+        with self.delta_lock:
+            known = key in self.delta_cache
+            if known:
+                self.delta_cache.move_to_end(key)
+                delta = self.delta_cache[key]
+        
+        if not known:
+            try:
+                with open(self._get_history_path(resource_id, base_hash), 'rb') as f:
+                    base = f.read()
+                target = self._read_bytes(resource_id)
+            except OSError as e:
+                logging.error(f"Error reading versions of {resource_id}: {e}")
+                return None
+            
+            if target is None or self._calculate_hash(target) != target_hash:
+                return None  # Replaced while we were reading
+            
+            delta = self._encode_delta(base, target)
+            if len(delta) > len(target) * DELTA_MAX_RATIO:
+                delta = None
+            
+            with self.delta_lock:
+                self.delta_cache[key] = delta
+                if len(self.delta_cache) > DELTA_CACHE_ENTRIES:
+                    self.delta_cache.popitem(last=False)
+        
+        if delta is not None:
+            self._record_access(resource_id)
+        return delta
+    
+    @staticmethod
+    def _encode_varint(value: int) -> bytes:
+        """LEB128: seven bits per byte, low bits first"""
+        out = bytearray()
+        while True:
+            byte = value & 0x7F
+            value >>= 7
+            if value:
+                out.append(byte | 0x80)
+            else:
+                out.append(byte)
+                return bytes(out)
+    
+    def _encode_delta(self, base: bytes, target: bytes) -> bytes:
+        """
+        Copy and insert operations that rebuild target from base
+        Base blocks are indexed at aligned offsets and looked up at every
+        target offset, so edits that shift the rest of the file still match
+        """
+        out = bytearray(DELTA_MAGIC)
+        out += self._encode_varint(len(base))
+        out += self._encode_varint(len(target))
+        
+        blocks = {}
+        for offset in range(0, len(base) - DELTA_BLOCK_SIZE + 1, DELTA_BLOCK_SIZE):
+            blocks.setdefault(base[offset:offset + DELTA_BLOCK_SIZE], offset)
+        
+        literal_start = 0
+        position = 0
+        while position + DELTA_BLOCK_SIZE <= len(target):
+            offset = blocks.get(target[position:position + DELTA_BLOCK_SIZE])
+            if offset is None:
+                position += 1
+                continue
+            
+            # Grow the match both ways; backwards only into the pending literal
+            start, source = position, offset
+            while start > literal_start and source > 0 and target[start - 1] == base[source - 1]:
+                start -= 1
+                source -= 1
+            end = position + DELTA_BLOCK_SIZE
+            while end < len(target) and offset + end - position < len(base) and \
+                    target[end] == base[offset + end - position]:
+                end += 1
+            
+            self._encode_insert(out, target[literal_start:start])
+            out.append(DELTA_OP_COPY)
+            out += self._encode_varint(source)
+            out += self._encode_varint(end - start)
+            literal_start = position = end
+        
+        self._encode_insert(out, target[literal_start:])
+        return bytes(out)
+    
+    def _encode_insert(self, out: bytearray, literal: bytes):
+        """Append an insert operation for literal, if there is one"""
+        if literal:
+            out.append(DELTA_OP_INSERT)
+            out += self._encode_varint(len(literal))
+            out += literal
+    
+    def _record_transition(self, resource_id: str, client_ip: str, when: datetime):
+        """Count resource_id as a follow-up of the client's previous access"""
+        with self.co_access_lock:
+            previous = self.last_access.get(client_ip)
+            self.last_access[client_ip] = (resource_id, when)
+            if not previous:
+                return
+            
+            previous_id, previous_time = previous
+            if previous_id == resource_id or (when - previous_time).total_seconds() > CO_ACCESS_WINDOW:
+                return
+            
+            followers = self.transitions.setdefault(previous_id, {})
+            followers[resource_id] = followers.get(resource_id, 0) + 1
+    
+    def _load_access_history(self):
+        """Mine co-access sequences from the tail of the access log"""
+        if not os.path.exists(self.access_log_file):
+            return
+        
+        try:
+            with open(self.access_log_file, 'r') as f:
+                lines = deque(f, maxlen=CO_ACCESS_HISTORY_LINES)
+            
+            for line in lines:
+                try:
+                    entry = json.loads(line)
+                    when = datetime.fromisoformat(entry['timestamp'])
+                except (ValueError, KeyError):
+                    continue
+                self._record_transition(entry['resource_id'], entry.get('client_ip', 'unknown'), when)
+            
+            logging.info(f"Mined {len(lines)} access log entries for prefetch hints")
+        except Exception as e:
+            logging.error(f"Error loading access history: {e}")
+    
+    def get_prefetch_hints(self, resource_id: str, limit: int = 3, min_count: int = 2) -> List[Dict[str, Any]]:
+        """Resources most often requested next after resource_id"""
+        with self.co_access_lock:
+            followers = dict(self.transitions.get(resource_id, {}))
+        
+        total = sum(followers.values())
+        hints = []
+        for next_id, count in sorted(followers.items(), key=lambda item: item[1], reverse=True):
+            if count < min_count or len(hints) >= limit:
+                break
+            
+            meta = self.metadata['resources'].get(next_id)
+            if not meta:
+                continue  # Deleted since it was logged
+            
+            hints.append({
+                'id': next_id,
+                'score': round(count / total, 3),
+                'count': count,
+                'size': meta.get('size', 0),
+                'priority': meta.get('priority', 3)
+            })
+        
+        return hints
+    
     def log_access(self, resource_id: str, client_ip: str = 'unknown'):
-        """Log resource access for analytics"""
+        """Log resource access for analytics; appended by the next flush"""
         try:
+            now = datetime.now()
+            self._record_transition(resource_id, client_ip, now)
+            
             log_entry = {
-                'timestamp': datetime.now().isoformat(),
+                'timestamp': now.isoformat(),
                 'resource_id': resource_id,
                 'client_ip': client_ip
             }
             
-            with open(self.access_log_file, 'a') as f:
-                f.write(json.dumps(log_entry) + '\n')
+            with self.log_lock:
+                self.pending_log.append(json.dumps(log_entry) + '\n')
                 
         except Exception as e:
             logging.error(f"Error logging access: {e}")
@@ -293,9 +701,23 @@ class ResourceManager:
             'total_size_mb': round(total_size / (1024 * 1024), 2),
             'categories': categories,
             'most_accessed': most_accessed,
-            'disk_usage': self._get_disk_usage()
+            'disk_usage': self._get_disk_usage(),
+            'hot_cache': self.get_hot_cache_stats()
         }
     
+    def get_hot_cache_stats(self) -> Dict[str, Any]:
+        """Get in-memory cache statistics"""
+        with self.hot_lock:
+            lookups = self.hot_hits + self.hot_misses
+            return {
+                'entries': len(self.hot_cache),
+                'bytes': self.hot_cache_bytes,
+                'max_bytes': HOT_CACHE_BYTES,
+                'hits': self.hot_hits,
+                'misses': self.hot_misses,
+                'hit_rate': round(self.hot_hits / lookups, 3) if lookups else 0
+            }
+    
     def _get_disk_usage(self) -> Dict[str, int]:
         """Get disk usage information"""
         try:
@@ -404,7 +826,8 @@ class ResourceManager:
                     'id': 'data_sample',
                     'content': 'Sample data for testing purposes. This could be a larger dataset.',
                     'category': 'data',
-                    'priority': 3
+                    'priority': 3,
+                    'ttl': 600
                 },
                 {
                     'id': 'ui_strings',
@@ -420,7 +843,8 @@ class ResourceManager:
                         resource['id'],
                         resource['content'],
                         resource['category'],
-                        resource['priority']
+                        resource['priority'],
+                        resource.get('ttl', 0)
                     )
             
             logging.info("Demo resources created")
@@ -0,0 +1,167 @@
+#!/usr/bin/env python3
+"""
+VRAM System - Sensor Store
+Decodes packed sample batches uploaded by sensor nodes and keeps the recent samples per device
+"""
+
+import threading
+import time
+from collections import deque
+from typing import Dict, List, Optional, Tuple, Any
+
+SENSOR_PACK_VERSION = 1          # The client's SENSOR_PACK_VERSION
+SENSOR_MAX_BATCH = 4096          # Samples accepted in one upload
+SENSOR_SAMPLES_PER_DEVICE = 4096 # Recent samples kept per device
+SENSOR_MAX_DEVICES = 1024
+
+class SensorFormatError(ValueError):
+    """A batch that does not decode"""
+
+def read_varint(data: bytes, position: int) -> Tuple[int, int]:
+    """LEB128 varint at position; returns (value, next position)"""
+    value = 0
+    shift = 0
+    while True:
+        if position >= len(data):
+            raise SensorFormatError('Truncated varint')
+        byte = data[position]
+        position += 1
+        value |= (byte & 0x7F) << shift
+        if not byte & 0x80:
+            return value, position
+        shift += 7
+        if shift > 35:
+            raise SensorFormatError('Varint longer than 32 bits')
+
+def unzigzag(value: int) -> int:
+    return (value >> 1) ^ -(value & 1)
+
+def decode_samples(data: bytes, received: float) -> Tuple[int, List[Dict[str, Any]]]:
+    """
+    Decode a batch as packed by the client's SensorRing::pack()
+    Returns the sequence number of the first sample and the samples, each
+    with its sequence, its offset in ms from the first sample and a
+    wall-clock time derived from the age of the first sample at packing time
+    """
+    if not data or data[0] != SENSOR_PACK_VERSION:
+        raise SensorFormatError(f'Unsupported batch version, expected {SENSOR_PACK_VERSION}')
+    
+    count, position = read_varint(data, 1)
+    if count > SENSOR_MAX_BATCH:
+        raise SensorFormatError(f'At most {SENSOR_MAX_BATCH} samples per batch')
+    sequence, position = read_varint(data, position)
+    age, position = read_varint(data, position)
+    
+    samples = []
+    temperature = humidity = battery = 0
+    offset = 0  # ms after the first sample
+    for index in range(count):
+        delta, position = read_varint(data, position)
+        offset += delta
+        value, position = read_varint(data, position)
+        temperature += unzigzag(value)
+        value, position = read_varint(data, position)
+        humidity += unzigzag(value)
+        value, position = read_varint(data, position)
+        battery += unzigzag(value)
+        samples.append({
+            'sequence': sequence + index,
+            'offset': offset,
+            'time': round(received - (age - offset) / 1000, 3),
+            'temperature': temperature / 10,
+            'humidity': humidity / 10,
+            'battery': battery
+        })
+    
+    if position != len(data):
+        raise SensorFormatError(f'{len(data) - position} bytes after the last sample')
+    return sequence, samples
+
+class SensorStore:
+    """
+    Samples arrive oldest first with consecutive sequence numbers. A node
+    drops its samples only after a 200, so an upload whose response was
+    lost comes again; samples below the next expected sequence number are
+    skipped rather than stored twice. Sequence numbers restart at every
+    boot, so each upload carries the node's boot id and a new one resets
+    the expected number. Nodes that send no boot id fall back to treating
+    a batch that starts before the previous one as a restart.
+    """
+    
+    def __init__(self):
+        self.lock = threading.Lock()
+        self.devices = {}   # device -> {'samples', 'next_sequence', 'boot', 'batch_start', 'received', 'uploads', 'bytes', 'stored', 'duplicates'}
+        self.uploads = 0
+        self.samples = 0
+    
+    def record(self, device: str, data: bytes, boot: Optional[str] = None) -> Dict[str, Any]:
+        """Decode and store a batch; raises SensorFormatError if it does not decode"""
+        received = time.time()
+        sequence, samples = decode_samples(data, received)
+        
+        with self.lock:
+            entry = self.devices.get(device)
+            if entry is None:
+                if len(self.devices) >= SENSOR_MAX_DEVICES:
+                    oldest = min(self.devices, key=lambda key: self.devices[key]['received'])
+                    del self.devices[oldest]
+                entry = {
+                    'samples': deque(maxlen=SENSOR_SAMPLES_PER_DEVICE),
+                    'next_sequence': 0,
+                    'boot': boot,
+                    'batch_start': 0,
+                    'received': received,
+                    'uploads': 0,
+                    'bytes': 0,
+                    'stored': 0,
+                    'duplicates': 0
+                }
+                self.devices[device] = entry
+            
+            if boot is not None and entry['boot'] is not None:
+                restarted = boot != entry['boot']
+            else:
+                restarted = sequence < entry['batch_start']
+            if restarted:
+                entry['next_sequence'] = 0
+            if boot is not None:
+                entry['boot'] = boot
+            entry['batch_start'] = sequence
+            
+            fresh = [sample for sample in samples if sample['sequence'] >= entry['next_sequence']]
+            entry['samples'].extend(fresh)
+            entry['duplicates'] += len(samples) - len(fresh)
+            if samples:
+                entry['next_sequence'] = max(entry['next_sequence'], samples[-1]['sequence'] + 1)
+            entry['received'] = received
+            entry['uploads'] += 1
+            entry['bytes'] += len(data)
+            entry['stored'] += len(fresh)
+            self.uploads += 1
+            self.samples += len(fresh)
+            
+            return {'accepted': len(fresh), 'duplicates': len(samples) - len(fresh),
+                    'next_sequence': entry['next_sequence']}
+    
+    def get_summary(self) -> Dict[str, Any]:
+        """Upload totals and the devices seen"""
+        with self.lock:
+            devices = {}
+            for device, entry in sorted(self.devices.items()):
+                devices[device] = {
+                    'samples': len(entry['samples']),
+                    'uploads': entry['uploads'],
+                    'bytes_per_sample': round(entry['bytes'] / max(1, entry['stored'] + entry['duplicates']), 2),
+                    'duplicates': entry['duplicates'],
+                    'last_upload': entry['received']
+                }
+            return {'uploads': self.uploads, 'samples': self.samples, 'devices': devices}
+    
+    def get_samples(self, device: str, limit: int) -> Optional[List[Dict[str, Any]]]:
+        """Most recent samples of one device, oldest first"""
+        with self.lock:
+            entry = self.devices.get(device)
+            if entry is None:
+                return None
+            samples = list(entry['samples'])
+            return samples[-limit:] if limit > 0 else samples
@@ -22,7 +22,19 @@ fi
 # Create resources directory if it doesn't exist
 mkdir -p resources
 
-# Start the server
+# Start the server; --production serves through gunicorn instead of the
+# Flask development server (settings in gunicorn.conf.py)
+if [ "$1" == "--production" ]; then
+    if ! command -v gunicorn &> /dev/null; then
+        echo "Error: gunicorn is not installed (pip3 install -r requirements.txt)"
+        exit 1
+    fi
+    echo "Starting gunicorn on http://${VRAM_BIND:-0.0.0.0:5000} with ${VRAM_THREADS:-32} threads"
+    echo "Press Ctrl+C to stop the server"
+    echo "================================"
+    exec gunicorn -c gunicorn.conf.py app:app
+fi
+
 echo "Starting Flask server on http://0.0.0.0:5000"
 echo "Press Ctrl+C to stop the server"
 echo "================================"
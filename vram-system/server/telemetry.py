@@ -0,0 +1,170 @@
+#!/usr/bin/env python3
+"""
+VRAM System - Telemetry Store
+Collects histogram reports pushed by clients and merges them into fleet-wide percentiles
+"""
+
+import threading
+import time
+from typing import Dict, List, Optional, Any
+
+TELEMETRY_BUCKETS = 20          # The client's TELEMETRY_BUCKETS: 0, 1, 2-3, 4-7, ... and 2^18 up
+TELEMETRY_PRIORITIES = 4        # Eviction counts for priorities 1-4
+TELEMETRY_MAX_DEVICES = 1024    # Devices whose latest report is kept
+TELEMETRY_DEVICE_TIMEOUT = 300  # Seconds without a report before a device counts as gone
+TELEMETRY_PERCENTILES = (50, 90, 99)
+
+def bucket_limit(bucket: int) -> int:
+    """Largest value a bucket holds; the last one is open-ended"""
+    if bucket <= 0:
+        return 0
+    return (1 << bucket) - 1
+
+def percentile(buckets: List[int], count: int, maximum: int, percent: int) -> int:
+    """
+    Upper bound of the bucket holding the given percentile, capped at the
+    largest value seen, exactly as the client's Histogram::percentile()
+    """
+    if count <= 0:
+        return 0
+    
+    rank = max(1, (count * percent + 99) // 100)
+    seen = 0
+    for bucket, bucket_count in enumerate(buckets):
+        seen += bucket_count
+        if seen >= rank:
+            if bucket >= TELEMETRY_BUCKETS - 1:
+                return maximum
+            return min(bucket_limit(bucket), maximum)
+    return maximum
+
+class TelemetryStore:
+    """
+    Each report carries the samples a device recorded since its previous
+    accepted push, so merging is a sum of bucket counts. Totals run from
+    server start; per-device state is only the latest report.
+    """
+    
+    def __init__(self):
+        self.lock = threading.Lock()
+        self.devices = {}   # device -> {'received', 'reports', 'report'}
+        self.metrics = {}   # name -> {'unit', 'count', 'sum', 'max', 'buckets'}
+        self.evictions = [0] * TELEMETRY_PRIORITIES
+        self.reports = 0
+    
+    @staticmethod
+    def validate(report: Any) -> Optional[str]:
+        """Return an error message for a malformed report, None if it is usable"""
+        if not isinstance(report, dict):
+            return 'Report must be a JSON object'
+        
+        histograms = report.get('histograms', {})
+        if not isinstance(histograms, dict):
+            return 'histograms must be an object'
+        
+        for name, histogram in histograms.items():
+            if not isinstance(histogram, dict):
+                return f'Histogram {name} must be an object'
+            buckets = histogram.get('buckets', [])
+            if (not isinstance(buckets, list) or len(buckets) > TELEMETRY_BUCKETS or
+                    not all(isinstance(value, int) and value >= 0 for value in buckets)):
+                return f'Histogram {name} needs at most {TELEMETRY_BUCKETS} non-negative bucket counts'
+            for field in ('count', 'sum', 'max'):
+                value = histogram.get(field, 0)
+                if not isinstance(value, int) or value < 0:
+                    return f'Histogram {name} field {field} must be a non-negative integer'
+            if sum(buckets) != histogram.get('count', 0):
+                return f'Histogram {name} bucket counts do not add up to its count'
+        
+        evictions = report.get('evictions', [])
+        if (not isinstance(evictions, list) or len(evictions) > TELEMETRY_PRIORITIES or
+                not all(isinstance(value, int) and value >= 0 for value in evictions)):
+            return f'evictions must be at most {TELEMETRY_PRIORITIES} non-negative counts'
+        
+        for field in ('hits', 'misses'):
+            value = report.get(field, 0)
+            if not isinstance(value, int) or value < 0:
+                return f'{field} must be a non-negative integer'
+        
+        return None
+    
+    def record(self, report: Dict[str, Any], device: str) -> None:
+        """Merge a validated report into the fleet totals"""
+        with self.lock:
+            for name, histogram in report.get('histograms', {}).items():
+                merged = self.metrics.setdefault(name, {
+                    'unit': str(histogram.get('unit', '')),
+                    'count': 0,
+                    'sum': 0,
+                    'max': 0,
+                    'buckets': [0] * TELEMETRY_BUCKETS
+                })
+                merged['count'] += histogram.get('count', 0)
+                merged['sum'] += histogram.get('sum', 0)
+                merged['max'] = max(merged['max'], histogram.get('max', 0))
+                for bucket, value in enumerate(histogram.get('buckets', [])):
+                    merged['buckets'][bucket] += value
+            
+            for priority, value in enumerate(report.get('evictions', [])):
+                self.evictions[priority] += value
+            
+            entry = self.devices.get(device)
+            if entry is None:
+                if len(self.devices) >= TELEMETRY_MAX_DEVICES:
+                    oldest = min(self.devices, key=lambda key: self.devices[key]['received'])
+                    del self.devices[oldest]
+                entry = {'reports': 0}
+                self.devices[device] = entry
+            entry['received'] = time.time()
+            entry['reports'] += 1
+            entry['report'] = {key: value for key, value in report.items() if key != 'histograms'}
+            self.reports += 1
+    
+    def get_summary(self) -> Dict[str, Any]:
+        """Fleet percentiles per metric, plus the devices reporting recently"""
+        with self.lock:
+            now = time.time()
+            metrics = {}
+            for name, merged in sorted(self.metrics.items()):
+                summary = {
+                    'unit': merged['unit'],
+                    'count': merged['count'],
+                    'mean': round(merged['sum'] / merged['count'], 1) if merged['count'] else 0,
+                    'max': merged['max']
+                }
+                for percent in TELEMETRY_PERCENTILES:
+                    summary[f'p{percent}'] = percentile(merged['buckets'], merged['count'],
+                                                        merged['max'], percent)
+                metrics[name] = summary
+            
+            # Hit rates from each device's own counters, which run from its boot
+            hits = misses = 0
+            active = 0
+            for entry in self.devices.values():
+                if now - entry['received'] > TELEMETRY_DEVICE_TIMEOUT:
+                    continue
+                active += 1
+                hits += entry['report'].get('hits', 0)
+                misses += entry['report'].get('misses', 0)
+            
+            return {
+                'reports': self.reports,
+                'devices': len(self.devices),
+                'active_devices': active,
+                'hit_rate': round(hits / (hits + misses), 3) if hits + misses else None,
+                'evictions': list(self.evictions),
+                'metrics': metrics
+            }
+    
+    def get_device(self, device: str) -> Optional[Dict[str, Any]]:
+        """Latest report of one device, without its histograms"""
+        with self.lock:
+            entry = self.devices.get(device)
+            if entry is None:
+                return None
+            return {
+                'device': device,
+                'reports': entry['reports'],
+                'last_report': entry['received'],
+                'report': dict(entry['report'])
+            }
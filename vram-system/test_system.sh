@@ -95,32 +95,97 @@ run_test "Get Resource Version" \
     "curl -s $SERVER_URL/api/resources/config_main/version" \
     '"version":'
 
-# Test 5: Get statistics
+# Test 5: Get raw resource bytes with metadata headers
+run_test "Get Raw Resource" \
+    "curl -s -i $SERVER_URL/api/resources/config_main/raw" \
+    'X-Resource-Hash: [0-9a-f]{64}'
+
+# Test 6: Revalidate with the current hash
+run_test "Conditional Get" \
+    "H=\$(curl -s $SERVER_URL/api/resources/config_main/version | grep -oE '[0-9a-f]{64}'); curl -s -o /dev/null -w '%{http_code}' -H \"If-None-Match: \\\"\$H\\\"\" $SERVER_URL/api/resources/config_main/raw" \
+    '^304$'
+
+# Test 7: Get one page of a resource with a Range header
+run_test "Range Request" \
+    "curl -s -i -H 'Range: bytes=0-7' $SERVER_URL/api/resources/config_main/raw | tr -d '\\r' | grep -E '^HTTP|^Content-Range' | tr '\\n' ' '" \
+    '206.*Content-Range: bytes 0-7/[0-9]+'
+
+# Test 8: Fetch several resources in one framed response
+run_test "Batch Resources" \
+    "curl -s -X POST -H 'Content-Type: application/json' -d '{\"resources\":[{\"id\":\"ui_strings\",\"priority\":2},{\"id\":\"config_main\",\"priority\":1}]}' $SERVER_URL/api/resources/batch | grep -a -o -E '(config_main|ui_strings) 200 [0-9]+ (identity|gzip)|END$' | cut -d' ' -f1 | tr '\n' ' '" \
+    'config_main ui_strings END'
+
+# Test 9: Prefetch hints mined from the access log
+run_test "Prefetch Hints" \
+    "curl -s $SERVER_URL/api/resources/config_main/hints" \
+    '"hints":'
+
+# Test 10: Get statistics
 run_test "Get Statistics" \
     "curl -s $SERVER_URL/api/stats" \
     '"total_resources":'
 
-# Test 6: Create new resource
+# Test 11: Hot cache serves repeat reads from memory
+run_test "Hot Cache Stats" \
+    "curl -s -o /dev/null '$SERVER_URL/api/resources/config_main?compress=true'; curl -s $SERVER_URL/api/stats | grep -o '\"hot_cache\":{[^}]*}'" \
+    '"hits":[1-9]'
+
+# Test 12: Pushed histograms show up in the fleet percentiles
+run_test "Telemetry Push" \
+    "curl -s -o /dev/null -X POST $SERVER_URL/api/telemetry -H 'Content-Type: application/json' -d '{\"device\":\"test_device\",\"hits\":3,\"misses\":1,\"evictions\":[0,0,1,2],\"histograms\":{\"fetch_ttfb\":{\"unit\":\"ms\",\"count\":3,\"sum\":60,\"max\":40,\"buckets\":[0,0,0,0,0,2,1]}}}'; curl -s $SERVER_URL/api/telemetry" \
+    '"fetch_ttfb":{[^}]*"p99":40'
+
+# Test 13: A packed sensor batch decodes into its samples
+run_test "Sensor Upload" \
+    "printf '\x01\x02\x00\x90\x4e\x00\xae\x03\xe8\x07\xa0\x01\x90\x4e\x02\x09\x00' | curl -s -X POST $SERVER_URL/api/sensors -H 'Content-Type: application/x-vram-samples' -H 'X-Device-Id: test_sensor_$$' -H 'X-Boot-Id: boot_a' --data-binary @-; curl -s $SERVER_URL/api/sensors/test_sensor_$$" \
+    '"humidity":49.5'
+
+# Test 14: A retried batch is not stored twice
+run_test "Sensor Upload Retry" \
+    "printf '\x01\x02\x00\x90\x4e\x00\xae\x03\xe8\x07\xa0\x01\x90\x4e\x02\x09\x00' | curl -s -X POST $SERVER_URL/api/sensors -H 'Content-Type: application/x-vram-samples' -H 'X-Device-Id: test_sensor_$$' -H 'X-Boot-Id: boot_a' --data-binary @-" \
+    '"accepted":0,"device":"test_sensor_[0-9]*","duplicates":2'
+
+# Test 15: After a reboot the same sequence numbers are new samples
+run_test "Sensor Upload After Reboot" \
+    "printf '\x01\x02\x00\x90\x4e\x00\xae\x03\xe8\x07\xa0\x01\x90\x4e\x02\x09\x00' | curl -s -X POST $SERVER_URL/api/sensors -H 'Content-Type: application/x-vram-samples' -H 'X-Device-Id: test_sensor_$$' -H 'X-Boot-Id: boot_b' --data-binary @-" \
+    '"accepted":2,"device":"test_sensor_[0-9]*","duplicates":0'
+
+# Test 16: Create new resource
 run_test "Create New Resource" \
     "curl -s -X POST $SERVER_URL/api/resources -H 'Content-Type: application/json' -d '{\"resource_id\":\"test_resource\",\"content\":\"test data\",\"category\":\"test\",\"priority\":3}'" \
     '"message":"Resource uploaded successfully"'
 
-# Test 7: Get newly created resource
+# Test 17: Reject an id the client cannot intern
+run_test "Reject Long Resource Id" \
+    "curl -s -o /dev/null -w '%{http_code}' -X POST $SERVER_URL/api/resources -H 'Content-Type: application/json' -d '{\"resource_id\":\"$(printf 'x%.0s' {1..64})\",\"content\":\"x\"}'" \
+    '^400$'
+
+# Test 18: Revalidate an updated resource from its previous version
+run_test "Delta Update" \
+    "B=\$(printf 'x%.0s' {1..200}); curl -s -o /dev/null -X POST $SERVER_URL/api/resources -H 'Content-Type: application/json' -d \"{\\\"resource_id\\\":\\\"test_resource\\\",\\\"content\\\":\\\"\$B\\\",\\\"category\\\":\\\"test\\\",\\\"priority\\\":3}\"; H=\$(curl -s $SERVER_URL/api/resources/test_resource/version | grep -oE '[0-9a-f]{64}'); curl -s -o /dev/null -X POST $SERVER_URL/api/resources -H 'Content-Type: application/json' -d \"{\\\"resource_id\\\":\\\"test_resource\\\",\\\"content\\\":\\\"\${B}y\\\",\\\"category\\\":\\\"test\\\",\\\"priority\\\":3}\"; curl -s -i -H \"If-None-Match: \\\"\$H\\\"\" -H 'A-IM: vram-delta' $SERVER_URL/api/resources/test_resource/raw | tr -d '\\r' | grep -a -E '^HTTP|^IM:' | tr '\\n' ' '" \
+    '226.*IM: vram-delta'
+
+# Test 19: Resource TTL is sent with the raw bytes
+run_test "Resource TTL" \
+    "curl -s -o /dev/null -X POST $SERVER_URL/api/resources -H 'Content-Type: application/json' -d '{\"resource_id\":\"ttl_resource\",\"content\":\"short lived\",\"ttl\":30}'; curl -s -i $SERVER_URL/api/resources/ttl_resource/raw | tr -d '\\r' | grep -a '^X-Resource-TTL:'; curl -s -o /dev/null -X DELETE $SERVER_URL/api/resources/ttl_resource" \
+    'X-Resource-TTL: 30'
+
+# Test 20: Get newly created resource
 run_test "Get Created Resource" \
     "curl -s $SERVER_URL/api/resources/test_resource" \
     '"resource_id":"test_resource"'
 
-# Test 8: Delete resource
+# Test 21: Delete resource
 run_test "Delete Resource" \
     "curl -s -X DELETE $SERVER_URL/api/resources/test_resource" \
     '"message":"Resource deleted successfully"'
 
-# Test 9: Verify resource deleted
+# Test 22: Verify resource deleted
 run_test "Verify Resource Deleted" \
     "curl -s $SERVER_URL/api/resources/test_resource" \
     '"error":"Resource not found"'
 
-# Test 10: Optimization endpoint
+# Test 23: Optimization endpoint
 run_test "Optimization Endpoint" \
     "curl -s -X POST $SERVER_URL/api/optimize -H 'Content-Type: application/json' -d '{}'" \
     '"message":"Optimization completed"'
@@ -129,7 +194,7 @@ echo ""
 echo "Running performance tests..."
 echo "============================"
 
-# Test 11: Response time check
+# Test 24: Response time check
 start_time=$(date +%s%N)
 curl -s "$SERVER_URL/api/health" >/dev/null
 end_time=$(date +%s%N)
@@ -143,7 +208,7 @@ else
     ((TESTS_FAILED++))
 fi
 
-# Test 12: Concurrent requests
+# Test 25: Concurrent requests
 echo -n "Concurrent Requests... "
 concurrent_results=$(for i in {1..10}; do curl -s "$SERVER_URL/api/health" & done; wait)
 concurrent_success=$(echo "$concurrent_results" | grep -c '"status":"healthy"')
@@ -160,17 +225,42 @@ echo ""
 echo "Testing file structure..."
 echo "========================"
 
-# Test 13: Check required files exist
+# Test 26: Check required files exist
 required_files=(
     "server/app.py"
     "server/resource_manager.py"
+    "server/telemetry.py"
+    "server/sensor_store.py"
+    "server/load_test.py"
+    "server/gunicorn.conf.py"
     "server/requirements.txt"
     "server/start_server.sh"
     "m5client/vram_client.ino"
     "m5client/memory_manager.h"
+    "m5client/inflate.h"
     "m5client/resource_cache.h"
+    "m5client/resource_id.h"
+    "m5client/eviction_policy.h"
+    "m5client/prefetcher.h"
+    "m5client/fetch_worker.h"
+    "m5client/resource_pager.h"
+    "m5client/resource_delta.h"
+    "m5client/telemetry.h"
+    "m5client/display_ui.h"
+    "m5client/resource_stream.h"
+    "m5client/vram_lock.h"
+    "m5client/vram_log.h"
+    "m5client/cache_snapshot.h"
+    "m5client/flash_tier.h"
     "m5client/wifi_manager.h"
+    "bench/vram_bench.cpp"
+    "bench/bench.h"
+    "bench/Makefile"
+    "bench/trace_from_log.py"
+    "bench/shim/Arduino.h"
+    "bench/shim/ArduinoJson.h"
     "examples/basic_usage.ino"
+    "examples/sensor_node.ino"
     "README.md"
     ".gitignore"
 )
@@ -193,7 +283,7 @@ else
     ((TESTS_FAILED++))
 fi
 
-# Test 14: Check file sizes are reasonable
+# Test 27: Check file sizes are reasonable
 echo -n "File Size Check... "
 total_size=$(du -sb . | cut -f1)
 if [ $total_size -lt 1048576 ]; then  # Less than 1MB